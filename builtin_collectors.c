@@ -0,0 +1,1400 @@
+/*
+ * Built-in collectors: the panels of the continuous monitor
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+#include "libsysmon.h"
+#include "collector.h"
+#include "cputable.h"
+#include "proctable.h"
+#include "sampler.h"
+
+/*
+ * CPU collector. Usage is the sum of per-CPU deltas kept by CPU id rather
+ * than the aggregate line, which drops an unplugged CPU's counters and
+ * would go backwards. The per-CPU table is the sampler's, shared with the
+ * virtualization and topology collectors.
+ */
+typedef struct {
+    CPUUsage usage;
+    int online;
+    int measured;                       // CPUs behind the figures
+    unsigned long topology_changes;
+} CPUResult;
+
+static int cpu_init(void **state) {
+    *state = NULL;
+    // Makes sure the shared table has a baseline for the first delta
+    return sampler_cpu_table() ? 0 : -1;
+}
+
+static int cpu_sample(void *state) {
+    (void)state;
+    return sampler_cpu_table() ? 0 : -1;
+}
+
+static int cpu_delta(void *state, void *result) {
+    const CPUTable *t = sampler_cpu_table();
+    CPUResult *r = result;
+    (void)state;
+
+    if (!t) {
+        return -1;
+    }
+    sysmon_cpu_usage_delta(&t->sum, &r->usage);
+    r->online = t->online;
+    r->measured = t->measured;
+    r->topology_changes = t->topology_changes;
+    return 0;
+}
+
+static void cpu_render(const void *result, FILE *out) {
+    const CPUResult *cpu = result;
+    const CPUUsage *r = &cpu->usage;
+    char text[96];
+
+    render_box_top(out, "CPU Usage");
+    SYSMON_CPU_METRICS(METRIC_ROW)
+    if (cpu->topology_changes || cpu->measured != cpu->online) {
+        snprintf(text, sizeof(text), "CPUs online:         %6d (%d measured, %lu hotplug events)",
+                 cpu->online, cpu->measured, cpu->topology_changes);
+        render_text_row(out, text);
+    }
+    render_box_bottom(out);
+}
+
+static void cpu_export(const void *result, sysmon_emit_fn emit, void *ctx) {
+    const CPUResult *cpu = result;
+    const CPUUsage *r = &cpu->usage;
+
+    SYSMON_CPU_METRICS(METRIC_EMIT)
+    emit(ctx, "cpu.online", (double)cpu->online, "");
+}
+
+static const Collector cpu_collector = {
+    .abi_version = COLLECTOR_ABI_VERSION,
+    .name = "cpu",
+    .title = "CPU Usage",
+    .result_size = sizeof(CPUResult),
+    .init = cpu_init,
+    .sample = cpu_sample,
+    .delta = cpu_delta,
+    .render = cpu_render,
+    .export = cpu_export,
+};
+
+/*
+ * Memory collector
+ */
+static int mem_init(void **state) {
+    *state = calloc(1, sizeof(MemInfo));
+    return *state ? 0 : -1;
+}
+
+static int mem_sample(void *state) {
+    return sysmon_mem_sample((MemInfo *)state);
+}
+
+static int mem_delta(void *state, void *result) {
+    // Memory is a gauge, the "delta" is just the latest reading
+    sysmon_mem_usage((MemInfo *)state, (MemUsage *)result);
+    return 0;
+}
+
+static void mem_render(const void *result, FILE *out) {
+    const MemUsage *r = result;
+
+    render_box_top(out, "Memory Usage");
+    SYSMON_MEM_METRICS(METRIC_ROW)
+    render_box_bottom(out);
+}
+
+static void mem_export(const void *result, sysmon_emit_fn emit, void *ctx) {
+    const MemUsage *r = result;
+    SYSMON_MEM_METRICS(METRIC_EMIT)
+}
+
+static const Collector mem_collector = {
+    .abi_version = COLLECTOR_ABI_VERSION,
+    .name = "mem",
+    .title = "Memory Usage",
+    .result_size = sizeof(MemUsage),
+    .init = mem_init,
+    .sample = mem_sample,
+    .delta = mem_delta,
+    .render = mem_render,
+    .export = mem_export,
+    .destroy = free,
+};
+
+/*
+ * Load average and run-queue collector
+ */
+#define LOAD_MAX_CPUS 256
+#define LOAD_SHOWN_CPUS 8
+
+typedef struct {
+    int cpu;
+    double avg_wait_us;                 // run-queue wait per timeslice
+    double wait_pct;                    // waiting task-time as % of the interval
+} CPUWait;
+
+typedef struct {
+    LoadInfo load;
+    int have_schedstat;
+    double avg_wait_us;                 // over all CPUs
+    int ncpu;
+    CPUWait cpus[LOAD_MAX_CPUS];        // sorted, longest wait first
+} LoadResult;
+
+typedef struct {
+    LoadInfo load;
+    int ncpu;
+    int prev_ncpu;
+    struct timespec taken;
+    struct timespec prev_taken;
+    CPUSchedStat sched[LOAD_MAX_CPUS];
+    CPUSchedStat prev_sched[LOAD_MAX_CPUS];
+    char *text;                         // /proc/schedstat, grown to fit and reused
+    size_t text_size;
+} LoadState;
+
+/*
+ * Per-CPU run-queue counters, or -1 on a kernel without schedstat
+ */
+static int load_schedstat(LoadState *s, CPUSchedStat *buf) {
+    if (sysmon_schedstat_read(&s->text, &s->text_size) < 0) {
+        return -1;
+    }
+    return sysmon_schedstat_parse(s->text, buf, LOAD_MAX_CPUS);
+}
+
+static void load_destroy(void *state) {
+    LoadState *s = state;
+    free(s->text);
+    free(s);
+}
+
+static int load_init(void **state) {
+    LoadState *s = calloc(1, sizeof(LoadState));
+    if (!s) {
+        return -1;
+    }
+    // Baseline for run-queue deltas
+    s->prev_ncpu = load_schedstat(s, s->prev_sched);
+    clock_gettime(CLOCK_MONOTONIC, &s->prev_taken);
+    *state = s;
+    return 0;
+}
+
+static int load_sample(void *state) {
+    LoadState *s = state;
+
+    // procs_* come from the /proc/stat the CPU collectors read this tick
+    const CPUTable *t = sampler_cpu_table();
+    if (!t) {
+        if (sysmon_load_sample(&s->load) != 0) {
+            return -1;
+        }
+    } else if (sysmon_loadavg_sample(&s->load) != 0 ||
+               sysmon_procs_parse(t->stat_text, &s->load) != 0) {
+        return -1;
+    }
+    s->ncpu = load_schedstat(s, s->sched);
+    clock_gettime(CLOCK_MONOTONIC, &s->taken);
+    return 0;
+}
+
+static int cmp_cpu_wait(const void *a, const void *b) {
+    const CPUWait *wa = a;
+    const CPUWait *wb = b;
+    if (wa->avg_wait_us != wb->avg_wait_us) return (wa->avg_wait_us < wb->avg_wait_us) ? 1 : -1;
+    return wa->cpu - wb->cpu;
+}
+
+static int load_delta(void *state, void *result) {
+    LoadState *s = state;
+    LoadResult *r = result;
+
+    memset(r, 0, sizeof(*r));
+    r->load = s->load;
+
+    double elapsed_ns = (s->taken.tv_sec - s->prev_taken.tv_sec) * 1e9 +
+                        (s->taken.tv_nsec - s->prev_taken.tv_nsec);
+    int ncpu = s->ncpu < LOAD_MAX_CPUS ? s->ncpu : LOAD_MAX_CPUS;
+    int prev_ncpu = s->prev_ncpu < LOAD_MAX_CPUS ? s->prev_ncpu : LOAD_MAX_CPUS;
+
+    if (ncpu > 0 && prev_ncpu > 0 && elapsed_ns > 0) {
+        unsigned long long all_delay = 0, all_slices = 0;
+        r->have_schedstat = 1;
+
+        for (int i = 0; i < ncpu; i++) {
+            // Match by CPU id, not by line position
+            const CPUSchedStat *prev = NULL;
+            for (int j = 0; j < prev_ncpu; j++) {
+                if (s->prev_sched[(i + j) % prev_ncpu].cpu == s->sched[i].cpu) {
+                    prev = &s->prev_sched[(i + j) % prev_ncpu];
+                    break;
+                }
+            }
+            if (!prev || s->sched[i].run_delay_ns < prev->run_delay_ns ||
+                s->sched[i].timeslices < prev->timeslices) {
+                continue;
+            }
+
+            unsigned long long delay = s->sched[i].run_delay_ns - prev->run_delay_ns;
+            unsigned long long slices = s->sched[i].timeslices - prev->timeslices;
+            CPUWait *w = &r->cpus[r->ncpu++];
+            w->cpu = s->sched[i].cpu;
+            w->avg_wait_us = slices ? delay / 1000.0 / slices : 0.0;
+            w->wait_pct = delay / elapsed_ns * 100.0;
+            all_delay += delay;
+            all_slices += slices;
+        }
+        r->avg_wait_us = all_slices ? all_delay / 1000.0 / all_slices : 0.0;
+        qsort(r->cpus, (size_t)r->ncpu, sizeof(CPUWait), cmp_cpu_wait);
+    }
+
+    memcpy(s->prev_sched, s->sched, sizeof(CPUSchedStat) * (size_t)(ncpu > 0 ? ncpu : 0));
+    s->prev_ncpu = s->ncpu;
+    s->prev_taken = s->taken;
+    return 0;
+}
+
+static void load_render(const void *result, FILE *out) {
+    const LoadResult *load = result;
+    const LoadInfo *r = &load->load;
+
+    render_box_top(out, "Load & Run Queue");
+    SYSMON_LOAD_METRICS(METRIC_ROW)
+    if (!load->have_schedstat) {
+        fprintf(out, "│ Run-queue wait:      n/a (no /proc/schedstat)               │\n");
+    } else {
+        fprintf(out, "│ Avg sched latency:   %9.1f us per timeslice             │\n", load->avg_wait_us);
+        int shown = load->ncpu < LOAD_SHOWN_CPUS ? load->ncpu : LOAD_SHOWN_CPUS;
+        for (int i = 0; i < shown; i++) {
+            fprintf(out, "│   cpu%-4d           %9.1f us/slice  %6.1f%% waiting     │\n",
+                    load->cpus[i].cpu, load->cpus[i].avg_wait_us, load->cpus[i].wait_pct);
+        }
+    }
+    render_box_bottom(out);
+}
+
+static void load_export(const void *result, sysmon_emit_fn emit, void *ctx) {
+    const LoadResult *load = result;
+    const LoadInfo *r = &load->load;
+    char name[64];
+
+    SYSMON_LOAD_METRICS(METRIC_EMIT)
+    if (load->have_schedstat) {
+        emit(ctx, "sched.avg_wait", load->avg_wait_us, "us");
+        for (int i = 0; i < load->ncpu; i++) {
+            snprintf(name, sizeof(name), "sched.cpu%d.avg_wait", load->cpus[i].cpu);
+            emit(ctx, name, load->cpus[i].avg_wait_us, "us");
+        }
+    }
+}
+
+static const Collector load_collector = {
+    .abi_version = COLLECTOR_ABI_VERSION,
+    .name = "load",
+    .title = "Load & Run Queue",
+    .result_size = sizeof(LoadResult),
+    .init = load_init,
+    .sample = load_sample,
+    .delta = load_delta,
+    .render = load_render,
+    .export = load_export,
+    .destroy = load_destroy,
+};
+
+/*
+ * Virtualization collector: steal and guest time per CPU, steal
+ * percentiles over the recent past and an alert on steal bursts
+ */
+#define VIRT_MAX_CPUS 256
+#define VIRT_SHOWN_CPUS 8
+#define VIRT_HISTORY 300                // samples behind the steal percentiles
+#define VIRT_STEAL_ALERT_PCT 10.0       // default burst threshold, see SYSMON_STEAL_ALERT
+
+typedef struct {
+    int cpu;
+    double steal_pct;
+    double guest_pct;
+    double guest_nice_pct;
+} VirtCPU;
+
+typedef struct {
+    double steal_pct;                   // whole machine
+    double guest_pct;
+    double guest_nice_pct;
+    double steal_p50, steal_p95, steal_p99, steal_max;
+    int history;                        // samples behind the percentiles
+    double threshold;
+    int burst;                          // some CPU is above the threshold now
+    int burst_cpu;
+    double burst_pct;
+    unsigned long bursts;               // bursts seen since start
+    int ncpu;
+    VirtCPU cpus[VIRT_MAX_CPUS];        // sorted, most steal first
+} VirtResult;
+
+typedef struct {
+    double history[VIRT_HISTORY];       // ring of whole-machine steal %
+    int history_len;
+    int history_pos;
+    double threshold;
+    int in_burst;
+    unsigned long bursts;
+} VirtState;
+
+static int virt_init(void **state) {
+    VirtState *s = calloc(1, sizeof(VirtState));
+    if (!s) {
+        return -1;
+    }
+    if (!sampler_cpu_table()) {
+        free(s);
+        return -1;
+    }
+
+    const char *env = getenv("SYSMON_STEAL_ALERT");
+    s->threshold = env ? atof(env) : 0.0;
+    if (s->threshold <= 0.0) {
+        s->threshold = VIRT_STEAL_ALERT_PCT;
+    }
+    *state = s;
+    return 0;
+}
+
+static int virt_sample(void *state) {
+    (void)state;
+    return sampler_cpu_table() ? 0 : -1;
+}
+
+static int cmp_virt_steal(const void *a, const void *b) {
+    const VirtCPU *va = a;
+    const VirtCPU *vb = b;
+    if (va->steal_pct != vb->steal_pct) return (va->steal_pct < vb->steal_pct) ? 1 : -1;
+    return va->cpu - vb->cpu;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double da = *(const double *)a;
+    double db = *(const double *)b;
+    return (da > db) - (da < db);
+}
+
+static int virt_delta(void *state, void *result) {
+    VirtState *s = state;
+    VirtResult *r = result;
+    const CPUTable *t = sampler_cpu_table();
+
+    if (!t) {
+        return -1;
+    }
+    const CPUStats *sum = &t->sum;
+
+    memset(r, 0, sizeof(*r));
+    r->threshold = s->threshold;
+    r->burst_cpu = -1;
+
+    for (int i = 0; i < t->capacity && r->ncpu < VIRT_MAX_CPUS; i++) {
+        const CPUEntry *e = &t->cpus[i];
+        if (!e->delta_ok || e->delta.total == 0) {
+            continue;
+        }
+        VirtCPU *v = &r->cpus[r->ncpu++];
+        v->cpu = e->cpu;
+        v->steal_pct = (double)e->delta.steal / e->delta.total * 100.0;
+        v->guest_pct = (double)e->delta.guest / e->delta.total * 100.0;
+        v->guest_nice_pct = (double)e->delta.guest_nice / e->delta.total * 100.0;
+    }
+
+    if (r->ncpu == 0) {
+        return 0;
+    }
+    qsort(r->cpus, (size_t)r->ncpu, sizeof(VirtCPU), cmp_virt_steal);
+
+    r->steal_pct = (double)sum->steal / sum->total * 100.0;
+    r->guest_pct = (double)sum->guest / sum->total * 100.0;
+    r->guest_nice_pct = (double)sum->guest_nice / sum->total * 100.0;
+
+    // A burst starts when any CPU crosses the threshold and lasts while one stays above
+    r->burst_cpu = r->cpus[0].cpu;
+    r->burst_pct = r->cpus[0].steal_pct;
+    r->burst = r->burst_pct > s->threshold;
+    if (r->burst && !s->in_burst) {
+        s->bursts++;
+    }
+    s->in_burst = r->burst;
+    r->bursts = s->bursts;
+
+    s->history[s->history_pos] = r->steal_pct;
+    s->history_pos = (s->history_pos + 1) % VIRT_HISTORY;
+    if (s->history_len < VIRT_HISTORY) {
+        s->history_len++;
+    }
+
+    double sorted[VIRT_HISTORY];
+    int n = s->history_len;
+    memcpy(sorted, s->history, sizeof(double) * (size_t)n);
+    qsort(sorted, (size_t)n, sizeof(double), cmp_double);
+    // Nearest-rank percentiles
+    r->steal_p50 = sorted[(n * 50 + 99) / 100 - 1];
+    r->steal_p95 = sorted[(n * 95 + 99) / 100 - 1];
+    r->steal_p99 = sorted[(n * 99 + 99) / 100 - 1];
+    r->steal_max = sorted[n - 1];
+    r->history = n;
+    return 0;
+}
+
+static void virt_render(const void *result, FILE *out) {
+    const VirtResult *r = result;
+    char text[128];
+
+    render_box_top(out, "Virtualization");
+    if (r->steal_max <= 0.0 && r->guest_pct <= 0.0 && r->guest_nice_pct <= 0.0 && r->bursts == 0) {
+        render_text_row(out, "No steal or guest time observed");
+        render_box_bottom(out);
+        return;
+    }
+
+    snprintf(text, sizeof(text), "Steal: %6.2f%%   Guest: %6.2f%%   Guest nice: %6.2f%%",
+             r->steal_pct, r->guest_pct, r->guest_nice_pct);
+    render_text_row(out, text);
+    snprintf(text, sizeof(text), "Steal p50/p95/p99/max: %.1f/%.1f/%.1f/%.1f%% (%d samples)",
+             r->steal_p50, r->steal_p95, r->steal_p99, r->steal_max, r->history);
+    render_text_row(out, text);
+    if (r->burst) {
+        snprintf(text, sizeof(text), "ALERT: steal burst %.1f%% on cpu%d (> %.1f%%)",
+                 r->burst_pct, r->burst_cpu, r->threshold);
+    } else {
+        snprintf(text, sizeof(text), "Bursts over %.1f%% so far: %lu", r->threshold, r->bursts);
+    }
+    render_text_row(out, text);
+
+    int shown = r->ncpu < VIRT_SHOWN_CPUS ? r->ncpu : VIRT_SHOWN_CPUS;
+    for (int i = 0; i < shown; i++) {
+        snprintf(text, sizeof(text), "  cpu%-4d  steal %6.2f%%  guest %6.2f%%  nice %6.2f%%",
+                 r->cpus[i].cpu, r->cpus[i].steal_pct, r->cpus[i].guest_pct, r->cpus[i].guest_nice_pct);
+        render_text_row(out, text);
+    }
+    render_box_bottom(out);
+}
+
+static void virt_export(const void *result, sysmon_emit_fn emit, void *ctx) {
+    const VirtResult *r = result;
+    char name[64];
+
+    // Machine-wide steal and guest are exported by the cpu collector
+    if (r->history == 0) {
+        return;
+    }
+    emit(ctx, "virt.steal.p50", r->steal_p50, "%");
+    emit(ctx, "virt.steal.p95", r->steal_p95, "%");
+    emit(ctx, "virt.steal.p99", r->steal_p99, "%");
+    emit(ctx, "virt.steal.max", r->steal_max, "%");
+    emit(ctx, "virt.bursts", (double)r->bursts, "");
+    for (int i = 0; i < r->ncpu; i++) {
+        snprintf(name, sizeof(name), "virt.cpu%d.steal", r->cpus[i].cpu);
+        emit(ctx, name, r->cpus[i].steal_pct, "%");
+        snprintf(name, sizeof(name), "virt.cpu%d.guest", r->cpus[i].cpu);
+        emit(ctx, name, r->cpus[i].guest_pct + r->cpus[i].guest_nice_pct, "%");
+    }
+}
+
+static const Collector virt_collector = {
+    .abi_version = COLLECTOR_ABI_VERSION,
+    .name = "virt",
+    .title = "Virtualization",
+    .result_size = sizeof(VirtResult),
+    .init = virt_init,
+    .sample = virt_sample,
+    .delta = virt_delta,
+    .render = virt_render,
+    .export = virt_export,
+    .destroy = free,
+};
+
+/*
+ * CPU topology collector: busy time per socket, L3 domain and physical
+ * core, to spot socket imbalance and SMT siblings competing for a core.
+ * Groups are kept in the state, sized from the CPU table, so totals cover
+ * every CPU; the flat result lists the first TOPO_MAX_* of each.
+ */
+#define TOPO_MAX_SOCKETS 16             // listed in a result
+#define TOPO_MAX_L3 64
+#define TOPO_MAX_CORES 1024
+#define TOPO_BUSY_PCT 50.0              // a thread this busy counts toward SMT contention
+#define TOPO_CELLS_PER_ROW 52
+
+typedef struct {
+    int id;                             // package id, or L3 cache id
+    int socket;                         // group index of the package (L3 only)
+    int cpus;
+    int measured;
+    double busy_pct;
+} TopoGroup;
+
+typedef struct {
+    int socket;                         // group index of the package
+    int core;                           // core_id
+    int threads;
+    int measured;
+    int busy_threads;
+    double busy_pct;                    // average over its threads
+} TopoCore;
+
+typedef struct {
+    int nsockets;                       // counts cover all groups, the
+    TopoGroup sockets[TOPO_MAX_SOCKETS]; // arrays list the first ones
+    int nl3;
+    TopoGroup l3[TOPO_MAX_L3];
+    int ncores;
+    TopoCore cores[TOPO_MAX_CORES];
+    int truncated;                      // some group is not listed
+    int threads;
+    int smt;                            // some core runs more than one thread
+    int contended;                      // cores with every thread busy
+    double imbalance;                   // busiest minus least busy socket, points
+} TopoResult;
+
+typedef struct {
+    unsigned long topology_seen;        // CPUTable topology_changes at the last build
+    int map_size;                       // entries in every array below
+    // Group indices per CPU id, rebuilt only when the topology changes
+    int *socket_of;
+    int *l3_of;
+    int *core_of;
+    // Groups; there are never more of a kind than CPUs
+    TopoGroup *sockets;
+    TopoGroup *l3;
+    TopoCore *cores;
+    int nsockets;
+    int nl3;
+    int ncores;
+    int threads;
+    int smt;
+} TopoState;
+
+static int topo_find(TopoGroup *groups, int *count, int id) {
+    for (int i = 0; i < *count; i++) {
+        if (groups[i].id == id) {
+            return i;
+        }
+    }
+    memset(&groups[*count], 0, sizeof(TopoGroup));
+    groups[*count].id = id;
+    return (*count)++;
+}
+
+/*
+ * Make every per-CPU and per-group array hold `capacity` entries
+ */
+static int topo_grow(TopoState *s, int capacity) {
+    size_t n = (size_t)capacity;
+    int *socket_of = realloc(s->socket_of, sizeof(int) * n);
+    if (socket_of) s->socket_of = socket_of;
+    int *l3_of = realloc(s->l3_of, sizeof(int) * n);
+    if (l3_of) s->l3_of = l3_of;
+    int *core_of = realloc(s->core_of, sizeof(int) * n);
+    if (core_of) s->core_of = core_of;
+    TopoGroup *sockets = realloc(s->sockets, sizeof(TopoGroup) * n);
+    if (sockets) s->sockets = sockets;
+    TopoGroup *l3 = realloc(s->l3, sizeof(TopoGroup) * n);
+    if (l3) s->l3 = l3;
+    TopoCore *cores = realloc(s->cores, sizeof(TopoCore) * n);
+    if (cores) s->cores = cores;
+
+    if (!socket_of || !l3_of || !core_of || !sockets || !l3 || !cores) {
+        return -1;
+    }
+    s->map_size = capacity;
+    return 0;
+}
+
+/*
+ * Assign every online CPU to its socket, L3 domain and core
+ */
+static int topo_build(TopoState *s, const CPUTable *t) {
+    if (s->map_size < t->capacity && topo_grow(s, t->capacity) != 0) {
+        return -1;
+    }
+
+    s->nsockets = s->nl3 = s->ncores = s->threads = s->smt = 0;
+    for (int i = 0; i < t->capacity; i++) {
+        const CPUEntry *e = &t->cpus[i];
+        s->socket_of[i] = s->l3_of[i] = s->core_of[i] = -1;
+        if (!e->online) {
+            continue;
+        }
+        int socket = topo_find(s->sockets, &s->nsockets, e->package);
+        int l3 = topo_find(s->l3, &s->nl3, e->l3);
+        int core = -1;
+        for (int c = 0; c < s->ncores; c++) {
+            if (s->cores[c].socket == socket && s->cores[c].core == e->core) {
+                core = c;
+                break;
+            }
+        }
+        // Without a core id every CPU is its own core
+        if (core < 0 || e->core < 0) {
+            core = s->ncores++;
+            memset(&s->cores[core], 0, sizeof(TopoCore));
+            s->cores[core].socket = socket;
+            s->cores[core].core = e->core;
+        }
+
+        s->sockets[socket].cpus++;
+        s->l3[l3].cpus++;
+        s->l3[l3].socket = socket;
+        s->cores[core].threads++;
+        if (s->cores[core].threads > 1) s->smt = 1;
+        s->threads++;
+        s->socket_of[i] = socket;
+        s->l3_of[i] = l3;
+        s->core_of[i] = core;
+    }
+    return 0;
+}
+
+static void topo_destroy(void *state) {
+    TopoState *s = state;
+    free(s->socket_of);
+    free(s->l3_of);
+    free(s->core_of);
+    free(s->sockets);
+    free(s->l3);
+    free(s->cores);
+    free(s);
+}
+
+static int topo_init(void **state) {
+    TopoState *s = calloc(1, sizeof(TopoState));
+    if (!s) {
+        return -1;
+    }
+    const CPUTable *t = sampler_cpu_table();
+    if (!t || topo_build(s, t) != 0) {
+        topo_destroy(s);
+        return -1;
+    }
+    s->topology_seen = t->topology_changes;
+    *state = s;
+    return 0;
+}
+
+static int topo_sample(void *state) {
+    TopoState *s = state;
+    const CPUTable *t = sampler_cpu_table();
+    if (!t) {
+        return -1;
+    }
+    if (t->topology_changes == s->topology_seen && s->map_size >= t->capacity) {
+        return 0;
+    }
+    s->topology_seen = t->topology_changes;
+    return topo_build(s, t);
+}
+
+static int topo_listed(int count, int max) {
+    return count < max ? count : max;
+}
+
+static int topo_delta(void *state, void *result) {
+    TopoState *s = state;
+    TopoResult *r = result;
+    const CPUTable *t = sampler_cpu_table();
+
+    if (!t) {
+        return -1;
+    }
+    for (int i = 0; i < s->nsockets; i++) {
+        s->sockets[i].measured = 0;
+        s->sockets[i].busy_pct = 0.0;
+    }
+    for (int i = 0; i < s->nl3; i++) {
+        s->l3[i].measured = 0;
+        s->l3[i].busy_pct = 0.0;
+    }
+    for (int i = 0; i < s->ncores; i++) {
+        s->cores[i].measured = 0;
+        s->cores[i].busy_threads = 0;
+        s->cores[i].busy_pct = 0.0;
+    }
+
+    for (int i = 0; i < t->capacity && i < s->map_size; i++) {
+        const CPUEntry *e = &t->cpus[i];
+        if (s->socket_of[i] < 0 || !e->delta_ok || e->delta.total == 0) {
+            continue;
+        }
+        double busy = (double)e->delta.active / e->delta.total * 100.0;
+        s->sockets[s->socket_of[i]].busy_pct += busy;
+        s->sockets[s->socket_of[i]].measured++;
+        s->l3[s->l3_of[i]].busy_pct += busy;
+        s->l3[s->l3_of[i]].measured++;
+        TopoCore *c = &s->cores[s->core_of[i]];
+        c->busy_pct += busy;
+        c->measured++;
+        if (busy >= TOPO_BUSY_PCT) c->busy_threads++;
+    }
+
+    // Sums to averages, over every group whether listed or not
+    memset(r, 0, sizeof(*r));
+    double most = 0.0, least = 100.0;
+    for (int i = 0; i < s->nsockets; i++) {
+        TopoGroup *g = &s->sockets[i];
+        if (g->measured) g->busy_pct /= g->measured;
+        if (g->busy_pct > most) most = g->busy_pct;
+        if (g->busy_pct < least) least = g->busy_pct;
+    }
+    r->imbalance = s->nsockets > 1 ? most - least : 0.0;
+    for (int i = 0; i < s->nl3; i++) {
+        if (s->l3[i].measured) s->l3[i].busy_pct /= s->l3[i].measured;
+    }
+    for (int i = 0; i < s->ncores; i++) {
+        TopoCore *c = &s->cores[i];
+        if (c->measured) c->busy_pct /= c->measured;
+        if (c->threads > 1 && c->busy_threads == c->threads) r->contended++;
+    }
+
+    r->nsockets = s->nsockets;
+    r->nl3 = s->nl3;
+    r->ncores = s->ncores;
+    r->threads = s->threads;
+    r->smt = s->smt;
+    r->truncated = s->nsockets > TOPO_MAX_SOCKETS || s->nl3 > TOPO_MAX_L3 ||
+                   s->ncores > TOPO_MAX_CORES;
+    memcpy(r->sockets, s->sockets, sizeof(TopoGroup) * (size_t)topo_listed(s->nsockets, TOPO_MAX_SOCKETS));
+    memcpy(r->l3, s->l3, sizeof(TopoGroup) * (size_t)topo_listed(s->nl3, TOPO_MAX_L3));
+    memcpy(r->cores, s->cores, sizeof(TopoCore) * (size_t)topo_listed(s->ncores, TOPO_MAX_CORES));
+    return 0;
+}
+
+static void topo_render(const void *result, FILE *out) {
+    const TopoResult *r = result;
+    char text[128];
+
+    render_box_top(out, "CPU Topology");
+    snprintf(text, sizeof(text), "%d socket%s, %d cores, %d threads, %d L3 domain%s",
+             r->nsockets, r->nsockets == 1 ? "" : "s", r->ncores, r->threads,
+             r->nl3, r->nl3 == 1 ? "" : "s");
+    render_text_row(out, text);
+    if (r->truncated) {
+        snprintf(text, sizeof(text), "Listing the first %d sockets, %d L3 domains, %d cores",
+                 topo_listed(r->nsockets, TOPO_MAX_SOCKETS), topo_listed(r->nl3, TOPO_MAX_L3),
+                 topo_listed(r->ncores, TOPO_MAX_CORES));
+        render_text_row(out, text);
+    }
+
+    for (int i = 0; i < topo_listed(r->nsockets, TOPO_MAX_SOCKETS); i++) {
+        int len = snprintf(text, sizeof(text), "socket %-3d %6.1f%%  L3:", r->sockets[i].id, r->sockets[i].busy_pct);
+        for (int j = 0; j < topo_listed(r->nl3, TOPO_MAX_L3) && len < (int)sizeof(text) - 8; j++) {
+            if (r->l3[j].socket == i) {
+                len += snprintf(text + len, sizeof(text) - (size_t)len, " %5.1f%%", r->l3[j].busy_pct);
+            }
+        }
+        render_text_row(out, text);
+    }
+    if (r->nsockets > 1) {
+        snprintf(text, sizeof(text), "Socket imbalance:    %6.1f points", r->imbalance);
+        render_text_row(out, text);
+    }
+    if (r->smt) {
+        snprintf(text, sizeof(text), "SMT contention:      %d of %d cores have every thread busy",
+                 r->contended, r->ncores);
+        render_text_row(out, text);
+    }
+
+    // One cell per core: busy/10 as a digit, '#' where all SMT siblings are busy
+    render_text_row(out, "Cores (0-9 = busy/10, # = SMT siblings all busy):");
+    for (int i = 0; i < topo_listed(r->nsockets, TOPO_MAX_SOCKETS); i++) {
+        int len = 0;
+        for (int c = 0; c < topo_listed(r->ncores, TOPO_MAX_CORES); c++) {
+            const TopoCore *core = &r->cores[c];
+            if (core->socket != i) {
+                continue;
+            }
+            if (len == 0) {
+                len = snprintf(text, sizeof(text), "  s%-3d ", r->sockets[i].id);
+            }
+            int level = (int)(core->busy_pct / 10.0);
+            text[len++] = (core->threads > 1 && core->busy_threads == core->threads)
+                          ? '#' : (char)('0' + (level > 9 ? 9 : level));
+            text[len] = '\0';
+            if (len - 7 == TOPO_CELLS_PER_ROW) {
+                render_text_row(out, text);
+                len = snprintf(text, sizeof(text), "       ");
+            }
+        }
+        if (len > 7) {
+            render_text_row(out, text);
+        }
+    }
+    render_box_bottom(out);
+}
+
+static void topo_export(const void *result, sysmon_emit_fn emit, void *ctx) {
+    const TopoResult *r = result;
+    char name[64];
+
+    for (int i = 0; i < topo_listed(r->nsockets, TOPO_MAX_SOCKETS); i++) {
+        snprintf(name, sizeof(name), "topo.socket%d.busy", r->sockets[i].id);
+        emit(ctx, name, r->sockets[i].busy_pct, "%");
+    }
+    for (int i = 0; i < topo_listed(r->nl3, TOPO_MAX_L3); i++) {
+        snprintf(name, sizeof(name), "topo.l3_%d.busy", r->l3[i].id);
+        emit(ctx, name, r->l3[i].busy_pct, "%");
+    }
+    emit(ctx, "topo.socket_imbalance", r->imbalance, "%");
+    emit(ctx, "topo.smt_contended", (double)r->contended, "");
+    emit(ctx, "topo.truncated", (double)r->truncated, "");
+}
+
+static const Collector topo_collector = {
+    .abi_version = COLLECTOR_ABI_VERSION,
+    .name = "topo",
+    .title = "CPU Topology",
+    .result_size = sizeof(TopoResult),
+    .init = topo_init,
+    .sample = topo_sample,
+    .delta = topo_delta,
+    .render = topo_render,
+    .export = topo_export,
+    .destroy = topo_destroy,
+};
+
+/*
+ * Self-overhead collector: what the monitor costs the machine (its CPU
+ * time, memory) and how much the machine is crowding it out (late sampler
+ * wakeups, preemptions). With --pin/--idle the first should stay flat
+ * while the workload runs; the second is the price paid for that.
+ */
+typedef struct {
+    SYSMON_SELF_METRICS(METRIC_STRUCT_FIELD)
+    int cpu;                            // CPU the sampler last ran on
+    int allowed;                        // CPUs the sampler may run on
+    int online;
+    int policy;                         // SCHED_OTHER, SCHED_IDLE, ...
+    int nice;
+    int io_class;                       // 0 = none (follows nice), 3 = idle
+} SelfResult;
+
+typedef struct {
+    struct timespec wall;
+    double process_s;                   // user + system, all threads
+    double sampler_s;                   // the sampler thread only
+    long preemptions;                   // involuntary context switches
+} SelfSample;
+
+typedef struct {
+    SelfSample prev;
+    SelfSample now;
+} SelfState;
+
+static double timeval_s(const struct timeval *tv) {
+    return tv->tv_sec + tv->tv_usec / 1e6;
+}
+
+static void self_read(SelfSample *s) {
+    struct rusage ru;
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &s->wall);
+    getrusage(RUSAGE_SELF, &ru);
+    s->process_s = timeval_s(&ru.ru_utime) + timeval_s(&ru.ru_stime);
+    s->preemptions = ru.ru_nivcsw;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    s->sampler_s = ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int self_init(void **state) {
+    SelfState *s = calloc(1, sizeof(SelfState));
+    if (!s) {
+        return -1;
+    }
+    // init runs on the starting thread; the sampler's own CPU clock starts at 0
+    self_read(&s->prev);
+    s->prev.sampler_s = 0;
+    *state = s;
+    return 0;
+}
+
+static int self_sample(void *state) {
+    self_read(&((SelfState *)state)->now);
+    return 0;
+}
+
+/*
+ * VmRSS and VmLck of this process in kB
+ */
+static void self_memory(unsigned long long *rss_kb, unsigned long long *locked_kb) {
+    char line[128];
+    FILE *f = fopen("/proc/self/status", "r");
+
+    *rss_kb = *locked_kb = 0;
+    if (!f) {
+        return;
+    }
+    while (fgets(line, sizeof(line), f)) {
+        if (strncmp(line, "VmLck:", 6) == 0) {
+            *locked_kb = strtoull(line + 6, NULL, 10);
+        } else if (strncmp(line, "VmRSS:", 6) == 0) {
+            *rss_kb = strtoull(line + 6, NULL, 10);
+            break;
+        }
+    }
+    fclose(f);
+}
+
+static int self_delta(void *state, void *result) {
+    SelfState *s = state;
+    SelfResult *r = result;
+    SamplerTiming timing;
+
+    double wall = (s->now.wall.tv_sec - s->prev.wall.tv_sec) +
+                  (s->now.wall.tv_nsec - s->prev.wall.tv_nsec) / 1e9;
+    if (wall <= 0) {
+        return -1;
+    }
+    sampler_timing(&timing);
+    unsigned long ticks = timing.ticks ? timing.ticks : 1;
+
+    memset(r, 0, sizeof(*r));
+    r->online = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    r->cpu_pct = (s->now.process_s - s->prev.process_s) / wall * 100.0;
+    r->machine_pct = r->online > 0 ? r->cpu_pct / r->online : r->cpu_pct;
+    r->preempted = (s->now.preemptions - s->prev.preemptions) / wall;
+
+    // Per tick, averaged since start so the first ticks' setup shows too
+    r->sampler_us = s->now.sampler_s * 1e6 / (double)ticks;
+    r->sample_us = timing.busy_us;
+    r->late_us = timing.late_us;
+    r->late_max_us = timing.late_max_us;
+    self_memory(&r->rss_kb, &r->locked_kb);
+
+    cpu_set_t allowed;
+    r->allowed = sched_getaffinity(0, sizeof(allowed), &allowed) == 0 ? CPU_COUNT(&allowed) : 0;
+    r->cpu = sched_getcpu();
+    r->policy = sched_getscheduler(0);
+    r->nice = getpriority(PRIO_PROCESS, 0);
+    long io = syscall(SYS_ioprio_get, 1, 0);    // IOPRIO_WHO_PROCESS, this thread
+    r->io_class = io > 0 ? (int)(io >> 13) : 0;
+
+    s->prev = s->now;
+    return 0;
+}
+
+static const char *policy_name(int policy) {
+    switch (policy) {
+        case SCHED_OTHER: return "normal";
+        case SCHED_BATCH: return "batch";
+        case SCHED_IDLE:  return "idle";
+        case SCHED_FIFO:  return "fifo";
+        case SCHED_RR:    return "rr";
+        default:          return "?";
+    }
+}
+
+static void self_render(const void *result, FILE *out) {
+    const SelfResult *r = result;
+    static const char *io_classes[] = { "default", "realtime", "best-effort", "idle" };
+    char text[128];
+
+    render_box_top(out, "Monitor Overhead");
+    SYSMON_SELF_METRICS(METRIC_ROW)
+    if (r->allowed > 0 && r->allowed < r->online) {
+        snprintf(text, sizeof(text), "Sampler on CPU %d, pinned to %d of %d CPUs",
+                 r->cpu, r->allowed, r->online);
+    } else {
+        snprintf(text, sizeof(text), "Sampler on CPU %d, not pinned", r->cpu);
+    }
+    render_text_row(out, text);
+    snprintf(text, sizeof(text), "Scheduling: %s, nice %d, I/O %s", policy_name(r->policy),
+             r->nice, io_classes[r->io_class & 3]);
+    render_text_row(out, text);
+    render_box_bottom(out);
+}
+
+static void self_export(const void *result, sysmon_emit_fn emit, void *ctx) {
+    const SelfResult *r = result;
+    SYSMON_SELF_METRICS(METRIC_EMIT)
+}
+
+static const Collector self_collector = {
+    .abi_version = COLLECTOR_ABI_VERSION,
+    .name = "self",
+    .title = "Monitor Overhead",
+    .result_size = sizeof(SelfResult),
+    .init = self_init,
+    .sample = self_sample,
+    .delta = self_delta,
+    .render = self_render,
+    .export = self_export,
+    .destroy = free,
+};
+
+/*
+ * Disk collector: throughput, IOPS and utilization per whole disk from
+ * /proc/diskstats. Partitions, loop and RAM devices are left out; whether
+ * a name is a disk is looked up in /sys/block once per name.
+ */
+#define DISK_MAX 32                     // disks in a result
+#define DISK_SCAN_MAX 256               // /proc/diskstats lines, partitions included
+
+typedef struct {
+    char name[32];
+    double read_kbs;
+    double write_kbs;
+    double reads;                       // per second
+    double writes;
+    double util_pct;                    // time with requests in flight
+} DiskRate;
+
+typedef struct {
+    int count;
+    DiskRate disks[DISK_MAX];
+    double read_kbs;                    // all disks
+    double write_kbs;
+} DiskResult;
+
+typedef struct {
+    char name[32];
+    int whole;
+} DiskKind;
+
+typedef struct {
+    DiskStats prev[DISK_SCAN_MAX];
+    DiskStats curr[DISK_SCAN_MAX];
+    int nprev;
+    int ncurr;
+    struct timespec prev_time;
+    struct timespec curr_time;
+    DiskKind kinds[DISK_SCAN_MAX];
+    int nkinds;
+    char *text;                         // /proc/diskstats, grown to fit and reused
+    size_t text_size;
+} DiskState;
+
+static int disk_read(DiskState *s, DiskStats *buf, int *count, struct timespec *when) {
+    if (sysmon_diskstats_read(&s->text, &s->text_size) < 0) {
+        return -1;
+    }
+    int n = sysmon_disk_parse(s->text, buf, DISK_SCAN_MAX);
+    clock_gettime(CLOCK_MONOTONIC, when);
+    *count = n < DISK_SCAN_MAX ? n : DISK_SCAN_MAX;
+    return 0;
+}
+
+static void disk_destroy(void *state) {
+    DiskState *s = state;
+    free(s->text);
+    free(s);
+}
+
+static int disk_init(void **state) {
+    DiskState *s = calloc(1, sizeof(DiskState));
+    if (!s) {
+        return -1;
+    }
+    if (disk_read(s, s->prev, &s->nprev, &s->prev_time) != 0) {
+        disk_destroy(s);
+        return -1;
+    }
+    *state = s;
+    return 0;
+}
+
+static int disk_sample(void *state) {
+    DiskState *s = state;
+    return disk_read(s, s->curr, &s->ncurr, &s->curr_time);
+}
+
+/*
+ * Whole disks are the entries of /sys/block ("/" in a name becomes "!")
+ */
+static int disk_is_whole(DiskState *s, const char *name) {
+    for (int i = 0; i < s->nkinds; i++) {
+        if (strcmp(s->kinds[i].name, name) == 0) {
+            return s->kinds[i].whole;
+        }
+    }
+
+    char path[64];
+    int whole = strncmp(name, "loop", 4) != 0 && strncmp(name, "ram", 3) != 0;
+    if (whole) {
+        int len = snprintf(path, sizeof(path), "/sys/block/%s", name);
+        for (int i = 11; i < len; i++) {
+            if (path[i] == '/') path[i] = '!';
+        }
+        whole = access(path, F_OK) == 0;
+    }
+    if (s->nkinds < DISK_SCAN_MAX) {
+        DiskKind *k = &s->kinds[s->nkinds++];
+        snprintf(k->name, sizeof(k->name), "%s", name);
+        k->whole = whole;
+    }
+    return whole;
+}
+
+static int disk_delta(void *state, void *result) {
+    DiskState *s = state;
+    DiskResult *r = result;
+
+    double elapsed = (s->curr_time.tv_sec - s->prev_time.tv_sec) +
+                     (s->curr_time.tv_nsec - s->prev_time.tv_nsec) / 1e9;
+    if (elapsed <= 0) {
+        return -1;
+    }
+
+    memset(r, 0, sizeof(*r));
+    for (int i = 0; i < s->ncurr && r->count < DISK_MAX; i++) {
+        const DiskStats *c = &s->curr[i];
+        if (!disk_is_whole(s, c->name)) {
+            continue;
+        }
+
+        // Same line as last time unless a device came or went
+        const DiskStats *p = NULL;
+        if (i < s->nprev && strcmp(s->prev[i].name, c->name) == 0) {
+            p = &s->prev[i];
+        }
+        for (int j = 0; !p && j < s->nprev; j++) {
+            if (strcmp(s->prev[j].name, c->name) == 0) {
+                p = &s->prev[j];
+            }
+        }
+        // New, or its counters were reset: report it from the next tick
+        if (!p || c->reads < p->reads || c->writes < p->writes ||
+            c->sectors_read < p->sectors_read || c->sectors_written < p->sectors_written ||
+            c->io_ms < p->io_ms) {
+            continue;
+        }
+        // Never used since boot (an empty card reader, say)
+        if (c->reads == 0 && c->writes == 0) {
+            continue;
+        }
+
+        DiskRate *d = &r->disks[r->count++];
+        memcpy(d->name, c->name, sizeof(d->name));
+        d->read_kbs = (c->sectors_read - p->sectors_read) / 2.0 / elapsed;
+        d->write_kbs = (c->sectors_written - p->sectors_written) / 2.0 / elapsed;
+        d->reads = (c->reads - p->reads) / elapsed;
+        d->writes = (c->writes - p->writes) / elapsed;
+        d->util_pct = (c->io_ms - p->io_ms) / (elapsed * 10.0);
+        if (d->util_pct > 100.0) {
+            d->util_pct = 100.0;
+        }
+        r->read_kbs += d->read_kbs;
+        r->write_kbs += d->write_kbs;
+    }
+
+    memcpy(s->prev, s->curr, (size_t)s->ncurr * sizeof(DiskStats));
+    s->nprev = s->ncurr;
+    s->prev_time = s->curr_time;
+    return 0;
+}
+
+static void disk_render(const void *result, FILE *out) {
+    const DiskResult *r = result;
+    char text[128];
+
+    render_box_top(out, "Disk I/O");
+    if (r->count == 0) {
+        render_text_row(out, "No disks with I/O since boot");
+    } else {
+        snprintf(text, sizeof(text), "%-12s %10s  %10s %7s %7s %6s",
+                 "Device", "Read kB/s", "Write kB/s", "r/s", "w/s", "Util");
+        render_text_row(out, text);
+        for (int i = 0; i < r->count; i++) {
+            const DiskRate *d = &r->disks[i];
+            snprintf(text, sizeof(text), "%-12.12s %10.1f  %10.1f %7.1f %7.1f %5.1f%%",
+                     d->name, d->read_kbs, d->write_kbs, d->reads, d->writes, d->util_pct);
+            render_text_row(out, text);
+        }
+    }
+    render_box_bottom(out);
+}
+
+static void disk_export(const void *result, sysmon_emit_fn emit, void *ctx) {
+    const DiskResult *r = result;
+    char name[64];
+
+    emit(ctx, "disk.read", r->read_kbs, "kB/s");
+    emit(ctx, "disk.write", r->write_kbs, "kB/s");
+    for (int i = 0; i < r->count; i++) {
+        const DiskRate *d = &r->disks[i];
+        snprintf(name, sizeof(name), "disk.%s.read", d->name);
+        emit(ctx, name, d->read_kbs, "kB/s");
+        snprintf(name, sizeof(name), "disk.%s.write", d->name);
+        emit(ctx, name, d->write_kbs, "kB/s");
+        snprintf(name, sizeof(name), "disk.%s.reads", d->name);
+        emit(ctx, name, d->reads, "/s");
+        snprintf(name, sizeof(name), "disk.%s.writes", d->name);
+        emit(ctx, name, d->writes, "/s");
+        snprintf(name, sizeof(name), "disk.%s.util", d->name);
+        emit(ctx, name, d->util_pct, "%");
+    }
+}
+
+static const Collector disk_collector = {
+    .abi_version = COLLECTOR_ABI_VERSION,
+    .name = "disk",
+    .title = "Disk I/O",
+    .result_size = sizeof(DiskResult),
+    .init = disk_init,
+    .sample = disk_sample,
+    .delta = disk_delta,
+    .render = disk_render,
+    .export = disk_export,
+    .destroy = disk_destroy,
+};
+
+/*
+ * Process collector: the busiest processes over the last interval. Metric
+ * names follow rank (proc.top1.cpu), so they are a fixed set, but every
+ * tick reads /proc/<pid>/stat of every process: several times the cost of
+ * all other collectors together even on a small host, and growing with
+ * the process count. So it only runs when asked for by name
+ * (-m proc,...), never in the default panel set.
+ */
+#define PROC_TOP 5
+
+typedef struct {
+    int pid;
+    char name[32];
+    double cpu_pct;                     // of one CPU
+    unsigned long long rss_kb;
+} ProcTop;
+
+typedef struct {
+    int processes;
+    int count;
+    ProcTop top[PROC_TOP];
+} ProcResult;
+
+static int proc_init(void **state) {
+    ProcTable *table = malloc(sizeof(ProcTable));
+    if (!table) {
+        return -1;
+    }
+    // The first scan is the baseline for CPU %
+    if (proctable_init(table, 0) != 0 || proctable_scan(table) < 0) {
+        proctable_free(table);
+        free(table);
+        return -1;
+    }
+    *state = table;
+    return 0;
+}
+
+static int proc_sample(void *state) {
+    return proctable_scan((ProcTable *)state) < 0 ? -1 : 0;
+}
+
+static int proc_delta(void *state, void *result) {
+    const ProcTable *table = state;
+    ProcResult *r = result;
+
+    // Partial selection: keep the PROC_TOP busiest, sorted, in one pass
+    memset(r, 0, sizeof(*r));
+    r->processes = table->count;
+    for (int i = 0; i < table->count; i++) {
+        const ProcEntry *e = &table->entries[i];
+        int pos = r->count;
+        while (pos > 0 && r->top[pos - 1].cpu_pct < e->cpu_pct) {
+            pos--;
+        }
+        if (pos >= PROC_TOP) {
+            continue;
+        }
+        int last = r->count < PROC_TOP ? r->count : PROC_TOP - 1;
+        memmove(&r->top[pos + 1], &r->top[pos], (size_t)(last - pos) * sizeof(ProcTop));
+        ProcTop *t = &r->top[pos];
+        t->pid = e->pid;
+        snprintf(t->name, sizeof(t->name), "%.31s", e->name);
+        t->cpu_pct = e->cpu_pct;
+        t->rss_kb = e->rss_kb;
+        if (r->count < PROC_TOP) {
+            r->count++;
+        }
+    }
+    return 0;
+}
+
+static void proc_render(const void *result, FILE *out) {
+    const ProcResult *r = result;
+    char text[128];
+
+    render_box_top(out, "Top Processes");
+    snprintf(text, sizeof(text), "%d processes", r->processes);
+    render_text_row(out, text);
+    snprintf(text, sizeof(text), "%-8s %-20s %8s %12s", "PID", "Name", "CPU %", "RSS");
+    render_text_row(out, text);
+    for (int i = 0; i < r->count; i++) {
+        const ProcTop *t = &r->top[i];
+        snprintf(text, sizeof(text), "%-8d %-20.20s %8.1f %9.1f MB",
+                 t->pid, t->name, t->cpu_pct, t->rss_kb / 1024.0);
+        render_text_row(out, text);
+    }
+    render_box_bottom(out);
+}
+
+static void proc_export(const void *result, sysmon_emit_fn emit, void *ctx) {
+    const ProcResult *r = result;
+    char name[64];
+
+    // Keyed by rank, not PID, so a long run exports a fixed set of names
+    emit(ctx, "proc.count", (double)r->processes, "");
+    for (int i = 0; i < r->count; i++) {
+        snprintf(name, sizeof(name), "proc.top%d.pid", i + 1);
+        emit(ctx, name, (double)r->top[i].pid, "");
+        snprintf(name, sizeof(name), "proc.top%d.cpu", i + 1);
+        emit(ctx, name, r->top[i].cpu_pct, "%");
+        snprintf(name, sizeof(name), "proc.top%d.rss", i + 1);
+        emit(ctx, name, (double)r->top[i].rss_kb, "kB");
+    }
+}
+
+static void proc_destroy(void *state) {
+    proctable_free((ProcTable *)state);
+    free(state);
+}
+
+static const Collector proc_collector = {
+    .abi_version = COLLECTOR_ABI_VERSION,
+    .name = "proc",
+    .title = "Top Processes",
+    .result_size = sizeof(ProcResult),
+    .init = proc_init,
+    .sample = proc_sample,
+    .delta = proc_delta,
+    .render = proc_render,
+    .export = proc_export,
+    .destroy = proc_destroy,
+};
+
+/*
+ * Register the collectors that ship with sysmonitor
+ */
+void collector_register_builtins(void) {
+    collector_register(&cpu_collector);
+    collector_register(&mem_collector);
+    collector_register(&load_collector);
+    collector_register(&virt_collector);
+    collector_register(&topo_collector);
+    collector_register(&disk_collector);
+    collector_register(&self_collector);
+    collector_register_on_demand(&proc_collector);
+}
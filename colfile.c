@@ -0,0 +1,742 @@
+/*
+ * Columnar recording export
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "recorder.h"
+#include "colfile.h"
+
+static const char *column_names[COL_COLUMNS] = { "time", "count", "min", "max", "avg" };
+
+const char *colfile_column_name(int column) {
+    return (column >= 0 && column < COL_COLUMNS) ? column_names[column] : NULL;
+}
+
+int colfile_column_index(const char *name) {
+    for (int c = 0; c < COL_COLUMNS; c++) {
+        if (strcmp(column_names[c], name) == 0) {
+            return c;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Bit packing, least significant bit first
+ */
+static int bits_needed(uint64_t v) {
+    int bits = 0;
+    while (v) {
+        bits++;
+        v >>= 1;
+    }
+    return bits;
+}
+
+static size_t packed_size(int n, int width) {
+    return ((size_t)n * (size_t)width + 7) / 8;
+}
+
+static void pack_bits(uint8_t *out, const uint64_t *v, int n, int width) {
+    size_t bit = 0;
+    memset(out, 0, packed_size(n, width));
+    for (int i = 0; i < n; i++) {
+        for (int done = 0; done < width; ) {
+            int shift = (int)(bit % 8);
+            int take = (width - done < 8 - shift) ? width - done : 8 - shift;
+            out[bit / 8] |= (uint8_t)(((v[i] >> done) & ((1u << take) - 1)) << shift);
+            done += take;
+            bit += (size_t)take;
+        }
+    }
+}
+
+static uint64_t unpack_bits(const uint8_t *in, size_t *bit, int width) {
+    uint64_t v = 0;
+    for (int done = 0; done < width; ) {
+        int shift = (int)(*bit % 8);
+        int take = (width - done < 8 - shift) ? width - done : 8 - shift;
+        v |= (uint64_t)((in[*bit / 8] >> shift) & ((1u << take) - 1)) << done;
+        done += take;
+        *bit += (size_t)take;
+    }
+    return v;
+}
+
+/*
+ * Encoding. Values are handled as 64-bit words: int64 for the time and
+ * count columns, IEEE bit patterns for the others, so RLE and dictionary
+ * encoding are exact for doubles too.
+ */
+typedef struct {
+    int64_t min_delta;
+    int delta_width;
+    int runs;
+    int ndict;
+    int dict_width;
+    uint64_t dict[256];
+} EncodingPlan;
+
+// Distinct values, or ndict = 0 once there are more than 256
+static void plan_dict(const uint64_t *v, int n, EncodingPlan *plan) {
+    int slots[512];
+    memset(slots, 0xff, sizeof(slots));
+    plan->ndict = 0;
+
+    for (int i = 0; i < n; i++) {
+        unsigned int h = (unsigned int)((v[i] * 0x9e3779b97f4a7c15ULL) >> 55);
+        while (slots[h] >= 0 && plan->dict[slots[h]] != v[i]) {
+            h = (h + 1) & 511;
+        }
+        if (slots[h] < 0) {
+            if (plan->ndict == 256) {
+                plan->ndict = 0;
+                return;
+            }
+            slots[h] = plan->ndict;
+            plan->dict[plan->ndict++] = v[i];
+        }
+    }
+    plan->dict_width = bits_needed((uint64_t)(plan->ndict - 1));
+}
+
+static int dict_index(const EncodingPlan *plan, uint64_t v) {
+    for (int i = 0; i < plan->ndict; i++) {
+        if (plan->dict[i] == v) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+static ColEncoding choose_encoding(const uint64_t *v, int n, int integer, EncodingPlan *plan, size_t *size) {
+    ColEncoding best = COL_ENC_PLAIN;
+    *size = (size_t)n * 8;
+
+    plan->runs = 1;
+    for (int i = 1; i < n; i++) {
+        if (v[i] != v[i - 1]) plan->runs++;
+    }
+    if ((size_t)plan->runs * 12 < *size) {
+        best = COL_ENC_RLE;
+        *size = (size_t)plan->runs * 12;
+    }
+
+    plan_dict(v, n, plan);
+    if (plan->ndict > 0) {
+        size_t dict_size = 2 + (size_t)plan->ndict * 8 + 1 + packed_size(n, plan->dict_width);
+        if (dict_size < *size) {
+            best = COL_ENC_DICT;
+            *size = dict_size;
+        }
+    }
+
+    if (integer && n > 1) {
+        int64_t min_delta = INT64_MAX, max_delta = INT64_MIN;
+        for (int i = 1; i < n; i++) {
+            int64_t d = (int64_t)v[i] - (int64_t)v[i - 1];
+            if (d < min_delta) min_delta = d;
+            if (d > max_delta) max_delta = d;
+        }
+        plan->min_delta = min_delta;
+        plan->delta_width = bits_needed((uint64_t)max_delta - (uint64_t)min_delta);
+        size_t delta_size = 8 + 8 + 1 + packed_size(n - 1, plan->delta_width);
+        if (delta_size < *size) {
+            best = COL_ENC_DELTA;
+            *size = delta_size;
+        }
+    }
+    return best;
+}
+
+static void encode(uint8_t *out, const uint64_t *v, int n, ColEncoding enc,
+                   const EncodingPlan *plan, uint64_t *scratch) {
+    switch (enc) {
+        case COL_ENC_PLAIN:
+            memcpy(out, v, (size_t)n * 8);
+            break;
+        case COL_ENC_RLE: {
+            int i = 0;
+            while (i < n) {
+                uint32_t run = 1;
+                while (i + (int)run < n && v[i + (int)run] == v[i]) run++;
+                memcpy(out, &run, 4);
+                memcpy(out + 4, &v[i], 8);
+                out += 12;
+                i += (int)run;
+            }
+            break;
+        }
+        case COL_ENC_DICT: {
+            uint16_t ndict = (uint16_t)plan->ndict;
+            memcpy(out, &ndict, 2);
+            memcpy(out + 2, plan->dict, (size_t)ndict * 8);
+            out[2 + ndict * 8] = (uint8_t)plan->dict_width;
+            for (int i = 0; i < n; i++) {
+                scratch[i] = (uint64_t)dict_index(plan, v[i]);
+            }
+            pack_bits(out + 3 + ndict * 8, scratch, n, plan->dict_width);
+            break;
+        }
+        case COL_ENC_DELTA:
+            memcpy(out, &v[0], 8);
+            memcpy(out + 8, &plan->min_delta, 8);
+            out[16] = (uint8_t)plan->delta_width;
+            for (int i = 1; i < n; i++) {
+                scratch[i - 1] = (v[i] - v[i - 1]) - (uint64_t)plan->min_delta;
+            }
+            pack_bits(out + 17, scratch, n - 1, plan->delta_width);
+            break;
+    }
+}
+
+/*
+ * Decode a chunk into n 64-bit words. Returns -1 if it does not fit its length.
+ */
+static int decode(const uint8_t *in, size_t len, int n, ColEncoding enc, uint64_t *v) {
+    switch (enc) {
+        case COL_ENC_PLAIN:
+            if (len < (size_t)n * 8) return -1;
+            memcpy(v, in, (size_t)n * 8);
+            return 0;
+        case COL_ENC_RLE: {
+            int i = 0;
+            size_t off = 0;
+            while (i < n) {
+                uint32_t run;
+                uint64_t value;
+                if (off + 12 > len) return -1;
+                memcpy(&run, in + off, 4);
+                memcpy(&value, in + off + 4, 8);
+                off += 12;
+                if (run == 0 || run > (uint32_t)(n - i)) return -1;
+                while (run--) v[i++] = value;
+            }
+            return 0;
+        }
+        case COL_ENC_DICT: {
+            uint16_t ndict;
+            if (len < 3) return -1;
+            memcpy(&ndict, in, 2);
+            if (ndict == 0 || len < 3 + (size_t)ndict * 8) return -1;
+            int width = in[2 + ndict * 8];
+            if (width > 8 || len < 3 + (size_t)ndict * 8 + packed_size(n, width)) return -1;
+            const uint8_t *packed = in + 3 + ndict * 8;
+            size_t bit = 0;
+            for (int i = 0; i < n; i++) {
+                uint64_t idx = unpack_bits(packed, &bit, width);
+                if (idx >= ndict) return -1;
+                memcpy(&v[i], in + 2 + idx * 8, 8);
+            }
+            return 0;
+        }
+        case COL_ENC_DELTA: {
+            int64_t min_delta;
+            if (len < 17) return -1;
+            memcpy(&v[0], in, 8);
+            memcpy(&min_delta, in + 8, 8);
+            int width = in[16];
+            if (width > 64 || len < 17 + packed_size(n - 1, width)) return -1;
+            size_t bit = 0;
+            for (int i = 1; i < n; i++) {
+                v[i] = v[i - 1] + unpack_bits(in + 17, &bit, width) + (uint64_t)min_delta;
+            }
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static double word_value(uint64_t w, int column) {
+    if (column == COL_TIME || column == COL_COUNT) {
+        return (double)(int64_t)w;
+    }
+    double d;
+    memcpy(&d, &w, sizeof(d));
+    return d;
+}
+
+/*
+ * Export state: one row buffer per metric, grown as rows arrive and
+ * flushed as a group of column chunks whenever it holds COL_CHUNK_ROWS.
+ * A full buffer costs 8 bytes per row and column, 160 KB in a rollup tier,
+ * so with thousands of metrics (per-CPU names on a large host) the buffers
+ * together are capped at COL_BUFFER_ROWS rows: past that every metric is
+ * flushed early and its buffer freed, trading shorter chunks for memory.
+ */
+#define COL_BUFFER_ROWS (1 << 20)       // 40 MB with all five columns
+#define COL_FIRST_ROWS 64
+
+typedef struct {
+    char name[REC_NAME_MAX];
+    char unit[REC_UNIT_MAX];
+    int rows;
+    int row_capacity;
+    uint64_t *cols[COL_COLUMNS];
+} ColMetric;
+
+typedef struct {
+    FILE *out;
+    int ncolumns;                       // COL_AVG only in the raw tier
+    ColMetric *metrics;
+    int nmetrics;
+    int capacity;
+    int *index;
+    int index_size;
+    ColChunkMeta *chunks;
+    int nchunks;
+    int chunk_capacity;
+    uint8_t *buf;                       // encoded chunk
+    uint64_t *scratch;
+    long row_capacity;                  // over all metrics, at most COL_BUFFER_ROWS
+    long long points;
+    int error;
+} ColWriter;
+
+static unsigned int hash_name(const char *s) {
+    unsigned int h = 2166136261u;
+    while (*s) {
+        h ^= (unsigned char)*s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static int column_in_tier(const ColWriter *w, int column) {
+    return w->ncolumns == COL_COLUMNS || column == COL_TIME || column == COL_AVG;
+}
+
+static int add_chunk(ColWriter *w, const ColChunkMeta *meta) {
+    if (w->nchunks == w->chunk_capacity) {
+        int cap = w->chunk_capacity ? w->chunk_capacity * 2 : 256;
+        ColChunkMeta *grown = realloc(w->chunks, (size_t)cap * sizeof(ColChunkMeta));
+        if (!grown) {
+            return -1;
+        }
+        w->chunks = grown;
+        w->chunk_capacity = cap;
+    }
+    w->chunks[w->nchunks++] = *meta;
+    return 0;
+}
+
+static void flush_metric(ColWriter *w, int id) {
+    ColMetric *m = &w->metrics[id];
+    int n = m->rows;
+    if (n == 0) {
+        return;
+    }
+
+    for (int c = 0; c < COL_COLUMNS; c++) {
+        if (!column_in_tier(w, c)) {
+            continue;
+        }
+
+        const uint64_t *v = m->cols[c];
+        EncodingPlan plan;
+        size_t size;
+        ColEncoding enc = choose_encoding(v, n, c == COL_TIME || c == COL_COUNT, &plan, &size);
+        encode(w->buf, v, n, enc, &plan, w->scratch);
+
+        ColChunkMeta meta;
+        memset(&meta, 0, sizeof(meta));
+        meta.offset = (uint64_t)ftell(w->out);
+        meta.length = (uint32_t)size;
+        meta.nvalues = (uint32_t)n;
+        meta.metric = (uint32_t)id;
+        meta.column = (uint8_t)c;
+        meta.encoding = (uint8_t)enc;
+        meta.first_ms = (int64_t)m->cols[COL_TIME][0];
+        meta.last_ms = (int64_t)m->cols[COL_TIME][n - 1];
+        meta.min = meta.max = word_value(v[0], c);
+        for (int i = 1; i < n; i++) {
+            double x = word_value(v[i], c);
+            if (x < meta.min) meta.min = x;
+            if (x > meta.max) meta.max = x;
+            if ((int64_t)m->cols[COL_TIME][i] < meta.first_ms) meta.first_ms = (int64_t)m->cols[COL_TIME][i];
+            if ((int64_t)m->cols[COL_TIME][i] > meta.last_ms) meta.last_ms = (int64_t)m->cols[COL_TIME][i];
+        }
+
+        if (fwrite(w->buf, 1, size, w->out) != size || add_chunk(w, &meta) != 0) {
+            w->error = 1;
+        }
+    }
+    m->rows = 0;
+}
+
+/*
+ * Flush every metric and free its row buffer
+ */
+static void release_rows(ColWriter *w) {
+    for (int i = 0; i < w->nmetrics; i++) {
+        flush_metric(w, i);
+        for (int c = 0; c < COL_COLUMNS; c++) {
+            free(w->metrics[i].cols[c]);
+            w->metrics[i].cols[c] = NULL;
+        }
+        w->metrics[i].row_capacity = 0;
+    }
+    w->row_capacity = 0;
+}
+
+/*
+ * Double a metric's row buffer, releasing all buffers first if that would
+ * pass COL_BUFFER_ROWS
+ */
+static int grow_rows(ColWriter *w, int id) {
+    ColMetric *m = &w->metrics[id];
+    int cap = m->row_capacity ? m->row_capacity * 2 : COL_FIRST_ROWS;
+
+    if (w->row_capacity + (cap - m->row_capacity) > COL_BUFFER_ROWS) {
+        release_rows(w);
+        cap = COL_FIRST_ROWS;
+    }
+    for (int c = 0; c < COL_COLUMNS; c++) {
+        if (!column_in_tier(w, c)) {
+            continue;
+        }
+        uint64_t *grown = realloc(m->cols[c], (size_t)cap * sizeof(uint64_t));
+        if (!grown) {
+            return -1;
+        }
+        m->cols[c] = grown;
+    }
+    w->row_capacity += cap - m->row_capacity;
+    m->row_capacity = cap;
+    return 0;
+}
+
+static int writer_rehash(ColWriter *w, int size) {
+    int *index = malloc((size_t)size * sizeof(int));
+    if (!index) {
+        return -1;
+    }
+    memset(index, 0xff, (size_t)size * sizeof(int));
+
+    for (int i = 0; i < w->nmetrics; i++) {
+        unsigned int slot = hash_name(w->metrics[i].name) & (unsigned int)(size - 1);
+        while (index[slot] >= 0) {
+            slot = (slot + 1) & (unsigned int)(size - 1);
+        }
+        index[slot] = i;
+    }
+
+    free(w->index);
+    w->index = index;
+    w->index_size = size;
+    return 0;
+}
+
+static int writer_metric(ColWriter *w, const char *name, const char *unit) {
+    unsigned int mask = (unsigned int)(w->index_size - 1);
+    unsigned int slot = hash_name(name) & mask;
+
+    while (w->index[slot] >= 0) {
+        if (strcmp(w->metrics[w->index[slot]].name, name) == 0) {
+            return w->index[slot];
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    if (w->nmetrics == w->capacity) {
+        int cap = w->capacity ? w->capacity * 2 : 64;
+        ColMetric *grown = realloc(w->metrics, (size_t)cap * sizeof(ColMetric));
+        if (!grown) {
+            return -1;
+        }
+        w->metrics = grown;
+        w->capacity = cap;
+    }
+
+    ColMetric *m = &w->metrics[w->nmetrics];
+    memset(m, 0, sizeof(*m));
+    snprintf(m->name, sizeof(m->name), "%s", name);
+    snprintf(m->unit, sizeof(m->unit), "%s", unit);
+    int id = w->nmetrics++;
+
+    // Keep the index at most half full
+    if (w->nmetrics * 2 > w->index_size) {
+        if (writer_rehash(w, w->index_size * 2) != 0) {
+            w->nmetrics--;
+            return -1;
+        }
+    } else {
+        w->index[slot] = id;
+    }
+    return id;
+}
+
+static int export_point(void *ctx, const char *name, const char *unit, const RecPoint *p) {
+    ColWriter *w = ctx;
+    int id = writer_metric(w, name, unit);
+    if (id < 0) {
+        w->error = 1;
+        return 1;
+    }
+
+    ColMetric *m = &w->metrics[id];
+    if (m->rows == m->row_capacity && grow_rows(w, id) != 0) {
+        w->error = 1;
+        return 1;
+    }
+    double avg = p->count ? p->sum / p->count : 0.0;
+    m->cols[COL_TIME][m->rows] = (uint64_t)p->t_ms;
+    memcpy(&m->cols[COL_AVG][m->rows], &avg, 8);
+    if (w->ncolumns == COL_COLUMNS) {
+        m->cols[COL_COUNT][m->rows] = p->count;
+        memcpy(&m->cols[COL_MIN][m->rows], &p->min, 8);
+        memcpy(&m->cols[COL_MAX][m->rows], &p->max, 8);
+    }
+    w->points++;
+
+    if (++m->rows == COL_CHUNK_ROWS) {
+        flush_metric(w, id);
+    }
+    return w->error;
+}
+
+long long colfile_export(const char *rec_dir, int tier, const char *out_path) {
+    const char *tier_name = recorder_tier_name(tier);
+    if (!tier_name) {
+        return -1;
+    }
+
+    ColWriter w;
+    memset(&w, 0, sizeof(w));
+    w.ncolumns = (tier == REC_TIER_RAW) ? 2 : COL_COLUMNS;
+    writer_rehash(&w, 512);
+    w.buf = malloc(COL_CHUNK_ROWS * 8 + 64);   // never larger than plain
+    w.scratch = malloc(COL_CHUNK_ROWS * sizeof(uint64_t));
+    w.out = fopen(out_path, "wb");
+    if (!w.index || !w.buf || !w.scratch || !w.out) {
+        w.error = 1;
+    } else {
+        ColFileHeader fh;
+        memset(&fh, 0, sizeof(fh));
+        memcpy(fh.magic, COL_FILE_MAGIC, sizeof(fh.magic));
+        fh.version = COL_VERSION;
+        fh.bucket_ms = (uint32_t)recorder_tier_bucket_ms(tier);
+        if (fwrite(&fh, sizeof(fh), 1, w.out) != 1 ||
+            recorder_read(rec_dir, tier, INT64_MIN, INT64_MAX, export_point, &w) < 0) {
+            w.error = 1;
+        }
+    }
+
+    if (!w.error) {
+        for (int i = 0; i < w.nmetrics; i++) {
+            flush_metric(&w, i);
+        }
+
+        ColFileTrailer trailer;
+        trailer.footer_offset = (uint64_t)ftell(w.out);
+        memcpy(trailer.magic, COL_FILE_MAGIC, sizeof(trailer.magic));
+
+        uint32_t count = (uint32_t)w.nmetrics;
+        fwrite(&count, sizeof(count), 1, w.out);
+        for (int i = 0; i < w.nmetrics; i++) {
+            uint8_t nl = (uint8_t)strlen(w.metrics[i].name);
+            uint8_t ul = (uint8_t)strlen(w.metrics[i].unit);
+            fwrite(&nl, 1, 1, w.out);
+            fwrite(w.metrics[i].name, 1, nl, w.out);
+            fwrite(&ul, 1, 1, w.out);
+            fwrite(w.metrics[i].unit, 1, ul, w.out);
+        }
+        count = (uint32_t)w.nchunks;
+        fwrite(&count, sizeof(count), 1, w.out);
+        fwrite(w.chunks, sizeof(ColChunkMeta), (size_t)w.nchunks, w.out);
+        if (fwrite(&trailer, sizeof(trailer), 1, w.out) != 1 || ferror(w.out)) {
+            w.error = 1;
+        }
+    }
+
+    if (w.out && fclose(w.out) != 0) {
+        w.error = 1;
+    }
+    for (int i = 0; i < w.nmetrics; i++) {
+        for (int c = 0; c < COL_COLUMNS; c++) {
+            free(w.metrics[i].cols[c]);
+        }
+    }
+    free(w.metrics);
+    free(w.index);
+    free(w.chunks);
+    free(w.buf);
+    free(w.scratch);
+
+    if (w.error) {
+        unlink(out_path);
+        return -1;
+    }
+    return w.points;
+}
+
+/*
+ * Footer of an open column file: metric index of `metric` and the chunk list
+ */
+static ColChunkMeta *read_footer(int fd, const char *metric, int *metric_id, uint32_t *nchunks) {
+    struct stat st;
+    ColFileTrailer trailer;
+
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)(sizeof(ColFileHeader) + sizeof(trailer)) ||
+        pread(fd, &trailer, sizeof(trailer), st.st_size - (off_t)sizeof(trailer)) != (ssize_t)sizeof(trailer) ||
+        memcmp(trailer.magic, COL_FILE_MAGIC, sizeof(trailer.magic)) != 0 ||
+        trailer.footer_offset > (uint64_t)st.st_size - sizeof(trailer)) {
+        return NULL;
+    }
+
+    size_t len = (size_t)((uint64_t)st.st_size - sizeof(trailer) - trailer.footer_offset);
+    uint8_t *footer = malloc(len ? len : 1);
+    if (!footer || pread(fd, footer, len, (off_t)trailer.footer_offset) != (ssize_t)len) {
+        free(footer);
+        return NULL;
+    }
+
+    size_t off = 4;
+    uint32_t nmetrics;
+    *metric_id = -1;
+    if (len < 4) {
+        free(footer);
+        return NULL;
+    }
+    memcpy(&nmetrics, footer, 4);
+    for (uint32_t i = 0; i < nmetrics; i++) {
+        if (off >= len || off + 1 + footer[off] >= len) break;
+        size_t nl = footer[off];
+        if (strlen(metric) == nl && memcmp(footer + off + 1, metric, nl) == 0) {
+            *metric_id = (int)i;
+        }
+        off += 1 + nl;
+        off += 1 + footer[off];
+    }
+
+    ColChunkMeta *chunks = NULL;
+    if (off + 4 <= len) {
+        memcpy(nchunks, footer + off, 4);
+        off += 4;
+        if (*nchunks <= (len - off) / sizeof(ColChunkMeta)) {
+            chunks = malloc((*nchunks ? *nchunks : 1) * sizeof(ColChunkMeta));
+            if (chunks) {
+                memcpy(chunks, footer + off, *nchunks * sizeof(ColChunkMeta));
+            }
+        }
+    }
+    free(footer);
+    return chunks;
+}
+
+static int read_chunk(int fd, const ColChunkMeta *meta, uint8_t **buf, size_t *buf_size, uint64_t *words) {
+    if (meta->length > *buf_size) {
+        uint8_t *grown = realloc(*buf, meta->length);
+        if (!grown) {
+            return -1;
+        }
+        *buf = grown;
+        *buf_size = meta->length;
+    }
+    if (meta->nvalues == 0 || meta->nvalues > COL_CHUNK_ROWS ||
+        pread(fd, *buf, meta->length, (off_t)meta->offset) != (ssize_t)meta->length) {
+        return -1;
+    }
+    return decode(*buf, meta->length, (int)meta->nvalues, (ColEncoding)meta->encoding, words);
+}
+
+long long colfile_read_column(const char *path, const char *metric, int column,
+                              int64_t from_ms, int64_t to_ms, double **values) {
+    *values = NULL;
+    if (column < 0 || column >= COL_COLUMNS) {
+        return -1;
+    }
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+
+    int metric_id;
+    uint32_t nchunks = 0;
+    ColChunkMeta *chunks = read_footer(fd, metric, &metric_id, &nchunks);
+    if (!chunks || metric_id < 0) {
+        free(chunks);
+        close(fd);
+        return -1;
+    }
+
+    long long count = 0, capacity = 0;
+    int found = 0, error = 0;
+    const ColChunkMeta *time_chunk = NULL;
+    uint8_t *buf = NULL;
+    size_t buf_size = 0;
+    uint64_t *words = malloc(COL_CHUNK_ROWS * sizeof(uint64_t));
+    uint64_t *times = malloc(COL_CHUNK_ROWS * sizeof(uint64_t));
+    if (!words || !times) {
+        error = 1;
+    }
+
+    for (uint32_t i = 0; i < nchunks && !error; i++) {
+        const ColChunkMeta *meta = &chunks[i];
+        if (meta->metric != (uint32_t)metric_id) {
+            continue;
+        }
+        if (meta->column == COL_TIME) {
+            time_chunk = meta;
+        }
+        if (meta->column != column) {
+            continue;
+        }
+        found = 1;
+        if (meta->last_ms < from_ms || meta->first_ms > to_ms) {
+            continue;
+        }
+
+        int partial = meta->first_ms < from_ms || meta->last_ms > to_ms;
+        if (read_chunk(fd, meta, &buf, &buf_size, words) != 0) {
+            error = 1;
+            break;
+        }
+        if (partial && column != COL_TIME) {
+            // Rows are cut by time, which lives in the group's time chunk
+            if (!time_chunk || time_chunk->nvalues != meta->nvalues ||
+                read_chunk(fd, time_chunk, &buf, &buf_size, times) != 0) {
+                error = 1;
+                break;
+            }
+        } else if (partial) {
+            memcpy(times, words, meta->nvalues * sizeof(uint64_t));
+        }
+
+        if (count + meta->nvalues > capacity) {
+            capacity = (count + meta->nvalues) * 2;
+            double *grown = realloc(*values, (size_t)capacity * sizeof(double));
+            if (!grown) {
+                error = 1;
+                break;
+            }
+            *values = grown;
+        }
+        for (uint32_t k = 0; k < meta->nvalues; k++) {
+            if (partial && ((int64_t)times[k] < from_ms || (int64_t)times[k] > to_ms)) {
+                continue;
+            }
+            (*values)[count++] = word_value(words[k], column);
+        }
+    }
+
+    free(buf);
+    free(words);
+    free(times);
+    free(chunks);
+    close(fd);
+
+    if (error || !found) {
+        free(*values);
+        *values = NULL;
+        return -1;
+    }
+    return count;
+}
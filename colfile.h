@@ -0,0 +1,81 @@
+/*
+ * Columnar recording export
+ *
+ * Converts one tier of a recording into a file laid out by column: for each
+ * metric the timestamps, counts and values are stored as separate chunks of
+ * up to COL_CHUNK_ROWS values. Each chunk picks the smallest of plain,
+ * delta + bit-packed, run-length or dictionary encoding and records min/max
+ * statistics, so a scan reads only the columns (and time ranges) it needs.
+ *
+ * Layout: ColFileHeader, chunk data, footer, ColFileTrailer. The footer is
+ * uint32 metric count, each name and unit as uint8 length + bytes, uint32
+ * chunk count and the ColChunkMeta array. Readers start from the trailer.
+ * A flush writes a metric's COL_TIME chunk first, then its other columns.
+ */
+
+#ifndef COLFILE_H
+#define COLFILE_H
+
+#include <stdint.h>
+
+#define COL_FILE_MAGIC "SYSMCOL1"
+#define COL_VERSION 1
+#define COL_CHUNK_ROWS 4096
+
+typedef enum {
+    COL_TIME,                           // ms since the epoch
+    COL_COUNT,                          // samples per bucket (rollup tiers only)
+    COL_MIN,                            // rollup tiers only
+    COL_MAX,                            // rollup tiers only
+    COL_AVG,                            // the sample itself in the raw tier
+    COL_COLUMNS
+} ColColumn;
+
+typedef enum {
+    COL_ENC_PLAIN,                      // 8 bytes per value
+    COL_ENC_DELTA,                      // first, min delta, width, bit-packed deltas
+    COL_ENC_RLE,                        // (uint32 run length, 8-byte value) pairs
+    COL_ENC_DICT                        // uint16 size, values, width, bit-packed indices
+} ColEncoding;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t bucket_ms;                 // of the exported tier, 0 for raw
+} ColFileHeader;
+
+typedef struct {
+    uint64_t offset;
+    uint32_t length;
+    uint32_t nvalues;
+    uint32_t metric;                    // index into the footer name list
+    uint8_t column;                     // ColColumn
+    uint8_t encoding;                   // ColEncoding
+    uint16_t reserved;
+    int64_t first_ms, last_ms;          // time range of the chunk's rows
+    double min, max;                    // value statistics
+} ColChunkMeta;
+
+typedef struct {
+    uint64_t footer_offset;
+    char magic[8];
+} ColFileTrailer;
+
+const char *colfile_column_name(int column);
+int colfile_column_index(const char *name);
+
+/*
+ * Export a recording tier; returns the number of points written or -1
+ */
+long long colfile_export(const char *rec_dir, int tier, const char *out_path);
+
+/*
+ * Decode one metric's column for the rows in [from_ms, to_ms] into a
+ * malloc'd array. Chunks outside the range are never read; the time chunk
+ * is decoded too only for chunks that straddle a range boundary.
+ * Returns the number of values, or -1 (no such metric/column, bad file).
+ */
+long long colfile_read_column(const char *path, const char *metric, int column,
+                              int64_t from_ms, int64_t to_ms, double **values);
+
+#endif
@@ -0,0 +1,386 @@
+/*
+ * Collector registry and plugin loading
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dlfcn.h>
+
+#include "collector.h"
+
+// Width of a panel in terminal columns, including the corners
+#define BOX_WIDTH 63
+
+typedef struct {
+    const Collector *ops;
+    void *state;
+    void *result;
+    int initialized;
+    int result_ok;
+} CollectorSlot;
+
+static CollectorSlot registry[MAX_COLLECTORS];
+static int registry_count = 0;
+
+// Every collector ever registered, running or not, so collector_select()
+// can bring back one it dropped earlier
+typedef struct {
+    const Collector *ops;
+    int on_demand;                      // only runs when collector_select() names it
+} CatalogEntry;
+
+static CatalogEntry catalog[MAX_COLLECTORS];
+static int catalog_count = 0;
+
+static int collector_valid(const Collector *c) {
+    if (!c || !c->name || !c->sample || !c->delta) {
+        return 0;
+    }
+    if (c->abi_version != COLLECTOR_ABI_VERSION) {
+        fprintf(stderr, "Collector '%s' built for ABI %d, expected %d\n",
+                c->name, c->abi_version, COLLECTOR_ABI_VERSION);
+        return 0;
+    }
+    return 1;
+}
+
+static const Collector *find_in_catalog(const char *name) {
+    for (int i = 0; i < catalog_count; i++) {
+        if (strcmp(catalog[i].ops->name, name) == 0) {
+            return catalog[i].ops;
+        }
+    }
+    return NULL;
+}
+
+static int add_to_catalog(const Collector *c, int on_demand) {
+    if (!collector_valid(c)) {
+        return -1;
+    }
+    if (find_in_catalog(c->name) || catalog_count >= MAX_COLLECTORS) {
+        return -1;
+    }
+    catalog[catalog_count].ops = c;
+    catalog[catalog_count].on_demand = on_demand;
+    catalog_count++;
+    return 0;
+}
+
+/*
+ * Add a collector to the registry; names must be unique
+ */
+int collector_register(const Collector *c) {
+    if (registry_count >= MAX_COLLECTORS || add_to_catalog(c, 0) != 0) {
+        return -1;
+    }
+
+    memset(&registry[registry_count], 0, sizeof(CollectorSlot));
+    registry[registry_count].ops = c;
+    registry_count++;
+    return 0;
+}
+
+int collector_count(void) {
+    return registry_count;
+}
+
+const Collector *collector_at(int index) {
+    if (index < 0 || index >= registry_count) {
+        return NULL;
+    }
+    return registry[index].ops;
+}
+
+const Collector *collector_find(const char *name) {
+    for (int i = 0; i < registry_count; i++) {
+        if (strcmp(registry[i].ops->name, name) == 0) {
+            return registry[i].ops;
+        }
+    }
+    return NULL;
+}
+
+int collector_register_on_demand(const Collector *c) {
+    return add_to_catalog(c, 1);
+}
+
+int collector_catalog_count(void) {
+    return catalog_count;
+}
+
+const Collector *collector_catalog_at(int index) {
+    if (index < 0 || index >= catalog_count) {
+        return NULL;
+    }
+    return catalog[index].ops;
+}
+
+/*
+ * Turn a name list into collectors, in order and without repeats; an
+ * empty list is the default set. Returns the count, or -1 for an unknown
+ * name or an empty result.
+ */
+static int resolve_names(const char *names, const Collector **chosen) {
+    int count = 0;
+
+    if (!names || *names == '\0') {
+        for (int i = 0; i < catalog_count; i++) {
+            if (!catalog[i].on_demand) {
+                chosen[count++] = catalog[i].ops;
+            }
+        }
+        return count ? count : -1;
+    }
+
+    char *list = strdup(names);
+    if (!list) {
+        return -1;
+    }
+
+    char *saveptr = NULL;
+    for (char *name = strtok_r(list, ",", &saveptr); name; name = strtok_r(NULL, ",", &saveptr)) {
+        const Collector *c = find_in_catalog(name);
+        if (!c) {
+            fprintf(stderr, "Error: Unknown collector '%s'\n", name);
+            free(list);
+            return -1;
+        }
+        // Naming one twice runs it once
+        int dup = 0;
+        for (int i = 0; i < count; i++) {
+            dup |= chosen[i] == c;
+        }
+        if (!dup && count < MAX_COLLECTORS) {
+            chosen[count++] = c;
+        }
+    }
+    free(list);
+
+    return count ? count : -1;
+}
+
+int collector_check(const char *names) {
+    const Collector *chosen[MAX_COLLECTORS];
+    return resolve_names(names, chosen) < 0 ? -1 : 0;
+}
+
+int collector_select(const char *names) {
+    const Collector *chosen[MAX_COLLECTORS];
+    CollectorSlot next[MAX_COLLECTORS];
+
+    int count = resolve_names(names, chosen);
+    if (count < 0) {
+        return -1;
+    }
+
+    // Collectors that stay keep their state, and with it their baselines
+    // and history; the rest are released
+    memset(next, 0, sizeof(next));
+    for (int i = 0; i < count; i++) {
+        next[i].ops = chosen[i];
+        for (int j = 0; j < registry_count; j++) {
+            if (registry[j].ops == chosen[i]) {
+                next[i] = registry[j];
+                registry[j].ops = NULL;
+                break;
+            }
+        }
+    }
+    for (int j = 0; j < registry_count; j++) {
+        CollectorSlot *slot = &registry[j];
+        if (!slot->ops) {
+            continue;
+        }
+        if (slot->initialized && slot->ops->destroy) {
+            slot->ops->destroy(slot->state);
+        }
+        free(slot->result);
+    }
+
+    memcpy(registry, next, sizeof(registry));
+    registry_count = count;
+    return 0;
+}
+
+/*
+ * dlopen a collector plugin and let it register its collectors
+ */
+int collector_load_plugin(const char *path) {
+    void *handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        fprintf(stderr, "Error loading plugin %s: %s\n", path, dlerror());
+        return -1;
+    }
+
+    int (*plugin_init)(int (*)(const Collector *));
+    *(void **)&plugin_init = dlsym(handle, "sysmon_plugin_init");
+    if (!plugin_init) {
+        fprintf(stderr, "Error: %s has no sysmon_plugin_init()\n", path);
+        dlclose(handle);
+        return -1;
+    }
+
+    // The handle is kept open for the life of the process; the registry
+    // points into the plugin's static data.
+    return plugin_init(collector_register);
+}
+
+/*
+ * Load every plugin listed in SYSMON_PLUGINS (colon-separated paths)
+ */
+int collector_load_plugins_from_env(void) {
+    const char *env = getenv("SYSMON_PLUGINS");
+    if (!env || *env == '\0') {
+        return 0;
+    }
+
+    char *paths = strdup(env);
+    if (!paths) {
+        return -1;
+    }
+
+    int failures = 0;
+    char *saveptr = NULL;
+    for (char *path = strtok_r(paths, ":", &saveptr); path; path = strtok_r(NULL, ":", &saveptr)) {
+        if (collector_load_plugin(path) != 0) {
+            failures++;
+        }
+    }
+
+    free(paths);
+    return failures ? -1 : 0;
+}
+
+/*
+ * Initialize every registered collector that has not been initialized yet
+ */
+int collectors_init_all(void) {
+    int failures = 0;
+
+    for (int i = 0; i < registry_count; i++) {
+        CollectorSlot *slot = &registry[i];
+        if (slot->initialized) {
+            continue;
+        }
+
+        slot->result = calloc(1, slot->ops->result_size ? slot->ops->result_size : 1);
+        if (!slot->result) {
+            failures++;
+            continue;
+        }
+        if (slot->ops->init && slot->ops->init(&slot->state) != 0) {
+            free(slot->result);
+            slot->result = NULL;
+            failures++;
+            continue;
+        }
+        slot->initialized = 1;
+    }
+
+    return failures ? -1 : 0;
+}
+
+/*
+ * Take one sample from every collector and compute its result
+ */
+void collectors_sample_all(void) {
+    for (int i = 0; i < registry_count; i++) {
+        CollectorSlot *slot = &registry[i];
+        slot->result_ok = slot->initialized &&
+                          slot->ops->sample(slot->state) == 0 &&
+                          slot->ops->delta(slot->state, slot->result) == 0;
+    }
+}
+
+const void *collector_result(int index) {
+    if (index < 0 || index >= registry_count) {
+        return NULL;
+    }
+    return registry[index].result;
+}
+
+int collector_result_ok(int index) {
+    if (index < 0 || index >= registry_count) {
+        return 0;
+    }
+    return registry[index].result_ok;
+}
+
+/*
+ * Release all collector state; registrations are kept
+ */
+void collectors_shutdown(void) {
+    for (int i = 0; i < registry_count; i++) {
+        CollectorSlot *slot = &registry[i];
+        if (slot->initialized && slot->ops->destroy) {
+            slot->ops->destroy(slot->state);
+        }
+        free(slot->result);
+        slot->state = NULL;
+        slot->result = NULL;
+        slot->initialized = 0;
+        slot->result_ok = 0;
+    }
+}
+
+/*
+ * Panel frame: "┌─ Title ────┐" padded to BOX_WIDTH columns
+ */
+void render_box_top(FILE *out, const char *title) {
+    int dashes = BOX_WIDTH - 5 - (int)strlen(title);
+
+    fprintf(out, "┌─ %s ", title);
+    for (int i = 0; i < dashes; i++) {
+        fputs("─", out);
+    }
+    fputs("┐\n", out);
+}
+
+void render_box_bottom(FILE *out) {
+    fputs("└", out);
+    for (int i = 0; i < BOX_WIDTH - 2; i++) {
+        fputs("─", out);
+    }
+    fputs("┘\n", out);
+}
+
+/*
+ * Display form of a metric value: "%" and "us" keep their unit, "kB" is
+ * shown in MB below 1 GB and in GB above, and plain counts lose their decimals
+ */
+int metric_format_value(char *buf, size_t size, double value, const char *unit) {
+    if (strcmp(unit, "%") == 0) {
+        return snprintf(buf, size, "%6.2f%%", value);
+    }
+    if (strcmp(unit, "kB") == 0) {
+        if (value < 1048576.0) {
+            return snprintf(buf, size, "%8.2f MB", value / 1024.0);
+        }
+        return snprintf(buf, size, "%8.2f GB", value / 1048576.0);
+    }
+    if (*unit) {
+        return snprintf(buf, size, "%9.1f %s", value, unit);
+    }
+    if (value == (double)(long long)value) {
+        return snprintf(buf, size, "%6lld", (long long)value);
+    }
+    return snprintf(buf, size, "%6.2f", value);
+}
+
+void render_metric_row(FILE *out, const char *label, double value, const char *unit, int show) {
+    char text[BOX_WIDTH];
+    char formatted[32];
+
+    if (show == METRIC_IF_NONZERO && value <= 0.1) {
+        return;
+    }
+    metric_format_value(formatted, sizeof(formatted), value, unit);
+    snprintf(text, sizeof(text), "%s:%*s%s", label,
+             20 - (int)strlen(label) > 1 ? 20 - (int)strlen(label) : 1, "", formatted);
+    render_text_row(out, text);
+}
+
+void render_text_row(FILE *out, const char *text) {
+    fprintf(out, "│ %-*.*s │\n", BOX_WIDTH - 4, BOX_WIDTH - 4, text);
+}
@@ -0,0 +1,104 @@
+/*
+ * Collector plugin interface
+ *
+ * A collector samples one subsystem and knows how to render and export what
+ * it measured. The monitor only talks to collectors through this vtable, so
+ * adding a metric means registering a new Collector, either built in or from
+ * a shared object loaded with collector_load_plugin().
+ *
+ * Plugin shared objects export:
+ *
+ *     int sysmon_plugin_init(int (*register_fn)(const Collector *));
+ *
+ * and call register_fn once per collector they provide. Collector structs
+ * must stay valid for the life of the process (static storage is fine).
+ */
+
+#ifndef COLLECTOR_H
+#define COLLECTOR_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#include "metric_schema.h"
+
+#define COLLECTOR_ABI_VERSION 1
+#define MAX_COLLECTORS 32
+
+// Receives one exported metric; unit may be "" for dimensionless values
+typedef void (*sysmon_emit_fn)(void *ctx, const char *name, double value, const char *unit);
+
+typedef struct Collector {
+    int abi_version;            // COLLECTOR_ABI_VERSION the collector was built against
+    const char *name;           // short id, e.g. "cpu"
+    const char *title;          // panel title, e.g. "CPU Usage"
+    size_t result_size;         // bytes of the result block filled by delta()
+
+    // Allocate private state and take any baseline sample needed for deltas
+    int (*init)(void **state);
+    // Read raw counters into state
+    int (*sample)(void *state);
+    // Turn the latest sample into a result block and advance the baseline
+    int (*delta)(void *state, void *result);
+    // Draw a result block as a panel
+    void (*render)(const void *result, FILE *out);
+    // Emit every metric of a result block
+    void (*export)(const void *result, sysmon_emit_fn emit, void *ctx);
+    void (*destroy)(void *state);
+} Collector;
+
+/*
+ * Registry
+ */
+int collector_register(const Collector *c);
+int collector_count(void);
+const Collector *collector_at(int index);
+const Collector *collector_find(const char *name);
+int collector_load_plugin(const char *path);
+
+// Known by name but only run when collector_select() asks for it
+int collector_register_on_demand(const Collector *c);
+
+// Every collector known by name, running or not
+int collector_catalog_count(void);
+const Collector *collector_catalog_at(int index);
+
+/*
+ * Run only the named collectors, in the order given ("cpu,mem,disk"),
+ * on-demand ones included; NULL or "" selects the default set again.
+ * Collectors that were already running keep their state, dropped ones are
+ * destroyed, and collectors_init_all() initializes the new ones. While the
+ * sampler runs, only the sampler thread may call this (see
+ * sampler_reconfigure()). Returns -1 and leaves the registry alone if a
+ * name is unknown.
+ */
+int collector_select(const char *names);
+// The same check without selecting anything; 0 if collector_select() would succeed
+int collector_check(const char *names);
+int collector_load_plugins_from_env(void);
+void collector_register_builtins(void);
+
+/*
+ * Running every registered collector. Results are kept per collector and
+ * are only valid when collector_result_ok() is true.
+ */
+int collectors_init_all(void);
+void collectors_sample_all(void);
+const void *collector_result(int index);
+int collector_result_ok(int index);
+void collectors_shutdown(void);
+
+// Panel frame shared by renderers so every box lines up
+void render_box_top(FILE *out, const char *title);
+void render_box_bottom(FILE *out);
+
+/*
+ * One "Label: value" panel row, the value formatted by its unit as in
+ * metric_schema.h. show is METRIC_ALWAYS or METRIC_IF_NONZERO.
+ */
+void render_metric_row(FILE *out, const char *label, double value, const char *unit, int show);
+// Free-form panel row, padded (or cut) to the box width
+void render_text_row(FILE *out, const char *text);
+int metric_format_value(char *buf, size_t size, double value, const char *unit);
+
+#endif
@@ -0,0 +1,77 @@
+/*
+ * Config file reload triggers: SIGHUP and inotify
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <libgen.h>
+#include <sys/inotify.h>
+
+#include "confwatch.h"
+
+static volatile sig_atomic_t hangup = 0;
+static int inotify_fd = -1;
+static char file_name[256];
+
+static void handle_hangup(int signum) {
+    (void)signum;
+    hangup = 1;
+}
+
+int confwatch_start(const char *path) {
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_hangup;
+    sigaction(SIGHUP, &sa, NULL);
+
+    // dirname() and basename() may modify their argument
+    char dir[512], base[512];
+    snprintf(dir, sizeof(dir), "%s", path);
+    snprintf(base, sizeof(base), "%s", path);
+    snprintf(file_name, sizeof(file_name), "%s", basename(base));
+
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0) {
+        return -1;
+    }
+    if (inotify_add_watch(inotify_fd, dirname(dir), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        close(inotify_fd);
+        inotify_fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+int confwatch_changed(void) {
+    int changed = hangup;
+    hangup = 0;
+
+    if (inotify_fd < 0) {
+        return changed;
+    }
+
+    // Drain every queued event; other files in the directory are ignored
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t n;
+    while ((n = read(inotify_fd, buf, sizeof(buf))) > 0) {
+        for (char *p = buf; p < buf + n; ) {
+            const struct inotify_event *ev = (const struct inotify_event *)p;
+            if (ev->len > 0 && strcmp(ev->name, file_name) == 0) {
+                changed = 1;
+            }
+            p += sizeof(struct inotify_event) + ev->len;
+        }
+    }
+    return changed;
+}
+
+void confwatch_stop(void) {
+    signal(SIGHUP, SIG_DFL);
+    if (inotify_fd >= 0) {
+        close(inotify_fd);
+        inotify_fd = -1;
+    }
+}
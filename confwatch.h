@@ -0,0 +1,25 @@
+/*
+ * Noticing config file changes
+ *
+ * A running monitor re-reads its config file on SIGHUP or as soon as the
+ * file is rewritten. The directory is watched with inotify rather than the
+ * file, so editors that save by writing a new file and renaming it over
+ * the old one are noticed as well. Nothing here blocks: the sampling loops
+ * ask confwatch_changed() once per snapshot.
+ */
+
+#ifndef CONFWATCH_H
+#define CONFWATCH_H
+
+/*
+ * Catch SIGHUP and watch path. Returns 0, or -1 if the file cannot be
+ * watched; SIGHUP still works then.
+ */
+int confwatch_start(const char *path);
+
+// 1 once for every SIGHUP or batch of changes since the last call
+int confwatch_changed(void);
+
+void confwatch_stop(void);
+
+#endif
@@ -0,0 +1,125 @@
+/*
+ * Cached CPU counters for instant one-shot answers
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <errno.h>
+
+#include "cpucache.h"
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;                   // SYSMON_API_VERSION of the writer
+    int64_t taken_ns;                   // CLOCK_BOOTTIME
+    CPUStats stats;
+} CPUCacheFile;
+
+static int64_t last_store_ns = 0;       // CLOCK_BOOTTIME of the last store
+
+static int64_t boottime_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_BOOTTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void cache_path(char *buf, size_t size) {
+    const char *env = getenv("SYSMON_CACHE");
+    const char *runtime = getenv("XDG_RUNTIME_DIR");
+
+    if (env && *env) {
+        snprintf(buf, size, "%s", env);
+    } else if (runtime && *runtime) {
+        snprintf(buf, size, "%s/sysmon-cpu.cache", runtime);
+    } else {
+        snprintf(buf, size, "/tmp/sysmon-%u-cpu.cache", (unsigned int)getuid());
+    }
+}
+
+int cpucache_store(const CPUStats *stats) {
+    CPUCacheFile file;
+    char path[512], tmp[528];
+
+    int64_t now = boottime_ns();
+    if (last_store_ns && now - last_store_ns < CPUCACHE_MIN_STORE_MS * 1000000LL) {
+        return 0;
+    }
+
+    memset(&file, 0, sizeof(file));
+    file.magic = CPUCACHE_MAGIC;
+    file.version = SYSMON_API_VERSION;
+    file.stats = *stats;
+    file.taken_ns = now;
+
+    cache_path(path, sizeof(path));
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    // A leftover temp file keeps its old mode; the reader insists on this one
+    if (fchmod(fd, 0644) != 0) {
+        close(fd);
+        return -1;
+    }
+    ssize_t n = write(fd, &file, sizeof(file));
+    close(fd);
+    if (n != (ssize_t)sizeof(file) || rename(tmp, path) != 0) {
+        unlink(tmp);
+        return -1;
+    }
+    last_store_ns = now;
+    return 0;
+}
+
+int cpucache_load(CPUStats *stats, int max_age_ms, int *age_ms) {
+    CPUCacheFile file;
+    char path[512];
+
+    cache_path(path, sizeof(path));
+    int fd = open(path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+
+    // In a shared /tmp another user could have made the file first and keep
+    // it looking fresh; only trust one that is ours and only we can write
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_uid != getuid() ||
+        (st.st_mode & (S_IWGRP | S_IWOTH)) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    ssize_t n;
+    do {
+        n = read(fd, &file, sizeof(file));
+    } while (n < 0 && errno == EINTR);
+    close(fd);
+
+    if (n != (ssize_t)sizeof(file) || file.magic != CPUCACHE_MAGIC ||
+        file.version != SYSMON_API_VERSION) {
+        return -1;
+    }
+    int64_t age = (boottime_ns() - file.taken_ns) / 1000000;
+    if (age < 0 || age > max_age_ms) {
+        return -1;
+    }
+
+    *stats = file.stats;
+    *age_ms = (int)age;
+    return 0;
+}
+
+void cpucache_remove(void) {
+    char path[512];
+    cache_path(path, sizeof(path));
+    unlink(path);
+    last_store_ns = 0;
+}
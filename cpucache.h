@@ -0,0 +1,52 @@
+/*
+ * Cached CPU counters for instant one-shot answers
+ *
+ * CPU usage is a difference of two /proc/stat readings, so a one-shot
+ * "-m cpu" has to wait between them. A running recorder (-R or -S)
+ * publishes the counters its sampler read for each snapshot, and a
+ * one-shot reader uses them as the first reading and answers at once.
+ *
+ * The cache is a small file replaced with rename(), so a reader never
+ * sees half of one. Stores closer together than CPUCACHE_MIN_STORE_MS are
+ * dropped, which keeps a fast recorder from rewriting it on every tick;
+ * the file is then up to that much older than it could be. The path is
+ * $SYSMON_CACHE if set, otherwise $XDG_RUNTIME_DIR/sysmon-cpu.cache,
+ * otherwise /tmp/sysmon-<uid>-cpu.cache.
+ * Age is measured on CLOCK_BOOTTIME, which keeps counting through suspend.
+ * The reader only trusts a regular file owned by its own user that nobody
+ * else can write, so another user cannot plant one in a shared /tmp.
+ * A cache from a previous boot can still look recent; its counters are
+ * then ahead of /proc/stat, which sysmon_cpu_usage() reports, and the
+ * caller measures instead.
+ */
+
+#ifndef CPUCACHE_H
+#define CPUCACHE_H
+
+#include "libsysmon.h"
+
+#define CPUCACHE_MAGIC 0x43505553u     // "SUPC"
+
+// Older caches describe too long a window to pass for "current"
+#define CPUCACHE_MAX_AGE_MS 5000
+
+// Replace the file at most this often
+#define CPUCACHE_MIN_STORE_MS 50
+
+/*
+ * Publish counters the caller already read, e.g. a snapshot's. Returns 0,
+ * also when the store was skipped as too soon after the last one, or -1
+ * if the file could not be written.
+ */
+int cpucache_store(const CPUStats *stats);
+
+/*
+ * The cached counters if they are at most max_age_ms old; their age is
+ * stored in age_ms. Returns -1 when there is no usable cache.
+ */
+int cpucache_load(CPUStats *stats, int max_age_ms, int *age_ms);
+
+// Remove the cache when the recorder stops
+void cpucache_remove(void);
+
+#endif
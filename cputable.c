@@ -0,0 +1,297 @@
+/*
+ * Hotplug-aware per-CPU table
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <ctype.h>
+#include <errno.h>
+
+#include "cputable.h"
+
+#define CPUTABLE_ONLINE_PATH "/sys/devices/system/cpu/online"
+
+// online flag bit set while a new mask is being applied
+#define ONLINE_NEXT 2
+
+/*
+ * Make room for CPU ids below `need`. Only called when the topology shows
+ * an id we have not seen, never on a steady-state tick.
+ */
+static int grow(CPUTable *table, int need) {
+    if (need <= table->capacity) {
+        return 0;
+    }
+    int capacity = table->capacity ? table->capacity : 64;
+    while (capacity < need) {
+        capacity *= 2;
+    }
+
+    CPUEntry *cpus = realloc(table->cpus, (size_t)capacity * sizeof(CPUEntry));
+    if (!cpus) {
+        return -1;
+    }
+    table->cpus = cpus;
+    memset(cpus + table->capacity, 0, (size_t)(capacity - table->capacity) * sizeof(CPUEntry));
+    for (int i = table->capacity; i < capacity; i++) {
+        cpus[i].cpu = i;
+        cpus[i].package = cpus[i].core = cpus[i].l3 = -1;
+    }
+
+    CPUSample *scratch = realloc(table->scratch, (size_t)capacity * sizeof(CPUSample));
+    if (!scratch) {
+        return -1;
+    }
+    table->scratch = scratch;
+    table->capacity = capacity;
+    return 0;
+}
+
+/*
+ * Read the online file, e.g. "0-3,6,8-11". Returns its length, or -1.
+ */
+static int read_online(char *buf, size_t size) {
+    int fd = open(CPUTABLE_ONLINE_PATH, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    ssize_t n;
+    do {
+        n = read(fd, buf, size - 1);
+    } while (n < 0 && errno == EINTR);
+    close(fd);
+    if (n <= 0) {
+        return -1;
+    }
+    buf[n] = '\0';
+    return (int)n;
+}
+
+/*
+ * First integer in a small sysfs file, or -1
+ */
+static int read_sysfs_int(const char *path) {
+    char buf[64];
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    ssize_t n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0 || !isdigit((unsigned char)buf[0])) {
+        return -1;
+    }
+    buf[n] = '\0';
+    return (int)strtol(buf, NULL, 10);
+}
+
+/*
+ * Package, core and L3 ids of one CPU. The L3 "id" file is fairly new;
+ * older kernels only list the CPUs sharing the cache, whose first CPU
+ * names the domain just as well. Without an L3 the package stands in.
+ */
+static void read_topology(CPUEntry *e) {
+    char path[128];
+
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", e->cpu);
+    e->package = read_sysfs_int(path);
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/core_id", e->cpu);
+    e->core = read_sysfs_int(path);
+
+    e->l3 = -1;
+    for (int i = 0; i < 10; i++) {
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%d/level", e->cpu, i);
+        int level = read_sysfs_int(path);
+        if (level < 0) {
+            break;
+        }
+        if (level != 3) {
+            continue;
+        }
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%d/id", e->cpu, i);
+        e->l3 = read_sysfs_int(path);
+        if (e->l3 < 0) {
+            snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%d/shared_cpu_list", e->cpu, i);
+            e->l3 = read_sysfs_int(path);
+        }
+        break;
+    }
+    if (e->l3 < 0) {
+        e->l3 = e->package;
+    }
+    e->topo_read = 1;
+}
+
+/*
+ * Mark the CPUs of a range list with ONLINE_NEXT, growing as needed
+ */
+static int mark_ranges(CPUTable *table, const char *text) {
+    const char *p = text;
+
+    while (isdigit((unsigned char)*p)) {
+        char *end;
+        long first = strtol(p, &end, 10);
+        long last = first;
+        if (*end == '-') {
+            p = end + 1;
+            last = strtol(p, &end, 10);
+        }
+        if (last < first || last > 1 << 20) {
+            return -1;
+        }
+        if (grow(table, (int)last + 1) != 0) {
+            return -1;
+        }
+        for (long id = first; id <= last; id++) {
+            table->cpus[id].online |= ONLINE_NEXT;
+        }
+        p = (*end == ',') ? end + 1 : end;
+    }
+    return 0;
+}
+
+/*
+ * Swap in the marked set. CPUs whose state flipped lose their baseline.
+ */
+static void apply_marks(CPUTable *table) {
+    table->online = 0;
+    for (int i = 0; i < table->capacity; i++) {
+        CPUEntry *e = &table->cpus[i];
+        int next = (e->online & ONLINE_NEXT) != 0;
+        if (next != (e->online & 1)) {
+            e->have_prev = 0;
+            e->delta_ok = 0;
+            e->topo_read = 0;
+        }
+        e->online = next;
+        table->online += next;
+        if (next && !e->topo_read) {
+            read_topology(e);
+        }
+    }
+}
+
+int cputable_init(CPUTable *table) {
+    memset(table, 0, sizeof(*table));
+    if (grow(table, 64) != 0) {
+        cputable_free(table);
+        return -1;
+    }
+    // Baseline for the first delta
+    if (cputable_update(table) < 0) {
+        cputable_free(table);
+        return -1;
+    }
+    table->topology_changes = 0;
+    return 0;
+}
+
+void cputable_free(CPUTable *table) {
+    free(table->cpus);
+    free(table->scratch);
+    free(table->stat_text);
+    memset(table, 0, sizeof(*table));
+}
+
+int cputable_update(CPUTable *table) {
+    char mask[sizeof(table->mask_text)];
+    int changed = 0;
+
+    // The mask text is tiny; compare it instead of parsing it every tick
+    table->have_mask = read_online(mask, sizeof(mask)) > 0;
+    if (table->have_mask && strcmp(mask, table->mask_text) != 0) {
+        if (mark_ranges(table, mask) != 0) {
+            return -1;
+        }
+        apply_marks(table);
+        memcpy(table->mask_text, mask, sizeof(mask));
+        changed = 1;
+    }
+
+    if (sysmon_stat_read(&table->stat_text, &table->stat_size) < 0) {
+        return -1;
+    }
+    int n = sysmon_cpu_parse(table->stat_text, &table->all, table->scratch, table->capacity);
+    if (n > table->capacity) {
+        if (grow(table, n) != 0) {
+            return -1;
+        }
+        n = sysmon_cpu_parse(table->stat_text, &table->all, table->scratch, table->capacity);
+    }
+    if (n < 0) {
+        return -1;
+    }
+    if (n > table->capacity) {
+        n = table->capacity;
+    }
+
+    // Without the online file (old kernels, some containers), what
+    // /proc/stat lists is what is online
+    if (!table->have_mask) {
+        for (int i = 0; i < n; i++) {
+            if (grow(table, table->scratch[i].cpu + 1) != 0) {
+                return -1;
+            }
+            table->cpus[table->scratch[i].cpu].online |= ONLINE_NEXT;
+        }
+        for (int i = 0; i < table->capacity && !changed; i++) {
+            changed = ((table->cpus[i].online & ONLINE_NEXT) != 0) != (table->cpus[i].online & 1);
+        }
+        apply_marks(table);
+    }
+
+    memset(&table->sum, 0, sizeof(table->sum));
+    table->measured = 0;
+    for (int i = 0; i < table->capacity; i++) {
+        table->cpus[i].delta_ok = 0;
+        table->cpus[i].sampled = 0;
+    }
+
+    for (int i = 0; i < n; i++) {
+        const CPUSample *s = &table->scratch[i];
+        if (s->cpu < 0 || s->cpu >= table->capacity) {
+            continue;
+        }
+        CPUEntry *e = &table->cpus[s->cpu];
+        if (!e->online) {
+            continue;
+        }
+        e->sampled = 1;
+        if (!e->have_prev) {
+            e->prev = s->stats;
+            e->have_prev = 1;
+            continue;
+        }
+
+        // A reset CPU gives no delta this time and starts over from here
+        e->delta_ok = sysmon_cpu_delta(&e->prev, &s->stats, &e->delta) == 0;
+        e->prev = s->stats;
+        if (!e->delta_ok) {
+            continue;
+        }
+
+#define CPU_FIELD_SUM(field) table->sum.field += e->delta.field;
+        SYSMON_CPU_FIELDS(CPU_FIELD_SUM)
+#undef CPU_FIELD_SUM
+        table->measured++;
+    }
+    // An online CPU missing from /proc/stat (mid-hotplug) starts over too
+    for (int i = 0; i < table->capacity; i++) {
+        if (!table->cpus[i].sampled) {
+            table->cpus[i].have_prev = 0;
+        }
+    }
+
+    // Same totals as libsysmon: guest time is already in user and nice
+    table->sum.active = table->sum.user + table->sum.nice + table->sum.system +
+                        table->sum.irq + table->sum.softirq;
+    table->sum.total = table->sum.active + table->sum.idle + table->sum.iowait + table->sum.steal;
+
+    if (changed) {
+        table->topology_changes++;
+    }
+    return changed;
+}
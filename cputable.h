@@ -0,0 +1,64 @@
+/*
+ * Hotplug-aware per-CPU table
+ *
+ * Keeps one entry per CPU id, indexed directly by id, so data follows the
+ * CPU rather than its line position in /proc/stat. The online mask from
+ * /sys/devices/system/cpu/online is re-read every update but only parsed
+ * when its text changes; the arrays are reallocated only when a CPU id
+ * beyond the current capacity appears. A CPU that goes offline keeps its
+ * slot, and one that comes (back) online takes a fresh baseline before it
+ * reports a delta. Package, core and L3 cache ids come from sysfs and are
+ * read when a CPU comes online, not on every update.
+ *
+ * The sampler keeps one table for all collectors and updates it at most
+ * once per tick (sampler_cpu_table()), so the online mask and /proc/stat
+ * are read once however many collectors look at CPUs.
+ */
+
+#ifndef CPUTABLE_H
+#define CPUTABLE_H
+
+#include "libsysmon.h"
+
+typedef struct {
+    int cpu;
+    int online;
+    int sampled;                        // listed in /proc/stat this update
+    int have_prev;                      // prev holds a baseline
+    int delta_ok;                       // delta covers the last interval
+    CPUStats prev;
+    CPUStats delta;
+
+    // From /sys/devices/system/cpu/cpuN; -1 where the kernel does not say
+    int topo_read;
+    int package;                        // topology/physical_package_id
+    int core;                           // topology/core_id, unique per package
+    int l3;                             // id of the L3 cache shared with other CPUs
+} CPUEntry;
+
+typedef struct {
+    CPUEntry *cpus;                     // indexed by CPU id
+    int capacity;                       // slots in cpus and scratch
+    CPUSample *scratch;                 // parse buffer for /proc/stat
+    char *stat_text;                    // /proc/stat as last read, grown to fit
+    size_t stat_size;
+    int online;                         // CPUs online now
+    int measured;                       // CPUs with a delta this interval
+    unsigned long topology_changes;     // online mask changes seen since init
+    int have_mask;                      // the online file is readable
+    char mask_text[256];                // last online file contents
+    CPUStats sum;                       // deltas summed over measured CPUs
+    CPUStats all;                       // the aggregate "cpu" line as last read
+} CPUTable;
+
+int cputable_init(CPUTable *table);
+void cputable_free(CPUTable *table);
+
+/*
+ * Read the online mask and /proc/stat and advance every CPU's delta.
+ * Returns 1 if the topology changed since the last call, 0 if not, -1 on
+ * failure.
+ */
+int cputable_update(CPUTable *table);
+
+#endif
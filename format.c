@@ -0,0 +1,107 @@
+/*
+ * Text output formats for exported metrics
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "format.h"
+
+static const char *format_names[] = { "json", "csv", "prom" };
+
+int format_parse(const char *name) {
+    for (int i = 0; i < (int)(sizeof(format_names) / sizeof(format_names[0])); i++) {
+        if (strcmp(name, format_names[i]) == 0) {
+            return i;
+        }
+    }
+    // Accept the long spelling as well
+    if (strcmp(name, "prometheus") == 0) {
+        return FORMAT_PROM;
+    }
+    return -1;
+}
+
+const char *format_name(OutputFormat format) {
+    return format_names[format];
+}
+
+void format_init(Formatter *f, FILE *out, OutputFormat format) {
+    memset(f, 0, sizeof(*f));
+    f->out = out;
+    f->format = format;
+}
+
+void format_begin(Formatter *f, const struct timespec *taken) {
+    f->time_ms = (int64_t)taken->tv_sec * 1000 + taken->tv_nsec / 1000000;
+    f->fields = 0;
+
+    if (f->format == FORMAT_JSON) {
+        fprintf(f->out, "{\"time_ms\":%lld", (long long)f->time_ms);
+    } else if (f->format == FORMAT_CSV && !f->header_done) {
+        fputs("time_ms,metric,value,unit\n", f->out);
+        f->header_done = 1;
+    }
+}
+
+/*
+ * Prometheus metric name: sysmon_ prefix, [a-zA-Z0-9_] only, unit suffix
+ */
+static void prom_name(char *buf, size_t size, const char *name, const char *unit) {
+    const char *suffix = "";
+    if (strcmp(unit, "%") == 0) suffix = "_percent";
+    else if (strcmp(unit, "kB") == 0) suffix = "_kilobytes";
+    else if (strcmp(unit, "us") == 0) suffix = "_microseconds";
+
+    int n = snprintf(buf, size, "sysmon_%s%s", name, suffix);
+    if (n >= (int)size) n = (int)size - 1;
+    for (int i = 7; i < n; i++) {
+        char c = buf[i];
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'))) {
+            buf[i] = '_';
+        }
+    }
+}
+
+void format_emit(void *ctx, const char *name, double value, const char *unit) {
+    Formatter *f = ctx;
+    char prom[160];
+
+    switch (f->format) {
+        case FORMAT_JSON:
+            // JSON has no NaN or infinity
+            if (isfinite(value)) {
+                fprintf(f->out, ",\"%s\":%.10g", name, value);
+            } else {
+                fprintf(f->out, ",\"%s\":null", name);
+            }
+            break;
+        case FORMAT_CSV:
+            fprintf(f->out, "%lld,%s,%.10g,%s\n", (long long)f->time_ms, name, value, unit);
+            break;
+        case FORMAT_PROM:
+            prom_name(prom, sizeof(prom), name, unit);
+            fprintf(f->out, "# TYPE %s gauge\n", prom);
+            if (isfinite(value)) {
+                fprintf(f->out, "%s %.10g %lld\n", prom, value, (long long)f->time_ms);
+            } else {
+                fprintf(f->out, "%s NaN %lld\n", prom, (long long)f->time_ms);
+            }
+            break;
+    }
+    f->fields++;
+}
+
+void format_end(Formatter *f) {
+    if (f->format == FORMAT_JSON) {
+        fputs("}\n", f->out);
+    }
+    fflush(f->out);
+}
+
+void format_snapshot(Formatter *f, const Snapshot *snap) {
+    format_begin(f, &snap->taken);
+    snapshot_export(snap, format_emit, f);
+    format_end(f);
+}
@@ -0,0 +1,46 @@
+/*
+ * Text output formats for exported metrics
+ *
+ * A Formatter is a sysmon_emit_fn sink: anything that can export metrics
+ * (a snapshot, a single collector) can be printed as JSON, CSV or the
+ * Prometheus text format without knowing any metric by name. Names and
+ * units come from the collectors, which take them from metric_schema.h.
+ *
+ *   json  one object per sample: {"time_ms":...,"cpu.active":2.5,...}
+ *   csv   time_ms,metric,value,unit rows; the header is printed once
+ *   prom  "# TYPE" and sample lines, names like sysmon_cpu_active_percent
+ */
+
+#ifndef FORMAT_H
+#define FORMAT_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "sampler.h"
+
+typedef enum {
+    FORMAT_JSON,
+    FORMAT_CSV,
+    FORMAT_PROM
+} OutputFormat;
+
+typedef struct {
+    FILE *out;
+    OutputFormat format;
+    int64_t time_ms;
+    int fields;                         // metrics written for the current sample
+    int header_done;                    // CSV header already printed
+} Formatter;
+
+// "json", "csv" or "prom"; -1 for anything else
+int format_parse(const char *name);
+const char *format_name(OutputFormat format);
+
+void format_init(Formatter *f, FILE *out, OutputFormat format);
+void format_begin(Formatter *f, const struct timespec *taken);
+void format_emit(void *ctx, const char *name, double value, const char *unit);
+void format_end(Formatter *f);
+void format_snapshot(Formatter *f, const Snapshot *snap);
+
+#endif
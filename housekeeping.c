@@ -0,0 +1,131 @@
+/*
+ * Keeping the monitor out of the way of what it monitors
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+#include "housekeeping.h"
+#include "sampler.h"
+
+// From linux/ioprio.h, which not every libc ships
+#define IOPRIO_CLASS_SHIFT 13
+#define IOPRIO_CLASS_IDLE  3
+#define IOPRIO_WHO_PROCESS 1
+
+#ifndef MCL_ONFAULT
+#define MCL_ONFAULT 4
+#endif
+
+void write_log(const char *mode, const char *details);
+
+int housekeeping_parse_cpus(const char *list, cpu_set_t *set) {
+    const char *p = list;
+
+    CPU_ZERO(set);
+    while (isdigit((unsigned char)*p)) {
+        char *end;
+        long first = strtol(p, &end, 10);
+        long last = first;
+        if (*end == '-') {
+            last = strtol(end + 1, &end, 10);
+        }
+        if (last < first || last >= CPU_SETSIZE) {
+            return -1;
+        }
+        for (long cpu = first; cpu <= last; cpu++) {
+            CPU_SET(cpu, set);
+        }
+        if (*end == '\0') {
+            return 0;
+        }
+        if (*end != ',') {
+            return -1;
+        }
+        p = end + 1;
+    }
+    return -1;
+}
+
+/*
+ * Keep only CPUs we are allowed on (cgroups, taskset). Returns 0 if any
+ * remain, -1 if the list names none of them.
+ */
+static int usable_cpus(cpu_set_t *set) {
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        return CPU_COUNT(set) > 0 ? 0 : -1;
+    }
+    CPU_AND(set, set, &allowed);
+    return CPU_COUNT(set) > 0 ? 0 : -1;
+}
+
+static void report(const char *what) {
+    char msg[256];
+    snprintf(msg, sizeof(msg), "%s: %s", what, strerror(errno));
+    fprintf(stderr, "Warning: %s\n", msg);
+    write_log("ERROR", msg);
+}
+
+void housekeeping_apply(const HousekeepingOptions *opt) {
+    // Priority first: threads created afterwards (the sampler) inherit it
+    if (opt->set_nice && setpriority(PRIO_PROCESS, 0, opt->nice) != 0) {
+        report("Could not set nice value");
+    }
+    if (opt->idle) {
+        struct sched_param param = { .sched_priority = 0 };
+        if (sched_setscheduler(0, SCHED_IDLE, &param) != 0) {
+            report("Could not switch to SCHED_IDLE");
+        }
+        if (syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0,
+                    IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT) != 0) {
+            report("Could not set the idle I/O class");
+        }
+    }
+
+    if (opt->pin_sampler) {
+        cpu_set_t set = opt->sampler_cpus;
+        if (usable_cpus(&set) == 0) {
+            sampler_set_affinity(&set);
+        } else {
+            errno = EINVAL;
+            report("None of the --pin-sampler CPUs is available");
+        }
+    } else if (opt->pin_render) {
+        // The sampler would inherit the renderer's CPUs; keep today's instead
+        cpu_set_t allowed;
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+            sampler_set_affinity(&allowed);
+        }
+    }
+    if (opt->pin_render) {
+        cpu_set_t set = opt->render_cpus;
+        if (usable_cpus(&set) != 0) {
+            errno = EINVAL;
+            report("None of the --pin-render CPUs is available");
+        } else if ((errno = pthread_setaffinity_np(pthread_self(), sizeof(set), &set)) != 0) {
+            report("Could not pin the renderer");
+        }
+    }
+}
+
+void housekeeping_lock_memory(const HousekeepingOptions *opt) {
+    if (!opt->lock_memory) {
+        return;
+    }
+    // MCL_ONFAULT locks pages as they are touched, so the untouched part
+    // of each thread stack does not count against RLIMIT_MEMLOCK
+    if (mlockall(MCL_CURRENT | MCL_ONFAULT) != 0 && mlockall(MCL_CURRENT) != 0) {
+        report("Could not lock memory (see ulimit -l)");
+    }
+}
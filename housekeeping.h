@@ -0,0 +1,47 @@
+/*
+ * Keeping the monitor out of the way of what it monitors
+ *
+ * Options that apply to the monitor process itself rather than to a mode:
+ * which CPUs the sampler thread and the renderer (main) thread may run on,
+ * a lower CPU and I/O priority, and locking its memory so page reclaim on
+ * a loaded machine does not stall sampling. They are parsed with the
+ * other options (runconfig.c) and combine with every mode.
+ *
+ *   --pin <cpus>          both threads, e.g. "0" or "0-1,6"
+ *   --pin-sampler <cpus>  the sampler thread only
+ *   --pin-render <cpus>   the renderer thread only
+ *   --idle                SCHED_IDLE and the idle I/O class
+ *   --nice <n>            nice value (default 19 with --idle)
+ *   --mlock               lock the working set once sampling or the top view has started
+ */
+
+#ifndef HOUSEKEEPING_H
+#define HOUSEKEEPING_H
+
+#include <sched.h>
+
+typedef struct {
+    int pin_sampler;
+    cpu_set_t sampler_cpus;
+    int pin_render;
+    cpu_set_t render_cpus;
+    int idle;                           // SCHED_IDLE and IOPRIO_CLASS_IDLE
+    int set_nice;
+    int nice;
+    int lock_memory;
+} HousekeepingOptions;
+
+// Parse a CPU list such as "0-3,8"; -1 if it is malformed or empty
+int housekeeping_parse_cpus(const char *list, cpu_set_t *set);
+
+/*
+ * Apply priority and pinning to the calling (main) thread and tell the
+ * sampler where to run. Call before the sampler starts so the thread
+ * inherits the scheduling class. Failures are logged, not fatal.
+ */
+void housekeeping_apply(const HousekeepingOptions *opt);
+
+// mlockall() after the sampler's buffers and thread stack, or the top view's table, exist
+void housekeeping_lock_memory(const HousekeepingOptions *opt);
+
+#endif
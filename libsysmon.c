@@ -0,0 +1,645 @@
+/*
+ * libsysmon - System Monitor sampling library
+ * Reads the /proc filesystem into caller-provided structures
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <dirent.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stddef.h>
+
+#include "libsysmon.h"
+
+/*
+ * Read a /proc file into buf, NUL-terminated, without stdio or allocation
+ * so it is cheap to call per tick. Small files take a single read(2);
+ * seq_file-backed files that come in pieces are read until EOF or until
+ * buf is full. Returns the number of bytes read, or -1 on failure.
+ */
+static ssize_t read_proc_file(const char *path, char *buf, size_t size) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+
+    size_t total = 0;
+    while (total < size - 1) {
+        ssize_t n = read(fd, buf + total, size - 1 - total);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            close(fd);
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        total += (size_t)n;
+    }
+    close(fd);
+
+    buf[total] = '\0';
+    return (ssize_t)total;
+}
+
+/*
+ * Read a whole /proc file into a heap buffer that grows until the file
+ * fits, as getline() does: *buf may start NULL and is kept for the next
+ * call, so a steady-state caller does not allocate. Returns the length,
+ * or -1 on failure.
+ */
+static ssize_t read_proc_file_whole(const char *path, char **buf, size_t *size) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+
+    size_t total = 0;
+    while (1) {
+        if (!*buf || total + 1 >= *size) {
+            size_t grown = *size ? *size * 2 : 65536;
+            char *p = realloc(*buf, grown);
+            if (!p) {
+                close(fd);
+                return -1;
+            }
+            *buf = p;
+            *size = grown;
+        }
+        ssize_t n = read(fd, *buf + total, *size - 1 - total);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            close(fd);
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        total += (size_t)n;
+    }
+    close(fd);
+
+    (*buf)[total] = '\0';
+    return (ssize_t)total;
+}
+
+int sysmon_stat_read(char **buf, size_t *size) {
+    ssize_t n = read_proc_file_whole("/proc/stat", buf, size);
+    return n < 0 ? -1 : (int)n;
+}
+
+/*
+ * Check if a string is numeric
+ */
+static int is_numeric(const char *str) {
+    if (*str == '\0') {
+        return 0;
+    }
+    while (*str) {
+        if (!isdigit((unsigned char)*str)) {
+            return 0;
+        }
+        str++;
+    }
+    return 1;
+}
+
+const MetricDesc metric_schema[METRIC_SCHEMA_COUNT] = {
+    SYSMON_ALL_METRICS(METRIC_DESC)
+};
+
+int sysmon_api_version(void) {
+    return SYSMON_API_VERSION;
+}
+
+/*
+ * Derived totals of a CPUStats. Guest time is already counted in user and
+ * nice, so it is not added again.
+ */
+static void cpu_totals(CPUStats *stats) {
+    stats->active = stats->user + stats->nice + stats->system +
+                    stats->irq + stats->softirq;
+    stats->total = stats->active + stats->idle + stats->iowait + stats->steal;
+}
+
+/*
+ * Parse the counters after the "cpuN" label of a /proc/stat line. Kernels
+ * before 2.6.24 end the line after steal; guest fields are then 0.
+ * Returns a pointer past the parsed fields, or NULL.
+ */
+static const char *parse_cpu_fields(const char *p, CPUStats *stats) {
+#define CPU_FIELD_PTR(field) &stats->field,
+    unsigned long long *fields[] = { SYSMON_CPU_FIELDS(CPU_FIELD_PTR) };
+#undef CPU_FIELD_PTR
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        char *end;
+        *fields[i] = strtoull(p, &end, 10);
+        if (end == p || *p == '\n') {
+            if (i < 8) {
+                return NULL;
+            }
+            *fields[i] = 0;
+            continue;
+        }
+        p = end;
+    }
+    cpu_totals(stats);
+    return p;
+}
+
+/*
+ * Parse /proc/stat text: the aggregate "cpu" line into `all` (may be NULL)
+ * and up to `capacity` "cpuN" lines into buf. Works on any buffer, so
+ * saved copies of /proc/stat can be replayed through it.
+ */
+int sysmon_cpu_parse(const char *text, CPUStats *all, CPUSample *buf, int capacity) {
+    CPUStats ignored;
+
+    if (strncmp(text, "cpu ", 4) != 0 || !parse_cpu_fields(text + 4, all ? all : &ignored)) {
+        return -1;
+    }
+
+    int found = 0;
+    for (const char *line = strchr(text, '\n'); line; line = strchr(line, '\n')) {
+        line++;
+        if (strncmp(line, "cpu", 3) != 0 || !isdigit((unsigned char)line[3])) {
+            // Per-CPU lines are contiguous after the aggregate line
+            break;
+        }
+        if (found >= capacity) {
+            found++;
+            continue;
+        }
+        char *end;
+        int cpu = (int)strtol(line + 3, &end, 10);
+        if (parse_cpu_fields(end, &buf[found].stats)) {
+            buf[found].cpu = cpu;
+            found++;
+        }
+    }
+    return found;
+}
+
+/*
+ * Read the aggregate "cpu" line of /proc/stat
+ */
+int sysmon_cpu_sample(CPUStats *stats) {
+    char buf[512];
+    if (read_proc_file("/proc/stat", buf, sizeof(buf)) < 0) {
+        return -1;
+    }
+    // The first line is all that is parsed; cut it off from the partial rest
+    char *eol = strchr(buf, '\n');
+    if (eol) {
+        eol[1] = '\0';
+    }
+    return sysmon_cpu_parse(buf, stats, NULL, 0) < 0 ? -1 : 0;
+}
+
+/*
+ * Read the "cpuN" lines of /proc/stat. The file is read whole: with
+ * thousands of CPUs the per-CPU lines alone outgrow any fixed buffer.
+ */
+int sysmon_cpu_sample_percpu(CPUSample *buf, int capacity) {
+    char *data = NULL;
+    size_t size = 0;
+    int found = -1;
+
+    if (sysmon_stat_read(&data, &size) >= 0) {
+        found = sysmon_cpu_parse(data, NULL, buf, capacity);
+    }
+    free(data);
+    return found;
+}
+
+/*
+ * Field-by-field difference of two samples. A counter that went backwards
+ * (CPU hot-unplug in the aggregate line, VM migration, a driver resetting
+ * irq time) contributes 0 instead of wrapping to a huge value.
+ */
+int sysmon_cpu_delta(const CPUStats *prev, const CPUStats *curr, CPUStats *delta) {
+    int backwards = 0;
+
+#define CPU_FIELD_DELTA(field) \
+    if (curr->field >= prev->field) { \
+        delta->field = curr->field - prev->field; \
+    } else { \
+        delta->field = 0; \
+        backwards = 1; \
+    }
+    SYSMON_CPU_FIELDS(CPU_FIELD_DELTA)
+#undef CPU_FIELD_DELTA
+
+    cpu_totals(delta);
+    return backwards;
+}
+
+/*
+ * Per-CPU deltas matched by CPU id, summed into `sum`. CPUs found in only
+ * one sample were plugged or unplugged in between, and CPUs whose counters
+ * went backwards were reset; both are left out until they have a clean
+ * baseline, so the sum only covers time that was really measured.
+ */
+int sysmon_cpu_delta_percpu(const CPUSample *prev, int nprev, const CPUSample *curr, int ncurr,
+                            CPUSample *deltas, CPUStats *sum) {
+    int count = 0;
+
+    memset(sum, 0, sizeof(*sum));
+    for (int i = 0; i < ncurr; i++) {
+        const CPUSample *p = NULL;
+        // Lines usually keep their position, so start looking at i
+        for (int j = 0; j < nprev; j++) {
+            if (prev[(i + j) % nprev].cpu == curr[i].cpu) {
+                p = &prev[(i + j) % nprev];
+                break;
+            }
+        }
+        if (!p) {
+            continue;
+        }
+
+        CPUSample *d = &deltas[count];
+        if (sysmon_cpu_delta(&p->stats, &curr[i].stats, &d->stats) != 0) {
+            continue;
+        }
+        d->cpu = curr[i].cpu;
+        count++;
+
+#define CPU_FIELD_SUM(field) sum->field += d->stats.field;
+        SYSMON_CPU_FIELDS(CPU_FIELD_SUM)
+#undef CPU_FIELD_SUM
+    }
+    cpu_totals(sum);
+    return count;
+}
+
+/*
+ * Percentages of one interval's counters. Every state is reported
+ * separately (user and nice without the guest time they include), so
+ * user + nice + system + idle + iowait + irq + softirq + steal + guest +
+ * guest_nice adds up to 100.
+ */
+void sysmon_cpu_usage_delta(const CPUStats *delta, CPUUsage *usage) {
+    memset(usage, 0, sizeof(*usage));
+    if (delta->total == 0) {
+        return;
+    }
+
+    double total = (double)delta->total;
+    unsigned long long guest = delta->guest < delta->user ? delta->guest : delta->user;
+    unsigned long long guest_nice = delta->guest_nice < delta->nice ? delta->guest_nice : delta->nice;
+
+    usage->active_pct = delta->active / total * 100.0;
+    usage->user_pct = (delta->user - guest) / total * 100.0;
+    usage->nice_pct = (delta->nice - guest_nice) / total * 100.0;
+    usage->system_pct = delta->system / total * 100.0;
+    usage->idle_pct = delta->idle / total * 100.0;
+    usage->iowait_pct = delta->iowait / total * 100.0;
+    usage->irq_pct = delta->irq / total * 100.0;
+    usage->softirq_pct = delta->softirq / total * 100.0;
+    usage->steal_pct = delta->steal / total * 100.0;
+    usage->guest_pct = guest / total * 100.0;
+    usage->guest_nice_pct = guest_nice / total * 100.0;
+}
+
+/*
+ * Compute usage percentages between two samples. Returns 1 if a counter
+ * went backwards, in which case the figures only cover the others.
+ */
+int sysmon_cpu_usage(const CPUStats *prev, const CPUStats *curr, CPUUsage *usage) {
+    CPUStats delta;
+    int backwards = sysmon_cpu_delta(prev, curr, &delta);
+    sysmon_cpu_usage_delta(&delta, usage);
+    return backwards;
+}
+
+/*
+ * Read memory statistics from /proc/meminfo
+ */
+int sysmon_mem_sample(MemInfo *info) {
+    char buf[4096];
+    if (read_proc_file("/proc/meminfo", buf, sizeof(buf)) < 0) {
+        return -1;
+    }
+
+    memset(info, 0, sizeof(*info));
+
+    static const struct {
+        const char *label;
+        size_t offset;
+    } keys[] = {
+#define MEMINFO_KEY(field, label) { label, offsetof(MemInfo, field) },
+        SYSMON_MEMINFO_FIELDS(MEMINFO_KEY)
+#undef MEMINFO_KEY
+    };
+    size_t found = 0;
+
+    for (char *line = buf; line && *line && found < sizeof(keys) / sizeof(keys[0]); ) {
+        char *next = strchr(line, '\n');
+        for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+            size_t len = strlen(keys[i].label);
+            if (strncmp(line, keys[i].label, len) == 0) {
+                *(unsigned long long *)((char *)info + keys[i].offset) =
+                    strtoull(line + len, NULL, 10);
+                found++;
+                break;
+            }
+        }
+        line = next ? next + 1 : NULL;
+    }
+
+    if (info->total_kb == 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * Derive used/available figures from a MemInfo sample
+ */
+void sysmon_mem_usage(const MemInfo *info, MemUsage *usage) {
+    usage->total_kb = info->total_kb;
+    usage->available_kb = info->available_kb;
+    usage->free_kb = info->free_kb;
+    usage->buffers_kb = info->buffers_kb;
+    usage->cached_kb = info->cached_kb;
+
+    // Fallback if MemAvailable is missing on very old kernels
+    if (usage->available_kb == 0) {
+        usage->available_kb = info->free_kb + info->buffers_kb + info->cached_kb;
+    }
+
+    usage->used_kb = (info->total_kb > usage->available_kb)
+                     ? (info->total_kb - usage->available_kb)
+                     : 0;
+    usage->used_pct = (info->total_kb == 0)
+                      ? 0.0
+                      : ((double)usage->used_kb / info->total_kb) * 100.0;
+}
+
+/*
+ * Read process name and CPU times from /proc/[PID]/stat
+ */
+int sysmon_proc_read(int pid, ProcessInfo *proc) {
+    char path[64];
+    char buf[1024];
+
+    proc->pid = pid;
+    proc->utime = 0;
+    proc->stime = 0;
+    proc->total_time = 0;
+    strcpy(proc->name, "unknown");
+
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    if (read_proc_file(path, buf, sizeof(buf)) < 0) {
+        return -1;
+    }
+
+    // comm is wrapped in parentheses and may itself contain spaces or ')',
+    // so take everything up to the last ')' as the name.
+    char *open_paren = strchr(buf, '(');
+    char *close_paren = strrchr(buf, ')');
+    if (!open_paren || !close_paren || close_paren < open_paren) {
+        return -1;
+    }
+
+    size_t name_len = (size_t)(close_paren - open_paren - 1);
+    if (name_len >= sizeof(proc->name)) {
+        name_len = sizeof(proc->name) - 1;
+    }
+    memcpy(proc->name, open_paren + 1, name_len);
+    proc->name[name_len] = '\0';
+
+    // Fields after comm: state(3), ppid, pgrp, session, tty_nr, tpgid, flags,
+    //                    minflt, cminflt, majflt, cmajflt, utime(14), stime(15)
+    int fields_read = sscanf(close_paren + 2,
+                             "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu",
+                             &proc->utime, &proc->stime);
+    if (fields_read != 2) {
+        return -1;
+    }
+
+    proc->total_time = proc->utime + proc->stime;
+    return 0;
+}
+
+/*
+ * Scan /proc for all processes into a caller-provided buffer
+ */
+int sysmon_proc_scan(ProcessInfo *buf, int capacity) {
+    DIR *proc_dir = opendir("/proc");
+    if (!proc_dir) {
+        return -1;
+    }
+
+    struct dirent *entry;
+    ProcessInfo scratch;
+    int found = 0;
+
+    while ((entry = readdir(proc_dir)) != NULL) {
+        // Check if directory name is numeric (PID)
+        if (!is_numeric(entry->d_name)) {
+            continue;
+        }
+
+        // Past capacity, keep counting so the caller can size its buffer
+        ProcessInfo *slot = (found < capacity) ? &buf[found] : &scratch;
+        if (sysmon_proc_read(atoi(entry->d_name), slot) == 0) {
+            found++;
+        }
+    }
+
+    closedir(proc_dir);
+    return found;
+}
+
+/*
+ * Comparison function for sorting processes by total CPU time
+ */
+static int compare_processes(const void *a, const void *b) {
+    const ProcessInfo *proc_a = (const ProcessInfo *)a;
+    const ProcessInfo *proc_b = (const ProcessInfo *)b;
+
+    // Sort in descending order (highest CPU time first)
+    if (proc_b->total_time > proc_a->total_time) return 1;
+    if (proc_b->total_time < proc_a->total_time) return -1;
+    return 0;
+}
+
+void sysmon_proc_sort_by_time(ProcessInfo *procs, int count) {
+    qsort(procs, count, sizeof(ProcessInfo), compare_processes);
+}
+
+/*
+ * Read /proc/loadavg plus procs_running/procs_blocked from /proc/stat
+ */
+int sysmon_load_sample(LoadInfo *info) {
+    if (sysmon_loadavg_sample(info) != 0) {
+        return -1;
+    }
+
+    // procs_* come after the per-CPU and intr lines, and the intr line alone
+    // can pass 64 KB on hosts with many CPUs or IRQs, so read it all
+    char *stat = NULL;
+    size_t size = 0;
+    int rc = sysmon_stat_read(&stat, &size) < 0 ? -1 : sysmon_procs_parse(stat, info);
+    free(stat);
+    return rc;
+}
+
+int sysmon_loadavg_sample(LoadInfo *info) {
+    char buf[256];
+
+    memset(info, 0, sizeof(*info));
+    if (read_proc_file("/proc/loadavg", buf, sizeof(buf)) < 0) {
+        return -1;
+    }
+    if (sscanf(buf, "%lf %lf %lf %d/%d", &info->load1, &info->load5, &info->load15,
+               &info->runnable, &info->total_tasks) != 5) {
+        return -1;
+    }
+    return 0;
+}
+
+int sysmon_procs_parse(const char *text, LoadInfo *info) {
+    const char *running = strstr(text, "\nprocs_running ");
+    const char *blocked = strstr(text, "\nprocs_blocked ");
+
+    // Every kernel since 2.6 has both; missing ones mean a cut-off file
+    if (!running || !blocked) {
+        return -1;
+    }
+    info->procs_running = strtoull(running + 15, NULL, 10);
+    info->procs_blocked = strtoull(blocked + 15, NULL, 10);
+    return 0;
+}
+
+/*
+ * Copy the line at text into buf, cut at the newline, so sscanf() cannot
+ * run on into the next line. Returns the start of the next line or NULL.
+ */
+static const char *copy_line(const char *text, char *buf, size_t size) {
+    const char *next = strchr(text, '\n');
+    size_t len = next ? (size_t)(next - text) : strlen(text);
+    if (len >= size) {
+        len = size - 1;
+    }
+    memcpy(buf, text, len);
+    buf[len] = '\0';
+    return next ? next + 1 : NULL;
+}
+
+int sysmon_schedstat_read(char **buf, size_t *size) {
+    ssize_t n = read_proc_file_whole("/proc/schedstat", buf, size);
+    return n < 0 ? -1 : (int)n;
+}
+
+/*
+ * Read per-CPU run-queue statistics from /proc/schedstat. Every CPU adds
+ * its domain lines as well, so the file passes 64 KB at about 50 CPUs and
+ * is read whole. Returns the number of CPUs found (may exceed capacity),
+ * or -1 if the kernel does not provide schedstat.
+ */
+int sysmon_schedstat_sample(CPUSchedStat *buf, int capacity) {
+    char *data = NULL;
+    size_t size = 0;
+    int found = -1;
+
+    if (sysmon_schedstat_read(&data, &size) >= 0) {
+        found = sysmon_schedstat_parse(data, buf, capacity);
+    }
+    free(data);
+    return found;
+}
+
+int sysmon_schedstat_parse(const char *text, CPUSchedStat *buf, int capacity) {
+    char line[256];
+
+    int found = 0;
+    for (const char *p = text; p && *p; ) {
+        // Domain lines are skipped without being copied
+        if (strncmp(p, "cpu", 3) != 0 || !isdigit((unsigned char)p[3])) {
+            p = strchr(p, '\n');
+            p = p ? p + 1 : NULL;
+            continue;
+        }
+        p = copy_line(p, line, sizeof(line));
+
+        // cpuN yld_count 0 sched_count sched_goidle ttwu_count ttwu_local
+        //      rq_cpu_time run_delay pcount
+        unsigned long long v[9];
+        int cpu;
+        if (sscanf(line, "cpu%d %llu %llu %llu %llu %llu %llu %llu %llu %llu", &cpu,
+                   &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7], &v[8]) == 10) {
+            if (found < capacity) {
+                buf[found].cpu = cpu;
+                buf[found].cpu_time_ns = v[6];
+                buf[found].run_delay_ns = v[7];
+                buf[found].timeslices = v[8];
+            }
+            found++;
+        }
+    }
+    return found;
+}
+
+int sysmon_diskstats_read(char **buf, size_t *size) {
+    ssize_t n = read_proc_file_whole("/proc/diskstats", buf, size);
+    return n < 0 ? -1 : (int)n;
+}
+
+/*
+ * Read per-device I/O counters from /proc/diskstats. Hosts with many
+ * devices (multipath, dm, hundreds of partitions) pass 64 KB, so the file
+ * is read whole.
+ */
+int sysmon_disk_sample(DiskStats *buf, int capacity) {
+    char *data = NULL;
+    size_t size = 0;
+    int found = -1;
+
+    if (sysmon_diskstats_read(&data, &size) >= 0) {
+        found = sysmon_disk_parse(data, buf, capacity);
+    }
+    free(data);
+    return found;
+}
+
+int sysmon_disk_parse(const char *text, DiskStats *buf, int capacity) {
+    char line[256];
+
+    int found = 0;
+    for (const char *p = text; p && *p; ) {
+        p = copy_line(p, line, sizeof(line));
+
+        // major minor name reads merged sectors ms writes merged sectors ms
+        //     in_flight io_ms weighted_ms [discard and flush fields]
+        unsigned int major, minor;
+        char name[32];
+        unsigned long long v[10];
+        if (sscanf(line, " %u %u %31s %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu",
+                   &major, &minor, name, &v[0], &v[1], &v[2], &v[3], &v[4], &v[5],
+                   &v[6], &v[7], &v[8], &v[9]) == 13) {
+            if (found < capacity) {
+                DiskStats *d = &buf[found];
+                memcpy(d->name, name, sizeof(d->name));
+                d->reads = v[0];
+                d->sectors_read = v[2];
+                d->writes = v[4];
+                d->sectors_written = v[6];
+                d->io_ms = v[9];
+            }
+            found++;
+        }
+    }
+    return found;
+}
@@ -0,0 +1,162 @@
+/*
+ * libsysmon - System Monitor sampling library
+ *
+ * Collectors for CPU, memory and processes that sample into caller-owned
+ * buffers. Nothing in this library prints, logs or sleeps, so it can be
+ * embedded in an agent and called at high rate.
+ *
+ * /proc/stat, /proc/schedstat and /proc/diskstats have no size limit, so
+ * they are read whole. sysmon_stat_read(), sysmon_schedstat_read() and
+ * sysmon_diskstats_read() take a heap buffer the caller keeps and grow it
+ * as getline() does; pass it back on every call and a steady-state caller
+ * does not allocate, then hand the text to the matching _parse(). The
+ * one-call forms built on them (sysmon_cpu_sample_percpu(),
+ * sysmon_load_sample(), sysmon_schedstat_sample(), sysmon_disk_sample())
+ * allocate and free such a buffer on every call. Everything else reads
+ * into the stack, apart from the directory handle of sysmon_proc_scan().
+ *
+ * All functions return 0 on success and -1 on failure unless noted.
+ */
+
+#ifndef LIBSYSMON_H
+#define LIBSYSMON_H
+
+// Bumped whenever a struct layout or function signature below changes
+#define SYSMON_API_VERSION 6
+
+#include <stddef.h>
+
+#include "metric_schema.h"
+
+// Structure to hold process information
+typedef struct {
+    int pid;
+    char name[256];
+    unsigned long long utime;
+    unsigned long long stime;
+    unsigned long long total_time;
+} ProcessInfo;
+
+// Field lists for the structs below are in metric_schema.h
+#define SYSMON_COUNTER_FIELD(field, ...) unsigned long long field;
+
+// Raw /proc/meminfo figures (kB)
+typedef struct {
+    SYSMON_MEMINFO_FIELDS(SYSMON_COUNTER_FIELD)
+} MemInfo;
+
+// Raw aggregate CPU counters from /proc/stat (clock ticks)
+typedef struct {
+    SYSMON_CPU_FIELDS(SYSMON_COUNTER_FIELD)
+    unsigned long long total, active;
+} CPUStats;
+
+// Counters of one "cpuN" line of /proc/stat
+typedef struct {
+    int cpu;
+    CPUStats stats;
+} CPUSample;
+
+// CPU usage over the interval between two CPUStats samples
+typedef struct {
+    SYSMON_CPU_METRICS(METRIC_STRUCT_FIELD)
+} CPUUsage;
+
+// Derived memory figures (MemAvailable fallback already applied)
+typedef struct {
+    SYSMON_MEM_METRICS(METRIC_STRUCT_FIELD)
+} MemUsage;
+
+// Load averages (/proc/loadavg) and run-queue length (/proc/stat)
+typedef struct {
+    SYSMON_LOAD_METRICS(METRIC_STRUCT_FIELD)
+} LoadInfo;
+
+// One CPU's run-queue counters from /proc/schedstat (nanoseconds)
+typedef struct {
+    int cpu;
+    unsigned long long cpu_time_ns;     // time tasks spent running
+    unsigned long long run_delay_ns;    // time runnable tasks spent waiting
+    unsigned long long timeslices;      // number of timeslices run
+} CPUSchedStat;
+
+// One block device's counters from /proc/diskstats
+typedef struct {
+    char name[32];
+    unsigned long long reads;           // completed
+    unsigned long long sectors_read;    // 512-byte units
+    unsigned long long writes;
+    unsigned long long sectors_written;
+    unsigned long long io_ms;           // time with requests in flight
+} DiskStats;
+
+int sysmon_api_version(void);
+
+/*
+ * CPU
+ *
+ * sysmon_cpu_sample() reads the aggregate line; sysmon_cpu_sample_percpu()
+ * fills at most `capacity` CPUs, in /proc/stat order (offline CPUs are
+ * missing), and returns how many exist. sysmon_cpu_parse() does the same
+ * for /proc/stat text already in memory.
+ */
+int sysmon_cpu_sample(CPUStats *stats);
+// All of /proc/stat into *buf, grown to fit as with getline(); returns the length or -1
+int sysmon_stat_read(char **buf, size_t *size);
+int sysmon_cpu_sample_percpu(CPUSample *buf, int capacity);
+int sysmon_cpu_parse(const char *text, CPUStats *all, CPUSample *buf, int capacity);
+
+/*
+ * Deltas never wrap: counters that went backwards count as 0 and make
+ * sysmon_cpu_delta() and sysmon_cpu_usage() return 1.
+ * sysmon_cpu_delta_percpu() matches CPUs by id, skips hotplugged and reset
+ * CPUs, and returns the number of deltas written (at most ncurr).
+ */
+int sysmon_cpu_delta(const CPUStats *prev, const CPUStats *curr, CPUStats *delta);
+int sysmon_cpu_delta_percpu(const CPUSample *prev, int nprev, const CPUSample *curr, int ncurr,
+                            CPUSample *deltas, CPUStats *sum);
+void sysmon_cpu_usage_delta(const CPUStats *delta, CPUUsage *usage);
+int sysmon_cpu_usage(const CPUStats *prev, const CPUStats *curr, CPUUsage *usage);
+
+/*
+ * Load and scheduler run queues. sysmon_schedstat_sample() fills at most
+ * `capacity` CPUs and returns how many exist, or -1 without schedstat.
+ * sysmon_schedstat_read() and _parse() split it up, as for /proc/stat.
+ */
+int sysmon_load_sample(LoadInfo *info);
+// The /proc/loadavg half of sysmon_load_sample(); procs_* are left at 0
+int sysmon_loadavg_sample(LoadInfo *info);
+// procs_running and procs_blocked from /proc/stat text; -1 if either is missing
+int sysmon_procs_parse(const char *text, LoadInfo *info);
+int sysmon_schedstat_sample(CPUSchedStat *buf, int capacity);
+int sysmon_schedstat_read(char **buf, size_t *size);
+int sysmon_schedstat_parse(const char *text, CPUSchedStat *buf, int capacity);
+
+/*
+ * Block devices. sysmon_disk_sample() fills at most `capacity` devices,
+ * partitions and virtual devices included, in /proc/diskstats order and
+ * returns how many exist, or -1 if the file cannot be read.
+ * sysmon_diskstats_read() and sysmon_disk_parse() split it up.
+ */
+int sysmon_disk_sample(DiskStats *buf, int capacity);
+int sysmon_diskstats_read(char **buf, size_t *size);
+int sysmon_disk_parse(const char *text, DiskStats *buf, int capacity);
+
+/*
+ * Memory
+ */
+int sysmon_mem_sample(MemInfo *info);
+void sysmon_mem_usage(const MemInfo *info, MemUsage *usage);
+
+/*
+ * Processes
+ *
+ * sysmon_proc_scan() fills at most `capacity` entries of `buf` and returns
+ * the number of processes found, which may exceed `capacity` (like
+ * snprintf). Callers can grow the buffer and rescan if they need all of them.
+ */
+int sysmon_proc_read(int pid, ProcessInfo *proc);
+int sysmon_proc_scan(ProcessInfo *buf, int capacity);
+void sysmon_proc_sort_by_time(ProcessInfo *procs, int count);
+
+#endif
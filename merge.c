@@ -0,0 +1,534 @@
+/*
+ * Merging recordings from many hosts
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "recorder.h"
+#include "merge.h"
+
+// Give mapped pages back once this much of an input has been consumed
+#define MERGE_RELEASE_BYTES (4 << 20)
+
+typedef struct {
+    char label[REC_NAME_MAX];
+    char *base;
+    size_t size;
+    size_t released;                    // bytes already dropped from the mapping
+    RecBlockIter it;
+    uint32_t next;                      // next point in the current block
+    int *ids;                           // block name slot -> merged metric id
+    uint32_t ids_capacity;
+} MergeInput;
+
+typedef struct {
+    MergeInput *inputs;
+    int count;
+    int *heap;                          // input indices, earliest next point on top
+    int heap_size;
+    uint32_t bucket_ms;
+
+    // Merged metric names; `prefixed` selects "<host>/<metric>" keys
+    int prefixed;
+    RecMetric *metrics;
+    int nmetrics;
+    int capacity;
+    int *index;
+    int index_size;
+} Merger;
+
+static unsigned int hash_name(const char *s) {
+    unsigned int h = 2166136261u;
+    while (*s) {
+        h ^= (unsigned char)*s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static int merger_rehash(Merger *m, int size) {
+    int *index = malloc((size_t)size * sizeof(int));
+    if (!index) {
+        return -1;
+    }
+    memset(index, 0xff, (size_t)size * sizeof(int));
+    for (int i = 0; i < m->nmetrics; i++) {
+        unsigned int slot = hash_name(m->metrics[i].name) & (unsigned int)(size - 1);
+        while (index[slot] >= 0) {
+            slot = (slot + 1) & (unsigned int)(size - 1);
+        }
+        index[slot] = i;
+    }
+    free(m->index);
+    m->index = index;
+    m->index_size = size;
+    return 0;
+}
+
+static int merger_metric(Merger *m, const char *name, const char *unit) {
+    unsigned int mask = (unsigned int)(m->index_size - 1);
+    unsigned int slot = hash_name(name) & mask;
+
+    while (m->index[slot] >= 0) {
+        if (strcmp(m->metrics[m->index[slot]].name, name) == 0) {
+            return m->index[slot];
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    if (m->nmetrics == m->capacity) {
+        int cap = m->capacity ? m->capacity * 2 : 256;
+        RecMetric *grown = realloc(m->metrics, (size_t)cap * sizeof(RecMetric));
+        if (!grown) {
+            return -1;
+        }
+        m->metrics = grown;
+        m->capacity = cap;
+    }
+
+    int id = m->nmetrics++;
+    snprintf(m->metrics[id].name, REC_NAME_MAX, "%s", name);
+    snprintf(m->metrics[id].unit, REC_UNIT_MAX, "%s", unit);
+    if (m->nmetrics * 2 > m->index_size) {
+        if (merger_rehash(m, m->index_size * 2) != 0) {
+            m->nmetrics--;
+            return -1;
+        }
+    } else {
+        m->index[slot] = id;
+    }
+    return id;
+}
+
+// Host label: the name of the directory holding the file
+static void input_label(const char *path, int n, char *label, size_t size) {
+    const char *slash = strrchr(path, '/');
+    if (!slash || slash == path) {
+        snprintf(label, size, "input%d", n);
+        return;
+    }
+
+    const char *start = slash - 1;
+    while (start > path && start[-1] != '/') {
+        start--;
+    }
+    int len = (int)(slash - start);
+    if (len == 1 && start[0] == '.') {
+        snprintf(label, size, "input%d", n);
+    } else {
+        snprintf(label, size, "%.*s", len, start);
+    }
+}
+
+/*
+ * Step an input to its next point, loading the next block when needed.
+ * Returns NULL when the input is exhausted.
+ */
+static const RecPoint *input_peek(Merger *m, MergeInput *in) {
+    while (!in->it.block || in->next >= in->it.block->npoints) {
+        if (recorder_blocks_next(&in->it, INT64_MIN, INT64_MAX) <= 0) {
+            return NULL;
+        }
+        in->next = 0;
+
+        // Everything before this block has been merged; drop those pages
+        size_t done = (size_t)((const char *)in->it.block - in->base);
+        size_t page = (size_t)sysconf(_SC_PAGESIZE);
+        done -= done % page;
+        if (done - in->released >= MERGE_RELEASE_BYTES) {
+            madvise(in->base + in->released, done - in->released, MADV_DONTNEED);
+            in->released = done;
+        }
+
+        // Resolve the block's names to merged ids once per block
+        uint32_t nnames = in->it.block->nnames;
+        if (nnames > in->ids_capacity) {
+            int *grown = realloc(in->ids, nnames * sizeof(int));
+            if (!grown) {
+                return NULL;
+            }
+            in->ids = grown;
+            in->ids_capacity = nnames;
+        }
+        for (uint32_t i = 0; i < nnames; i++) {
+            const RecMetric *name = &in->it.names[i];
+            char key[REC_NAME_MAX];
+            if (!m->prefixed) {
+                in->ids[i] = merger_metric(m, name->name, name->unit);
+            } else if ((size_t)snprintf(key, sizeof(key), "%s/%s", in->label, name->name) < sizeof(key)) {
+                in->ids[i] = merger_metric(m, key, name->unit);
+            } else {
+                in->ids[i] = -1;        // too long for a metric name, skipped
+            }
+        }
+    }
+
+    return &in->it.points[in->next];
+}
+
+static int heap_less(Merger *m, int a, int b) {
+    int64_t ta = m->inputs[a].it.points[m->inputs[a].next].t_ms;
+    int64_t tb = m->inputs[b].it.points[m->inputs[b].next].t_ms;
+    return ta < tb || (ta == tb && a < b);
+}
+
+static void heap_down(Merger *m, int i) {
+    while (1) {
+        int l = 2 * i + 1, r = l + 1, min = i;
+        if (l < m->heap_size && heap_less(m, m->heap[l], m->heap[min])) min = l;
+        if (r < m->heap_size && heap_less(m, m->heap[r], m->heap[min])) min = r;
+        if (min == i) {
+            return;
+        }
+        int tmp = m->heap[i];
+        m->heap[i] = m->heap[min];
+        m->heap[min] = tmp;
+        i = min;
+    }
+}
+
+static void merger_close(Merger *m) {
+    for (int i = 0; i < m->count; i++) {
+        if (m->inputs[i].base) {
+            munmap(m->inputs[i].base, m->inputs[i].size);
+        }
+        recorder_blocks_free(&m->inputs[i].it);
+        free(m->inputs[i].ids);
+    }
+    free(m->inputs);
+    free(m->heap);
+    free(m->metrics);
+    free(m->index);
+}
+
+/*
+ * Map every input and build the heap. All inputs must come from the same
+ * tier, since their points are merged as they are.
+ */
+static int merger_open(Merger *m, char **paths, int count, int prefixed) {
+    memset(m, 0, sizeof(*m));
+    m->prefixed = prefixed;
+    m->inputs = calloc((size_t)count, sizeof(MergeInput));
+    m->heap = malloc((size_t)count * sizeof(int));
+    if (!m->inputs || !m->heap || merger_rehash(m, 512) != 0) {
+        return -1;
+    }
+    m->count = count;
+
+    for (int i = 0; i < count; i++) {
+        MergeInput *in = &m->inputs[i];
+        int fd = open(paths[i], O_RDONLY | O_CLOEXEC);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0) {
+            fprintf(stderr, "Error: Cannot open %s\n", paths[i]);
+            if (fd >= 0) close(fd);
+            return -1;
+        }
+
+        in->size = (size_t)st.st_size;
+        in->base = (in->size > 0) ? mmap(NULL, in->size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+        close(fd);
+        if (in->base == MAP_FAILED) {
+            in->base = NULL;
+            fprintf(stderr, "Error: Cannot map %s\n", paths[i]);
+            return -1;
+        }
+        madvise(in->base, in->size, MADV_SEQUENTIAL);
+
+        if (recorder_blocks_init(&in->it, in->base, in->size) != 0) {
+            fprintf(stderr, "Error: %s is not a recording segment\n", paths[i]);
+            return -1;
+        }
+        if (i > 0 && in->it.bucket_ms != m->bucket_ms) {
+            fprintf(stderr, "Error: %s is from a different tier than %s\n", paths[i], paths[0]);
+            return -1;
+        }
+        m->bucket_ms = in->it.bucket_ms;
+        input_label(paths[i], i, in->label, sizeof(in->label));
+
+        if (input_peek(m, in)) {
+            m->heap[m->heap_size++] = i;
+        }
+    }
+
+    for (int i = m->heap_size / 2 - 1; i >= 0; i--) {
+        heap_down(m, i);
+    }
+    return 0;
+}
+
+/*
+ * Next point in time order across all inputs, with its merged metric id.
+ * Returns 0 once every input is exhausted.
+ */
+static int merger_next(Merger *m, RecPoint *point, int *id) {
+    while (m->heap_size > 0) {
+        MergeInput *in = &m->inputs[m->heap[0]];
+        const RecPoint *p = &in->it.points[in->next++];
+        int metric = (p->metric < in->it.block->nnames) ? in->ids[p->metric] : -1;
+        *point = *p;
+
+        if (input_peek(m, in)) {
+            heap_down(m, 0);
+        } else {
+            m->heap[0] = m->heap[--m->heap_size];
+            heap_down(m, 0);
+        }
+
+        if (metric >= 0) {
+            *id = metric;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+long long merge_recordings(char **paths, int count, const char *out_path) {
+    Merger m;
+    long long written = 0;
+    int error = 0;
+
+    if (merger_open(&m, paths, count, 1) != 0) {
+        merger_close(&m);
+        return -1;
+    }
+
+    int fd = open(out_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    RecPoint *points = malloc(REC_BLOCK_POINTS * sizeof(RecPoint));
+    int *order = NULL, *local_id = NULL;
+    int local_capacity = 0, nnames = 0, npoints = 0;
+    int64_t first_ms = 0, last_ms = 0;
+
+    int64_t start_ms = m.heap_size ? m.inputs[m.heap[0]].it.points[m.inputs[m.heap[0]].next].t_ms : 0;
+    if (fd < 0 || !points || recorder_write_header(fd, m.bucket_ms, start_ms) != 0) {
+        error = 1;
+    }
+
+    RecPoint point;
+    const RecPoint *p = &point;
+    int id;
+    while (!error && merger_next(&m, &point, &id)) {
+        // Block name slots for the merged ids, like the recorder keeps them
+        if (m.nmetrics > local_capacity) {
+            int cap = m.capacity;
+            int *grown_local = realloc(local_id, (size_t)cap * sizeof(int));
+            if (grown_local) local_id = grown_local;
+            int *grown_order = realloc(order, (size_t)cap * sizeof(int));
+            if (grown_order) order = grown_order;
+            if (!grown_local || !grown_order) {
+                error = 1;
+                break;
+            }
+            for (int i = local_capacity; i < cap; i++) local_id[i] = -1;
+            local_capacity = cap;
+        }
+
+        if (local_id[id] < 0) {
+            local_id[id] = nnames;
+            order[nnames++] = id;
+        }
+        points[npoints] = *p;
+        points[npoints].metric = (uint32_t)local_id[id];
+        if (npoints == 0) first_ms = p->t_ms;
+        last_ms = p->t_ms;
+        npoints++;
+        written++;
+
+        if (npoints == REC_BLOCK_POINTS) {
+            if (recorder_write_block(fd, m.metrics, order, nnames, points, npoints, first_ms, last_ms) != 0) {
+                error = 1;
+            }
+            for (int i = 0; i < nnames; i++) local_id[order[i]] = -1;
+            nnames = npoints = 0;
+        }
+    }
+    if (!error && npoints > 0 &&
+        recorder_write_block(fd, m.metrics, order, nnames, points, npoints, first_ms, last_ms) != 0) {
+        error = 1;
+    }
+
+    if (fd >= 0 && close(fd) != 0) {
+        error = 1;
+    }
+    free(points);
+    free(order);
+    free(local_id);
+    merger_close(&m);
+
+    if (error) {
+        unlink(out_path);
+        return -1;
+    }
+    return written;
+}
+
+/*
+ * Percentiles come from a log-bucketed histogram per metric, so memory is
+ * fixed per metric name however many inputs and points fall in a time
+ * bucket. A histogram bucket spans 1/64 of a power of two (the top 6
+ * mantissa bits of the value), and its midpoint is reported, so p50/p90/p99
+ * are within 0.8% of a value that was really seen; min and max are exact.
+ * Magnitudes below 2^-20 (about 1e-6) count as 0, and those above 2^50
+ * (about 1e15) share the top bucket.
+ */
+#define HIST_SUB_BITS 6
+#define HIST_MIN_EXP -20
+#define HIST_MAX_EXP 50
+#define HIST_SIDE ((HIST_MAX_EXP - HIST_MIN_EXP + 1) << HIST_SUB_BITS)
+#define HIST_SLOTS (2 * HIST_SIDE + 1)          // negatives, zero, positives
+
+typedef struct {
+    uint32_t *counts;                   // HIST_SLOTS, allocated on first use
+    int lo, hi;                         // slots touched in this time bucket
+    long long points;
+    double min, max;
+} MetricHist;
+
+// Slot of a value: HIST_SIDE is zero, higher slots positive, lower negative
+static int hist_slot(double v) {
+    double mag = v < 0 ? -v : v;
+    uint64_t bits;
+    memcpy(&bits, &mag, sizeof(bits));
+
+    int exp = (int)((bits >> 52) & 0x7ff) - 1023;
+    if (exp < HIST_MIN_EXP) {
+        return HIST_SIDE;
+    }
+    int index = HIST_SIDE - 1;
+    if (exp <= HIST_MAX_EXP) {
+        int sub = (int)((bits >> (52 - HIST_SUB_BITS)) & ((1u << HIST_SUB_BITS) - 1));
+        index = ((exp - HIST_MIN_EXP) << HIST_SUB_BITS) | sub;
+    }
+    return v < 0 ? HIST_SIDE - 1 - index : HIST_SIDE + 1 + index;
+}
+
+// Midpoint of a slot's range
+static double hist_value(int slot) {
+    if (slot == HIST_SIDE) {
+        return 0.0;
+    }
+    int index = slot > HIST_SIDE ? slot - HIST_SIDE - 1 : HIST_SIDE - 1 - slot;
+    int exp = (index >> HIST_SUB_BITS) + HIST_MIN_EXP;
+    uint64_t bits = ((uint64_t)(exp + 1023) << 52) |
+                    ((uint64_t)(index & ((1 << HIST_SUB_BITS) - 1)) << (52 - HIST_SUB_BITS)) |
+                    (1ull << (51 - HIST_SUB_BITS));
+    double v;
+    memcpy(&v, &bits, sizeof(v));
+    return slot > HIST_SIDE ? v : -v;
+}
+
+static int hist_add(MetricHist *h, double v) {
+    if (!h->counts) {
+        h->counts = calloc(HIST_SLOTS, sizeof(uint32_t));
+        if (!h->counts) {
+            return -1;
+        }
+    }
+    int slot = hist_slot(v);
+    if (h->points == 0) {
+        h->lo = h->hi = slot;
+        h->min = h->max = v;
+    }
+    if (slot < h->lo) h->lo = slot;
+    if (slot > h->hi) h->hi = slot;
+    if (v < h->min) h->min = v;
+    if (v > h->max) h->max = v;
+    h->counts[slot]++;
+    h->points++;
+    return 0;
+}
+
+// Nearest-rank percentile, kept within the exact min and max
+static double hist_percentile(const MetricHist *h, int pct) {
+    long long rank = (pct * h->points + 99) / 100;
+    long long seen = 0;
+    double v = h->max;
+
+    for (int slot = h->lo; slot <= h->hi; slot++) {
+        seen += h->counts[slot];
+        if (seen >= rank) {
+            v = hist_value(slot);
+            break;
+        }
+    }
+    return v < h->min ? h->min : v > h->max ? h->max : v;
+}
+
+static void print_bucket(const Merger *m, MetricHist *hists, int64_t bucket, FILE *out) {
+    for (int i = 0; i < m->nmetrics; i++) {
+        MetricHist *h = &hists[i];
+        if (h->points == 0) {
+            continue;
+        }
+        fprintf(out, "%lld,%s,%s,%lld,%.6g,%.6g,%.6g,%.6g,%.6g\n",
+                (long long)bucket, m->metrics[i].name, m->metrics[i].unit, h->points,
+                h->min, hist_percentile(h, 50), hist_percentile(h, 90),
+                hist_percentile(h, 99), h->max);
+        // Only the touched slots need clearing
+        memset(h->counts + h->lo, 0, (size_t)(h->hi - h->lo + 1) * sizeof(uint32_t));
+        h->points = 0;
+    }
+}
+
+long long merge_percentiles(char **paths, int count, int64_t bucket_ms, FILE *out) {
+    Merger m;
+    MetricHist *hists = NULL;
+    int hists_capacity = 0;
+    long long read = 0;
+    int error = 0;
+
+    if (bucket_ms <= 0 || merger_open(&m, paths, count, 0) != 0) {
+        if (bucket_ms > 0) merger_close(&m);
+        return -1;
+    }
+
+    fprintf(out, "time_ms,metric,unit,points,min,p50,p90,p99,max\n");
+
+    RecPoint point;
+    const RecPoint *p = &point;
+    int id;
+    int64_t bucket = INT64_MIN;
+    while (merger_next(&m, &point, &id)) {
+        // Inputs arrive in time order, so a bucket is final once passed
+        int64_t b = p->t_ms - ((p->t_ms % bucket_ms) + bucket_ms) % bucket_ms;
+        if (b > bucket) {
+            if (bucket != INT64_MIN) {
+                print_bucket(&m, hists, bucket, out);
+            }
+            bucket = b;
+        }
+
+        if (m.nmetrics > hists_capacity) {
+            MetricHist *grown = realloc(hists, (size_t)m.capacity * sizeof(MetricHist));
+            if (!grown) {
+                error = 1;
+                break;
+            }
+            memset(grown + hists_capacity, 0, (size_t)(m.capacity - hists_capacity) * sizeof(MetricHist));
+            hists = grown;
+            hists_capacity = m.capacity;
+        }
+
+        if (hist_add(&hists[id], p->count ? p->sum / p->count : 0.0) != 0) {
+            error = 1;
+            break;
+        }
+        read++;
+    }
+    if (!error && bucket != INT64_MIN) {
+        print_bucket(&m, hists, bucket, out);
+    }
+
+    for (int i = 0; i < hists_capacity; i++) {
+        free(hists[i].counts);
+    }
+    free(hists);
+    merger_close(&m);
+    return error ? -1 : read;
+}
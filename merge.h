@@ -0,0 +1,33 @@
+/*
+ * Merging recordings from many hosts
+ *
+ * Inputs are recording segment files, one directory per host (for example
+ * fleet/web1/raw-1700000000.rec); the directory name labels the host. Each
+ * input is mapped and walked block by block, and a binary heap keyed on the
+ * next point's timestamp merges them in time order. Memory holds one block
+ * cursor per input however large the files are, and mapped pages are
+ * dropped once the merge has moved past them.
+ */
+
+#ifndef MERGE_H
+#define MERGE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/*
+ * Write one combined segment file with metrics renamed "<host>/<metric>".
+ * Returns the number of points written, or -1.
+ */
+long long merge_recordings(char **paths, int count, const char *out_path);
+
+/*
+ * Print fleet-wide percentiles of each metric per bucket_ms as CSV:
+ * bucket start (ms), metric, unit, points, min, p50, p90, p99, max.
+ * Percentiles come from a fixed-size histogram per metric and are within
+ * 0.8% of an observed value; min and max are exact. Returns the number of
+ * points read, or -1.
+ */
+long long merge_percentiles(char **paths, int count, int64_t bucket_ms, FILE *out);
+
+#endif
@@ -0,0 +1,122 @@
+/*
+ * Metric schema
+ *
+ * Every fixed metric of the built-in collectors is declared once, here, as
+ * an X-macro list. The lists are expanded at compile time into the result
+ * structs and /proc parsers (libsysmon), the panel rows and exports of the
+ * collectors, the interactive screens, and metric_schema[], which gives
+ * recordings a fixed id for each metric. Adding a line here adds the field
+ * everywhere, with no runtime lookup.
+ *
+ * Metric lists:   X(type, field, name, unit, label, show)
+ *   unit decides how a value is displayed: "%", "kB" (shown in MB or GB),
+ *   "us", "/s" or "" for plain numbers. show is METRIC_ALWAYS or METRIC_IF_NONZERO
+ *   (panel row hidden while the value is negligible; still exported).
+ *
+ * Raw counter lists have their own shape, documented with each list.
+ * Per-CPU metrics whose names depend on the machine are not listed.
+ */
+
+#ifndef METRIC_SCHEMA_H
+#define METRIC_SCHEMA_H
+
+#define METRIC_ALWAYS 0
+#define METRIC_IF_NONZERO 1
+
+/*
+ * Raw counters
+ */
+
+// /proc/stat "cpu" line, in kernel order: X(field)
+#define SYSMON_CPU_FIELDS(X) \
+    X(user) X(nice) X(system) X(idle) X(iowait) X(irq) X(softirq) X(steal) \
+    X(guest) X(guest_nice)
+
+// /proc/meminfo lines: X(field, label)
+#define SYSMON_MEMINFO_FIELDS(X) \
+    X(total_kb,     "MemTotal:") \
+    X(free_kb,      "MemFree:") \
+    X(available_kb, "MemAvailable:") \
+    X(buffers_kb,   "Buffers:") \
+    X(cached_kb,    "Cached:")
+
+/*
+ * Derived metrics, one list per result struct
+ */
+
+// CPUUsage
+#define SYSMON_CPU_METRICS(X) \
+    X(double, active_pct,     "cpu.active",     "%", "Active Usage", METRIC_ALWAYS) \
+    X(double, user_pct,       "cpu.user",       "%", "User",         METRIC_ALWAYS) \
+    X(double, nice_pct,       "cpu.nice",       "%", "Nice",         METRIC_IF_NONZERO) \
+    X(double, system_pct,     "cpu.system",     "%", "System",       METRIC_ALWAYS) \
+    X(double, idle_pct,       "cpu.idle",       "%", "Idle",         METRIC_ALWAYS) \
+    X(double, iowait_pct,     "cpu.iowait",     "%", "I/O Wait",     METRIC_ALWAYS) \
+    X(double, irq_pct,        "cpu.irq",        "%", "IRQ",          METRIC_IF_NONZERO) \
+    X(double, softirq_pct,    "cpu.softirq",    "%", "SoftIRQ",      METRIC_IF_NONZERO) \
+    X(double, steal_pct,      "cpu.steal",      "%", "Steal Time",   METRIC_IF_NONZERO) \
+    X(double, guest_pct,      "cpu.guest",      "%", "Guest",        METRIC_IF_NONZERO) \
+    X(double, guest_nice_pct, "cpu.guest_nice", "%", "Guest (nice)", METRIC_IF_NONZERO)
+
+// MemUsage
+#define SYSMON_MEM_METRICS(X) \
+    X(unsigned long long, total_kb,     "mem.total",     "kB", "Total",     METRIC_ALWAYS) \
+    X(unsigned long long, used_kb,      "mem.used",      "kB", "Used",      METRIC_ALWAYS) \
+    X(double,             used_pct,     "mem.used_pct",  "%",  "Used (%)",  METRIC_ALWAYS) \
+    X(unsigned long long, available_kb, "mem.available", "kB", "Available", METRIC_ALWAYS) \
+    X(unsigned long long, free_kb,      "mem.free",      "kB", "Free",      METRIC_ALWAYS) \
+    X(unsigned long long, buffers_kb,   "mem.buffers",   "kB", "Buffers",   METRIC_ALWAYS) \
+    X(unsigned long long, cached_kb,    "mem.cached",    "kB", "Cached",    METRIC_ALWAYS)
+
+// LoadInfo
+#define SYSMON_LOAD_METRICS(X) \
+    X(double,             load1,         "load.1",         "", "Load 1 min",    METRIC_ALWAYS) \
+    X(double,             load5,         "load.5",         "", "Load 5 min",    METRIC_ALWAYS) \
+    X(double,             load15,        "load.15",        "", "Load 15 min",   METRIC_ALWAYS) \
+    X(int,                runnable,      "procs.runnable", "", "Runnable",      METRIC_ALWAYS) \
+    X(int,                total_tasks,   "procs.total",    "", "Tasks",         METRIC_ALWAYS) \
+    X(unsigned long long, procs_running, "procs.running",  "", "Running",       METRIC_ALWAYS) \
+    X(unsigned long long, procs_blocked, "procs.blocked",  "", "Blocked (I/O)", METRIC_ALWAYS)
+
+// The monitor's own cost and how much it is being crowded out
+#define SYSMON_SELF_METRICS(X) \
+    X(double,             cpu_pct,     "self.cpu",       "%",  "Monitor CPU",    METRIC_ALWAYS) \
+    X(double,             machine_pct, "self.machine",   "%",  "Share of host",  METRIC_ALWAYS) \
+    X(double,             sampler_us,  "self.sampler",   "us", "Sampler CPU",    METRIC_ALWAYS) \
+    X(double,             sample_us,   "self.sample",    "us", "Sampling time",  METRIC_ALWAYS) \
+    X(double,             late_us,     "self.late",      "us", "Wakeup delay",   METRIC_ALWAYS) \
+    X(double,             late_max_us, "self.late_max",  "us", "Worst delay",    METRIC_ALWAYS) \
+    X(double,             preempted,   "self.preempted", "/s", "Preempted",      METRIC_IF_NONZERO) \
+    X(unsigned long long, rss_kb,      "self.rss",       "kB", "Resident",       METRIC_ALWAYS) \
+    X(unsigned long long, locked_kb,   "self.locked",    "kB", "Locked",         METRIC_IF_NONZERO)
+
+#define SYSMON_ALL_METRICS(X) \
+    SYSMON_CPU_METRICS(X) \
+    SYSMON_MEM_METRICS(X) \
+    SYSMON_LOAD_METRICS(X) \
+    SYSMON_SELF_METRICS(X)
+
+/*
+ * Expansions. METRIC_EMIT and METRIC_ROW read the struct through a local
+ * pointer named `r`; METRIC_EMIT also needs `emit` and `ctx` in scope.
+ */
+#define METRIC_STRUCT_FIELD(type, field, name, unit, label, show) type field;
+#define METRIC_EMIT(type, field, name, unit, label, show) \
+    emit(ctx, name, (double)r->field, unit);
+#define METRIC_ROW(type, field, name, unit, label, show) \
+    render_metric_row(out, label, (double)r->field, unit, show);
+#define METRIC_DESC(type, field, name, unit, label, show) { name, unit, label },
+#define METRIC_COUNT_ONE(type, field, name, unit, label, show) + 1
+
+typedef struct {
+    const char *name;
+    const char *unit;
+    const char *label;
+} MetricDesc;
+
+#define METRIC_SCHEMA_COUNT (0 SYSMON_ALL_METRICS(METRIC_COUNT_ONE))
+
+// Every listed metric in declaration order; the index is its schema id
+extern const MetricDesc metric_schema[METRIC_SCHEMA_COUNT];
+
+#endif
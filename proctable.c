@@ -0,0 +1,749 @@
+/*
+ * Incremental process table
+ * One /proc walk per scan; per-PID files are opened relative to /proc
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <math.h>
+#include <sys/stat.h>
+
+#include "proctable.h"
+
+#define INDEX_EMPTY   -1
+#define INDEX_DELETED -2
+#define MIN_INDEX_SIZE 1024
+
+/*
+ * Read a small file relative to dirfd into buf, NUL-terminated
+ */
+static ssize_t read_at(int dirfd, const char *path, char *buf, size_t size) {
+    int fd = openat(dirfd, path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+
+    ssize_t n;
+    do {
+        n = read(fd, buf, size - 1);
+    } while (n < 0 && errno == EINTR);
+    close(fd);
+
+    if (n < 0) {
+        return -1;
+    }
+    buf[n] = '\0';
+    return n;
+}
+
+static unsigned int hash_pid(int pid, int index_size) {
+    return ((unsigned int)pid * 2654435761u) & (unsigned int)(index_size - 1);
+}
+
+/*
+ * Index slot holding pid, or -1 if pid is not in the table
+ */
+static int find_slot(const ProcTable *table, int pid) {
+    unsigned int mask = (unsigned int)table->index_size - 1;
+    unsigned int slot = hash_pid(pid, table->index_size);
+
+    while (table->index[slot] != INDEX_EMPTY) {
+        int idx = table->index[slot];
+        if (idx >= 0 && table->entries[idx].pid == pid) {
+            return (int)slot;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+static void index_insert(ProcTable *table, int pid, int entry_idx) {
+    unsigned int mask = (unsigned int)table->index_size - 1;
+    unsigned int slot = hash_pid(pid, table->index_size);
+
+    while (table->index[slot] >= 0) {
+        slot = (slot + 1) & mask;
+    }
+    if (table->index[slot] == INDEX_EMPTY) {
+        table->index_used++;
+    }
+    table->index[slot] = entry_idx;
+}
+
+/*
+ * Rebuild the hash index, dropping deleted markers and growing if needed
+ */
+static int rehash(ProcTable *table) {
+    int size = MIN_INDEX_SIZE;
+    while (size < table->count * 4) {
+        size *= 2;
+    }
+
+    int *index = malloc((size_t)size * sizeof(int));
+    if (!index) {
+        return -1;
+    }
+
+    free(table->index);
+    table->index = index;
+    table->index_size = size;
+    table->index_used = 0;
+    for (int i = 0; i < size; i++) {
+        index[i] = INDEX_EMPTY;
+    }
+    for (int i = 0; i < table->count; i++) {
+        index_insert(table, table->entries[i].pid, i);
+    }
+    return 0;
+}
+
+/*
+ * Group tables: cleared at the start of each scan and filled as entries
+ * are updated, so aggregation costs one hash probe per process
+ */
+static unsigned int hash_name(const char *name) {
+    unsigned int h = 2166136261u;      // FNV-1a
+    while (*name) {
+        h = (h ^ (unsigned char)*name++) * 16777619u;
+    }
+    return h;
+}
+
+static void group_reset(GroupTable *gt) {
+    gt->count = 0;
+    for (int i = 0; i < gt->index_size; i++) {
+        gt->index[i] = -1;
+    }
+}
+
+static int group_grow(GroupTable *gt) {
+    int capacity = gt->capacity ? gt->capacity * 2 : 64;
+    ProcGroup *groups = realloc(gt->groups, (size_t)capacity * sizeof(ProcGroup));
+    if (!groups) {
+        return -1;
+    }
+    gt->groups = groups;
+    gt->capacity = capacity;
+
+    // Keep the index at most half full
+    int *index = malloc((size_t)capacity * 2 * sizeof(int));
+    if (!index) {
+        return -1;
+    }
+    free(gt->index);
+    gt->index = index;
+    gt->index_size = capacity * 2;
+    for (int i = 0; i < gt->index_size; i++) {
+        index[i] = -1;
+    }
+    for (int g = 0; g < gt->count; g++) {
+        unsigned int h = gt->by_name ? hash_name(gt->groups[g].name)
+                                     : (unsigned int)gt->groups[g].uid * 2654435761u;
+        unsigned int slot = h & (unsigned int)(gt->index_size - 1);
+        while (index[slot] >= 0) {
+            slot = (slot + 1) & (unsigned int)(gt->index_size - 1);
+        }
+        index[slot] = g;
+    }
+    return 0;
+}
+
+static void group_add(GroupTable *gt, const ProcEntry *e) {
+    if (gt->count == gt->capacity && group_grow(gt) != 0) {
+        return;
+    }
+
+    unsigned int h = gt->by_name ? hash_name(e->name) : (unsigned int)e->uid * 2654435761u;
+    unsigned int mask = (unsigned int)gt->index_size - 1;
+    unsigned int slot = h & mask;
+    ProcGroup *g = NULL;
+
+    while (gt->index[slot] >= 0) {
+        ProcGroup *candidate = &gt->groups[gt->index[slot]];
+        if (gt->by_name ? strcmp(candidate->name, e->name) == 0 : candidate->uid == e->uid) {
+            g = candidate;
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    if (!g) {
+        gt->index[slot] = gt->count;
+        g = &gt->groups[gt->count++];
+        memset(g, 0, sizeof(*g));
+        g->uid = e->uid;
+        if (gt->by_name) {
+            memcpy(g->name, e->name, sizeof(g->name));
+        }
+    }
+
+    g->count++;
+    g->cpu_pct += e->cpu_pct;
+    g->io_rate += e->io_rate;
+    g->rss_kb += e->rss_kb;
+}
+
+static void group_free(GroupTable *gt) {
+    free(gt->groups);
+    free(gt->index);
+}
+
+int proctable_init(ProcTable *table, int flags) {
+    memset(table, 0, sizeof(*table));
+    table->flags = flags;
+    table->page_kb = sysconf(_SC_PAGESIZE) / 1024;
+    table->clk_tck = sysconf(_SC_CLK_TCK);
+    if (table->clk_tck <= 0) {
+        table->clk_tck = 100;
+    }
+
+    table->by_comm.by_name = 1;
+    table->trend_window = PROC_TREND_DEFAULT_WINDOW;
+    table->trend_min_kb_per_min = 1024.0;
+    table->trend_min_r2 = 0.8;
+    table->capacity = 512;
+    table->entries = malloc((size_t)table->capacity * sizeof(ProcEntry));
+    if (!table->entries) {
+        return -1;
+    }
+    if (rehash(table) != 0) {
+        free(table->entries);
+        table->entries = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+void proctable_free(ProcTable *table) {
+    for (int i = 0; i < table->count; i++) {
+        free(table->entries[i].cgroup);
+        free(table->entries[i].history);
+    }
+    free(table->entries);
+    free(table->index);
+    free(table->tree_start);
+    free(table->tree_children);
+    free(table->tree_order);
+    group_free(&table->by_user);
+    group_free(&table->by_comm);
+    memset(table, 0, sizeof(*table));
+}
+
+ProcEntry *proctable_find(ProcTable *table, int pid) {
+    int slot = find_slot(table, pid);
+    return (slot < 0) ? NULL : &table->entries[table->index[slot]];
+}
+
+/*
+ * Remove entry i by moving the last entry into its place
+ */
+static void remove_entry(ProcTable *table, int i) {
+    int last = table->count - 1;
+
+    free(table->entries[i].cgroup);
+    free(table->entries[i].history);
+    table->index[find_slot(table, table->entries[i].pid)] = INDEX_DELETED;
+
+    if (i != last) {
+        table->entries[i] = table->entries[last];
+        table->index[find_slot(table, table->entries[i].pid)] = i;
+    }
+    table->count--;
+}
+
+/*
+ * Move the time base up to the oldest sample of a full window and sum the
+ * window again from scratch
+ */
+static void trend_rebase(ProcEntry *e, int window) {
+    double shift = e->history[e->history_pos].t;
+
+    e->trend_base += shift;
+    e->sx = e->sy = e->sxx = e->sxy = e->syy = 0.0;
+    for (int i = 0; i < window; i++) {
+        TrendSample *s = &e->history[i];
+        s->t = (float)(s->t - shift);
+        double x = s->t;
+        double y = s->rss_kb;
+        e->sx += x;
+        e->sy += y;
+        e->sxx += x * x;
+        e->sxy += x * y;
+        e->syy += y * y;
+    }
+}
+
+/*
+ * Add this scan's RSS to the entry's window and refresh its slope.
+ * Running sums make this O(1) however long the window is; the rebase once
+ * per window adds O(1) per scan on average.
+ */
+static void trend_update(ProcTable *table, ProcEntry *e, const struct timespec *now) {
+    int window = table->trend_window;
+    double now_s = now->tv_sec + now->tv_nsec / 1e9;
+
+    if (!e->history) {
+        e->history = malloc((size_t)window * sizeof(TrendSample));
+        if (!e->history) {
+            return;
+        }
+        e->history_len = 0;
+        e->history_pos = 0;
+        e->trend_base = now_s;
+        e->sx = e->sy = e->sxx = e->sxy = e->syy = 0.0;
+    }
+
+    if (e->history_len == window) {
+        // Oldest sample sits where the new one goes
+        double old_x = e->history[e->history_pos].t;
+        double old_y = e->history[e->history_pos].rss_kb;
+        e->sx -= old_x;
+        e->sy -= old_y;
+        e->sxx -= old_x * old_x;
+        e->sxy -= old_x * old_y;
+        e->syy -= old_y * old_y;
+    } else {
+        e->history_len++;
+    }
+
+    // Sum what is stored, so the sample leaves the sums exactly as it came
+    TrendSample *s = &e->history[e->history_pos];
+    s->t = (float)(now_s - e->trend_base);
+    s->rss_kb = (unsigned int)(e->rss_kb > 0xffffffffULL ? 0xffffffffULL : e->rss_kb);
+    double x = s->t;
+    double y = s->rss_kb;
+    e->history_pos = (e->history_pos + 1) % window;
+    e->sx += x;
+    e->sy += y;
+    e->sxx += x * x;
+    e->sxy += x * y;
+    e->syy += y * y;
+
+    if (e->history_pos == 0 && e->history_len == window) {
+        trend_rebase(e, window);
+    }
+
+    double n = e->history_len;
+    double var_x = n * e->sxx - e->sx * e->sx;
+    double var_y = n * e->syy - e->sy * e->sy;
+    double cov = n * e->sxy - e->sx * e->sy;
+
+    e->rss_slope_kb_s = (n >= 2 && var_x > 0.0) ? cov / var_x : 0.0;
+    e->leak_suspect = 0;
+    if (e->history_len == window && var_y > 0.0 && cov > 0.0) {
+        double r2 = (cov * cov) / (var_x * var_y);
+        e->leak_suspect = r2 >= table->trend_min_r2 &&
+                          proctable_growth_kb_per_min(table, e) >= table->trend_min_kb_per_min;
+    }
+}
+
+/*
+ * Parse /proc/[pid]/stat into e: name, state, ppid, utime+stime, starttime
+ * and rss
+ */
+static int parse_stat(char *buf, ProcEntry *e, long page_kb) {
+    char *open_paren = strchr(buf, '(');
+    char *close_paren = strrchr(buf, ')');
+    if (!open_paren || !close_paren || close_paren < open_paren) {
+        return -1;
+    }
+
+    size_t name_len = (size_t)(close_paren - open_paren - 1);
+    if (name_len >= sizeof(e->name)) {
+        name_len = sizeof(e->name) - 1;
+    }
+    memcpy(e->name, open_paren + 1, name_len);
+    e->name[name_len] = '\0';
+
+    // Walk the numeric fields after comm; field 3 (state) is a character
+    char *p = close_paren + 2;
+    unsigned long long utime = 0, stime = 0;
+    for (int field = 3; field <= 24; field++) {
+        while (*p == ' ') p++;
+        if (*p == '\0') {
+            return -1;
+        }
+
+        if (field == 3) {
+            e->state = *p++;
+            continue;
+        }
+
+        // Negative fields (e.g. priority) wrap around; none of them are kept
+        char *end;
+        unsigned long long v = strtoull(p, &end, 10);
+        if (end == p) {
+            return -1;
+        }
+        p = end;
+
+        switch (field) {
+            case 4: e->ppid = (int)v; break;
+            case 14: utime = v; break;
+            case 15: stime = v; break;
+            case 22: e->start_time = v; break;
+            case 24: e->rss_kb = v * (unsigned long long)page_kb; break;
+        }
+    }
+
+    e->total_time = utime + stime;
+    return 0;
+}
+
+static void read_io(int proc_fd, ProcEntry *e) {
+    char path[64];
+    char buf[512];
+
+    snprintf(path, sizeof(path), "%d/io", e->pid);
+    e->io_valid = 0;
+    if (read_at(proc_fd, path, buf, sizeof(buf)) < 0) {
+        return;
+    }
+
+    char *rb = strstr(buf, "\nread_bytes:");
+    char *wb = strstr(buf, "\nwrite_bytes:");
+    if (!rb || !wb) {
+        return;
+    }
+    e->io_bytes = strtoull(rb + 12, NULL, 10) + strtoull(wb + 13, NULL, 10);
+    e->io_valid = 1;
+}
+
+static void read_cgroup(int proc_fd, ProcEntry *e) {
+    char path[64];
+    char buf[1024];
+
+    snprintf(path, sizeof(path), "%d/cgroup", e->pid);
+    if (read_at(proc_fd, path, buf, sizeof(buf)) < 0) {
+        e->cgroup = strdup("");
+        return;
+    }
+
+    // Prefer the unified hierarchy line "0::/path", else the first line's path
+    char *path_start = strstr(buf, "0::");
+    if (path_start && (path_start == buf || path_start[-1] == '\n')) {
+        path_start += 3;
+    } else {
+        path_start = strchr(buf, ':');
+        path_start = path_start ? strchr(path_start + 1, ':') : NULL;
+        path_start = path_start ? path_start + 1 : buf;
+    }
+    path_start[strcspn(path_start, "\n")] = '\0';
+    e->cgroup = strdup(path_start);
+}
+
+/*
+ * Walk /proc once, updating existing entries, adding new PIDs and
+ * dropping PIDs that were not seen
+ */
+int proctable_scan(ProcTable *table) {
+    DIR *proc_dir = opendir("/proc");
+    if (!proc_dir) {
+        return -1;
+    }
+    int proc_fd = dirfd(proc_dir);
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double elapsed = 0.0;
+    if (table->generation > 0) {
+        elapsed = (now.tv_sec - table->last_scan.tv_sec) +
+                  (now.tv_nsec - table->last_scan.tv_nsec) / 1e9;
+    }
+    table->generation++;
+
+    if (table->flags & PROC_GROUP_BY_USER) {
+        group_reset(&table->by_user);
+    }
+    if (table->flags & PROC_GROUP_BY_COMM) {
+        group_reset(&table->by_comm);
+    }
+
+    struct dirent *entry;
+    char path[64];
+    char buf[1024];
+
+    while ((entry = readdir(proc_dir)) != NULL) {
+        if (entry->d_name[0] < '1' || entry->d_name[0] > '9') {
+            continue;
+        }
+        int pid = atoi(entry->d_name);
+        if (pid <= 0) {
+            continue;
+        }
+
+        snprintf(path, sizeof(path), "%d/stat", pid);
+        if (read_at(proc_fd, path, buf, sizeof(buf)) < 0) {
+            continue;
+        }
+
+        ProcEntry fresh;
+        memset(&fresh, 0, sizeof(fresh));
+        if (parse_stat(buf, &fresh, table->page_kb) != 0) {
+            continue;
+        }
+
+        int slot = find_slot(table, pid);
+        int idx;
+        if (slot >= 0 && table->entries[table->index[slot]].start_time == fresh.start_time) {
+            idx = table->index[slot];
+        } else {
+            if (slot >= 0) {
+                // PID was reused by a new process: start over
+                remove_entry(table, table->index[slot]);
+            }
+            if (table->count == table->capacity) {
+                int capacity = table->capacity * 2;
+                ProcEntry *grown = realloc(table->entries, (size_t)capacity * sizeof(ProcEntry));
+                if (!grown) {
+                    break;
+                }
+                table->entries = grown;
+                table->capacity = capacity;
+            }
+            if ((table->index_used + 1) * 10 > table->index_size * 7) {
+                if (rehash(table) != 0) {
+                    break;
+                }
+            }
+
+            idx = table->count++;
+            ProcEntry *e = &table->entries[idx];
+            memset(e, 0, sizeof(*e));
+            e->pid = pid;
+            e->start_time = fresh.start_time;
+            e->total_time = fresh.total_time;   // first interval reads as 0%
+            index_insert(table, pid, idx);
+
+            struct stat st;
+            if (fstatat(proc_fd, entry->d_name, &st, 0) == 0) {
+                e->uid = st.st_uid;
+            }
+        }
+
+        ProcEntry *e = &table->entries[idx];
+        e->prev_time = e->total_time;
+        e->total_time = fresh.total_time;
+        e->rss_kb = fresh.rss_kb;
+        e->ppid = fresh.ppid;
+        e->state = fresh.state;
+        e->sched_valid = 0;
+        memcpy(e->name, fresh.name, sizeof(e->name));
+        e->cpu_pct = (elapsed > 0.0)
+                     ? (double)(e->total_time - e->prev_time) / (elapsed * table->clk_tck) * 100.0
+                     : 0.0;
+
+        if (table->flags & PROC_COLLECT_IO) {
+            int had_io = e->io_valid;
+            e->prev_io_bytes = e->io_bytes;
+            read_io(proc_fd, e);
+            e->io_rate = (had_io && e->io_valid && elapsed > 0.0 && e->io_bytes >= e->prev_io_bytes)
+                         ? (e->io_bytes - e->prev_io_bytes) / elapsed
+                         : 0.0;
+        }
+        if ((table->flags & PROC_COLLECT_CGROUP) && !e->cgroup) {
+            read_cgroup(proc_fd, e);
+        }
+
+        if (table->flags & PROC_TRACK_TREND) {
+            trend_update(table, e, &now);
+        }
+
+        if (table->flags & PROC_GROUP_BY_USER) {
+            group_add(&table->by_user, e);
+        }
+        if (table->flags & PROC_GROUP_BY_COMM) {
+            group_add(&table->by_comm, e);
+        }
+
+        e->seen = table->generation;
+    }
+
+    closedir(proc_dir);
+    table->last_scan = now;
+    table->last_elapsed = elapsed;
+
+    // Drop processes that have exited; walk backwards so swaps are safe
+    for (int i = table->count - 1; i >= 0; i--) {
+        if (table->entries[i].seen != table->generation) {
+            remove_entry(table, i);
+        }
+    }
+
+    // Too many deleted markers make probes long
+    if (table->index_used * 10 > table->index_size * 7) {
+        rehash(table);
+    }
+
+    return table->count;
+}
+
+/*
+ * Link every entry to its parent and sum CPU %, I/O rate and RSS over each
+ * subtree. Linear in the number of processes: parents are found through
+ * the PID index, children are grouped with a counting pass, and the sums
+ * are pushed up in reverse breadth-first order.
+ */
+int proctable_build_tree(ProcTable *table) {
+    int n = table->count;
+
+    if (table->tree_capacity < n + 1) {
+        int capacity = table->capacity + 1;
+        int *start = realloc(table->tree_start, (size_t)(capacity + 1) * sizeof(int));
+        if (!start) return -1;
+        table->tree_start = start;
+        int *children = realloc(table->tree_children, (size_t)capacity * sizeof(int));
+        if (!children) return -1;
+        table->tree_children = children;
+        int *order = realloc(table->tree_order, (size_t)capacity * sizeof(int));
+        if (!order) return -1;
+        table->tree_order = order;
+        table->tree_capacity = capacity;
+    }
+
+    int *start = table->tree_start;
+    int *children = table->tree_children;
+    int *order = table->tree_order;
+
+    // Count children per parent; slot n collects the roots
+    memset(start, 0, (size_t)(n + 2) * sizeof(int));
+    for (int i = 0; i < n; i++) {
+        ProcEntry *e = &table->entries[i];
+        int slot = (e->ppid > 0 && e->ppid != e->pid) ? find_slot(table, e->ppid) : -1;
+        e->parent = (slot >= 0) ? table->index[slot] : -1;
+        start[(e->parent >= 0 ? e->parent : n) + 1]++;
+    }
+    for (int i = 0; i <= n; i++) {
+        start[i + 1] += start[i];
+    }
+
+    // Place children; start[p] temporarily advances as a fill cursor
+    for (int i = 0; i < n; i++) {
+        int p = table->entries[i].parent;
+        children[start[p >= 0 ? p : n]++] = i;
+    }
+    for (int i = n; i > 0; i--) {
+        start[i] = start[i - 1];
+    }
+    start[0] = 0;
+
+    // Breadth-first from the roots so every parent precedes its children
+    int head = 0, tail = 0;
+    for (int c = start[n]; c < start[n + 1]; c++) {
+        order[tail++] = children[c];
+        table->entries[children[c]].depth = 0;
+    }
+    while (head < tail) {
+        int i = order[head++];
+        for (int c = start[i]; c < start[i + 1]; c++) {
+            order[tail++] = children[c];
+            table->entries[children[c]].depth = table->entries[i].depth + 1;
+        }
+    }
+
+    for (int i = 0; i < n; i++) {
+        ProcEntry *e = &table->entries[i];
+        e->tree_cpu_pct = e->cpu_pct;
+        e->tree_io_rate = e->io_rate;
+        e->tree_rss_kb = e->rss_kb;
+        e->tree_count = 1;
+    }
+    for (int k = tail - 1; k >= 0; k--) {
+        ProcEntry *e = &table->entries[order[k]];
+        if (e->parent >= 0) {
+            ProcEntry *p = &table->entries[e->parent];
+            p->tree_cpu_pct += e->tree_cpu_pct;
+            p->tree_io_rate += e->tree_io_rate;
+            p->tree_rss_kb += e->tree_rss_kb;
+            p->tree_count += e->tree_count;
+        }
+    }
+
+    return tail;
+}
+
+/*
+ * Read /proc/[pid]/schedstat for the given candidates only. Wait figures
+ * are valid for entries that were also candidates in the previous scan.
+ * Call right after proctable_scan(). Returns the number of entries read.
+ */
+int proctable_sample_sched(ProcTable *table, ProcEntry **candidates, int n) {
+    int proc_fd = open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (proc_fd < 0) {
+        return -1;
+    }
+
+    char path[64];
+    char buf[128];
+    int read_count = 0;
+
+    for (int i = 0; i < n; i++) {
+        ProcEntry *e = candidates[i];
+        if (e->sched_seen == table->generation) {
+            continue;
+        }
+
+        snprintf(path, sizeof(path), "%d/schedstat", e->pid);
+        unsigned long long cpu_ns, delay_ns, slices;
+        if (read_at(proc_fd, path, buf, sizeof(buf)) < 0 ||
+            sscanf(buf, "%llu %llu %llu", &cpu_ns, &delay_ns, &slices) != 3) {
+            continue;
+        }
+
+        if (e->sched_seen == table->generation - 1 && table->last_elapsed > 0.0 &&
+            delay_ns >= e->run_delay_ns && slices >= e->timeslices) {
+            unsigned long long delay = delay_ns - e->run_delay_ns;
+            unsigned long long slice_delta = slices - e->timeslices;
+            e->wait_pct = delay / (table->last_elapsed * 1e9) * 100.0;
+            e->avg_wait_us = slice_delta ? delay / 1000.0 / slice_delta : 0.0;
+            e->sched_valid = 1;
+        }
+
+        e->run_delay_ns = delay_ns;
+        e->timeslices = slices;
+        e->sched_seen = table->generation;
+        read_count++;
+    }
+
+    close(proc_fd);
+    return read_count;
+}
+
+/*
+ * Configure leak detection: regression window in scans and the growth
+ * (kB per minute) a process must sustain over a full window to be flagged.
+ * Changing the window drops the history collected so far.
+ */
+int proctable_set_trend(ProcTable *table, int window, double min_kb_per_min) {
+    if (window < 2 || window > PROC_TREND_MAX_WINDOW || min_kb_per_min < 0.0) {
+        return -1;
+    }
+
+    if (window != table->trend_window) {
+        for (int i = 0; i < table->count; i++) {
+            free(table->entries[i].history);
+            table->entries[i].history = NULL;
+            table->entries[i].leak_suspect = 0;
+            table->entries[i].rss_slope_kb_s = 0.0;
+        }
+        table->trend_window = window;
+    }
+    table->trend_min_kb_per_min = min_kb_per_min;
+    return 0;
+}
+
+/*
+ * Slope of an entry's RSS window converted to kB per minute
+ */
+double proctable_growth_kb_per_min(const ProcTable *table, const ProcEntry *e) {
+    (void)table;
+    if (isnan(e->rss_slope_kb_s)) {
+        return 0.0;
+    }
+    return e->rss_slope_kb_s * 60.0;
+}
@@ -0,0 +1,144 @@
+/*
+ * Incremental process table
+ *
+ * Keeps one entry per live PID across scans so per-interval rates (CPU %,
+ * I/O bytes/s) can be computed from deltas. Entries live in a dense array
+ * for cheap iteration and are found by PID through an open-addressing hash
+ * index; exited processes are swap-removed at the end of each scan.
+ *
+ * When asked, the same scan pass also sums usage per UID and per command
+ * name into small hash-aggregated group tables, and keeps a short RSS
+ * history per process with a sliding least-squares slope to spot leaks.
+ */
+
+#ifndef PROCTABLE_H
+#define PROCTABLE_H
+
+#include <sys/types.h>
+#include <time.h>
+
+// Optional per-process files, read only when asked for
+#define PROC_COLLECT_IO     0x1     // /proc/[pid]/io (needs ptrace access)
+#define PROC_COLLECT_CGROUP 0x2     // /proc/[pid]/cgroup, cached per entry
+#define PROC_GROUP_BY_USER  0x4     // fill ProcTable.by_user during the scan
+#define PROC_GROUP_BY_COMM  0x8     // fill ProcTable.by_comm during the scan
+#define PROC_TRACK_TREND    0x10    // keep RSS history and growth slope per entry
+
+#define PROC_TREND_DEFAULT_WINDOW 30
+#define PROC_TREND_MAX_WINDOW     1024
+
+// One scan in an entry's RSS window
+typedef struct {
+    float t;                            // seconds after the entry's trend_base
+    unsigned int rss_kb;
+} TrendSample;
+
+typedef struct {
+    int pid;
+    int ppid;
+    char state;                         // R, S, D, ... from /proc/[pid]/stat
+    uid_t uid;
+    char name[64];
+    unsigned long long start_time;      // detects PID reuse
+    unsigned long long total_time;      // utime + stime, clock ticks
+    unsigned long long prev_time;
+    unsigned long long rss_kb;
+    unsigned long long io_bytes;        // read_bytes + write_bytes
+    unsigned long long prev_io_bytes;
+    int io_valid;
+    double cpu_pct;                     // of one CPU over the last interval
+    double io_rate;                     // bytes per second over the last interval
+    char *cgroup;                       // NULL until PROC_COLLECT_CGROUP asks for it
+    unsigned int seen;                  // generation of the last scan that saw it
+
+    // Filled by proctable_sample_sched(), for candidate processes only
+    unsigned long long run_delay_ns;    // cumulative run-queue wait
+    unsigned long long timeslices;
+    unsigned int sched_seen;            // generation of the last schedstat read
+    int sched_valid;                    // wait figures cover the last interval
+    double wait_pct;                    // runnable-but-waiting time, % of the interval
+    double avg_wait_us;                 // run-queue wait per timeslice
+
+    // Filled when PROC_TRACK_TREND is set. Sums over the last trend_window
+    // scans, with x = seconds since trend_base, y = RSS in kB, so uneven
+    // scan intervals do not skew the slope; each scan adds one sample and
+    // drops the oldest in O(1). Once per window the base moves up to the
+    // oldest sample and the sums are recomputed, so x stays small and
+    // rounding errors do not build up over a long run.
+    TrendSample *history;               // ring buffer of trend_window samples
+    int history_len;
+    int history_pos;
+    double trend_base;                  // CLOCK_MONOTONIC seconds
+    double sx, sy, sxx, sxy, syy;
+    double rss_slope_kb_s;              // least-squares growth, kB per second
+    int leak_suspect;                   // sustained growth over a full window
+
+    // Filled by proctable_build_tree()
+    int parent;                         // entry index of the parent, -1 for roots
+    int depth;
+    double tree_cpu_pct;                // this process plus all descendants
+    double tree_io_rate;
+    unsigned long long tree_rss_kb;
+    int tree_count;
+} ProcEntry;
+
+// Usage summed over every process sharing a UID or a command name
+typedef struct {
+    uid_t uid;
+    char name[64];
+    int count;
+    double cpu_pct;
+    double io_rate;
+    unsigned long long rss_kb;
+} ProcGroup;
+
+typedef struct {
+    ProcGroup *groups;                  // dense, rebuilt every scan
+    int count;
+    int capacity;
+    int *index;                         // open addressing: group index or -1
+    int index_size;                     // power of two
+    int by_name;                        // key is name instead of uid
+} GroupTable;
+
+typedef struct {
+    ProcEntry *entries;                 // dense, count valid entries
+    int count;
+    int capacity;
+    int *index;                         // hash slots: entry index, or -1 empty, -2 deleted
+    int index_size;                     // power of two
+    int index_used;                     // occupied + deleted slots
+    unsigned int generation;
+    struct timespec last_scan;
+    double last_elapsed;                // seconds between the last two scans
+
+    // Leak detection settings, see proctable_set_trend()
+    int trend_window;                   // samples per regression window
+    double trend_min_kb_per_min;        // slope needed to flag a process
+    double trend_min_r2;                // how steady the growth must be
+    int flags;                          // PROC_COLLECT_*
+    long page_kb;
+    long clk_tck;
+
+    // Process tree in CSR form: the children of entry i are
+    // tree_children[tree_start[i] .. tree_start[i + 1]), and the roots are
+    // the children of the virtual entry `count`.
+    int *tree_start;
+    int *tree_children;
+    int *tree_order;                    // breadth-first, parents before children
+    int tree_capacity;
+
+    GroupTable by_user;                 // valid when PROC_GROUP_BY_USER is set
+    GroupTable by_comm;                 // valid when PROC_GROUP_BY_COMM is set
+} ProcTable;
+
+int proctable_init(ProcTable *table, int flags);
+void proctable_free(ProcTable *table);
+int proctable_scan(ProcTable *table);
+ProcEntry *proctable_find(ProcTable *table, int pid);
+int proctable_build_tree(ProcTable *table);
+int proctable_sample_sched(ProcTable *table, ProcEntry **candidates, int n);
+int proctable_set_trend(ProcTable *table, int window, double min_kb_per_min);
+double proctable_growth_kb_per_min(const ProcTable *table, const ProcEntry *e);
+
+#endif
@@ -0,0 +1,896 @@
+/*
+ * Metric recorder with rollup tiers
+ */
+
+// splice()
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/sendfile.h>
+
+#include "metric_schema.h"
+#include "recorder.h"
+
+#define HOUR_MS (3600LL * 1000)
+#define DAY_MS  (24 * HOUR_MS)
+
+static const struct {
+    const char *name;
+    int64_t bucket_ms;
+    int64_t segment_ms;
+    int64_t retention_ms;
+} tier_specs[REC_TIERS] = {
+    { "raw", 0,          HOUR_MS,     DAY_MS },
+    { "10s", 10000,      DAY_MS,      7 * DAY_MS },
+    { "1m",  60000,      7 * DAY_MS,  90 * DAY_MS },
+    { "1h",  HOUR_MS,    30 * DAY_MS, 0 },
+};
+
+// FNV-1a, the same hash the process table uses for command names
+static unsigned int hash_name(const char *s) {
+    unsigned int h = 2166136261u;
+    while (*s) {
+        h ^= (unsigned char)*s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static int points_capacity(const Recorder *rec) {
+    // A rollup tier writes one point per metric when a bucket closes
+    return rec->metric_capacity > REC_BLOCK_POINTS ? rec->metric_capacity : REC_BLOCK_POINTS;
+}
+
+static int grow_metrics(Recorder *rec) {
+    int old = rec->metric_capacity;
+    int cap = old ? old * 2 : 64;
+
+    RecMetric *metrics = realloc(rec->metrics, (size_t)cap * sizeof(RecMetric));
+    if (!metrics) {
+        return -1;
+    }
+    rec->metrics = metrics;
+
+    for (int t = 0; t < REC_TIERS; t++) {
+        RecTier *tier = &rec->tiers[t];
+        int npoints = cap > REC_BLOCK_POINTS ? cap : REC_BLOCK_POINTS;
+
+        RecPoint *points = realloc(tier->points, (size_t)npoints * sizeof(RecPoint));
+        int *local_id = realloc(tier->local_id, (size_t)cap * sizeof(int));
+        int *block_metrics = realloc(tier->block_metrics, (size_t)cap * sizeof(int));
+        if (points) tier->points = points;
+        if (local_id) tier->local_id = local_id;
+        if (block_metrics) tier->block_metrics = block_metrics;
+        if (!points || !local_id || !block_metrics) {
+            return -1;
+        }
+        for (int i = old; i < cap; i++) {
+            tier->local_id[i] = -1;
+        }
+
+        if (tier->bucket_ms > 0) {
+            RecAgg *agg = realloc(tier->agg, (size_t)cap * sizeof(RecAgg));
+            if (!agg) {
+                return -1;
+            }
+            memset(agg + old, 0, (size_t)(cap - old) * sizeof(RecAgg));
+            tier->agg = agg;
+        }
+    }
+
+    rec->metric_capacity = cap;
+    return 0;
+}
+
+static int rehash(Recorder *rec, int size) {
+    int *index = malloc((size_t)size * sizeof(int));
+    if (!index) {
+        return -1;
+    }
+    memset(index, 0xff, (size_t)size * sizeof(int));
+
+    for (int i = 0; i < rec->nmetrics; i++) {
+        unsigned int slot = hash_name(rec->metrics[i].name) & (unsigned int)(size - 1);
+        while (index[slot] >= 0) {
+            slot = (slot + 1) & (unsigned int)(size - 1);
+        }
+        index[slot] = i;
+    }
+
+    free(rec->index);
+    rec->index = index;
+    rec->index_size = size;
+    return 0;
+}
+
+/*
+ * Id of a metric name, registering it on first sight
+ */
+static int metric_id(Recorder *rec, const char *name, const char *unit) {
+    unsigned int mask = (unsigned int)(rec->index_size - 1);
+    unsigned int slot = hash_name(name) & mask;
+
+    while (rec->index[slot] >= 0) {
+        if (strcmp(rec->metrics[rec->index[slot]].name, name) == 0) {
+            return rec->index[slot];
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    if (strlen(name) >= REC_NAME_MAX) {
+        return -1;
+    }
+    if (rec->nmetrics == rec->metric_capacity && grow_metrics(rec) != 0) {
+        return -1;
+    }
+
+    int id = rec->nmetrics++;
+    snprintf(rec->metrics[id].name, REC_NAME_MAX, "%s", name);
+    snprintf(rec->metrics[id].unit, REC_UNIT_MAX, "%s", unit ? unit : "");
+
+    // Keep the index at most half full
+    if (rec->nmetrics * 2 > rec->index_size) {
+        if (rehash(rec, rec->index_size * 2) != 0) {
+            rec->nmetrics--;
+            return -1;
+        }
+    } else {
+        rec->index[slot] = id;
+    }
+    return id;
+}
+
+static int parse_segment_name(const char *fname, const char *tier, long long *start_s) {
+    size_t len = strlen(tier);
+    if (strncmp(fname, tier, len) != 0 || fname[len] != '-') {
+        return -1;
+    }
+
+    char *end;
+    errno = 0;
+    long long start = strtoll(fname + len + 1, &end, 10);
+    if (errno != 0 || end == fname + len + 1 || strcmp(end, ".rec") != 0) {
+        return -1;
+    }
+    *start_s = start;
+    return 0;
+}
+
+/*
+ * Open (or create) the segment starting at start_ms for appending. A block
+ * cut short by a crash is truncated away so new blocks follow valid ones.
+ */
+static int open_segment(Recorder *rec, int t, int64_t start_ms) {
+    RecTier *tier = &rec->tiers[t];
+    char path[512];
+
+    if (tier->fd >= 0) {
+        close(tier->fd);
+        tier->fd = -1;
+    }
+
+    snprintf(path, sizeof(path), "%s/%s-%lld.rec", rec->dir, tier->name, (long long)(start_ms / 1000));
+    int fd = open(path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    if (st.st_size == 0) {
+        if (recorder_write_header(fd, (uint32_t)tier->bucket_ms, start_ms) != 0) {
+            close(fd);
+            return -1;
+        }
+    } else {
+        RecFileHeader fh;
+        if (pread(fd, &fh, sizeof(fh), 0) != (ssize_t)sizeof(fh) ||
+            memcmp(fh.magic, REC_FILE_MAGIC, sizeof(fh.magic)) != 0 ||
+            fh.bucket_ms != (uint32_t)tier->bucket_ms) {
+            close(fd);
+            errno = EINVAL;
+            return -1;
+        }
+
+        off_t off = sizeof(fh);
+        RecBlockHeader bh;
+        while (off + (off_t)sizeof(bh) <= st.st_size &&
+               pread(fd, &bh, sizeof(bh), off) == (ssize_t)sizeof(bh) &&
+               bh.magic == REC_BLOCK_MAGIC &&
+               off + (off_t)sizeof(bh) + bh.length <= st.st_size) {
+            off += (off_t)sizeof(bh) + bh.length;
+        }
+        if (off < st.st_size && ftruncate(fd, off) != 0) {
+            close(fd);
+            return -1;
+        }
+    }
+
+    tier->fd = fd;
+    tier->segment_start_ms = start_ms;
+
+    if (tier->retention_ms > 0) {
+        recorder_expire(rec, t, rec->now_ms - tier->retention_ms);
+    }
+    return 0;
+}
+
+int recorder_write_header(int fd, uint32_t bucket_ms, int64_t start_ms) {
+    RecFileHeader fh;
+    memset(&fh, 0, sizeof(fh));
+    memcpy(fh.magic, REC_FILE_MAGIC, sizeof(fh.magic));
+    fh.version = REC_VERSION;
+    fh.bucket_ms = bucket_ms;
+    fh.start_ms = start_ms;
+    return write(fd, &fh, sizeof(fh)) == (ssize_t)sizeof(fh) ? 0 : -1;
+}
+
+/*
+ * Append one block with a single writev(). Name table slot i is
+ * metrics[order[i]], or metrics[i] without an order.
+ */
+int recorder_write_block(int fd, const RecMetric *metrics, const int *order, int nnames,
+                         const RecPoint *points, int npoints, int64_t first_ms, int64_t last_ms) {
+    size_t names_len = 0;
+    for (int i = 0; i < nnames; i++) {
+        const RecMetric *m = &metrics[order ? order[i] : i];
+        names_len += 2 + strlen(m->name) + strlen(m->unit);
+    }
+    names_len = (names_len + 7) & ~(size_t)7;
+
+    char *names = calloc(1, names_len ? names_len : 1);
+    if (!names) {
+        return -1;
+    }
+
+    char *p = names;
+    for (int i = 0; i < nnames; i++) {
+        const RecMetric *m = &metrics[order ? order[i] : i];
+        size_t nl = strlen(m->name), ul = strlen(m->unit);
+        *p++ = (char)nl;
+        *p++ = (char)ul;
+        memcpy(p, m->name, nl);
+        p += nl;
+        memcpy(p, m->unit, ul);
+        p += ul;
+    }
+
+    RecBlockHeader bh;
+    bh.magic = REC_BLOCK_MAGIC;
+    bh.nnames = (uint32_t)nnames;
+    bh.npoints = (uint32_t)npoints;
+    bh.length = (uint32_t)(names_len + (size_t)npoints * sizeof(RecPoint));
+    bh.first_ms = first_ms;
+    bh.last_ms = last_ms;
+
+    struct iovec iov[3] = {
+        { &bh, sizeof(bh) },
+        { names, names_len },
+        { (void *)points, (size_t)npoints * sizeof(RecPoint) },
+    };
+    ssize_t want = (ssize_t)(sizeof(bh) + bh.length);
+    ssize_t n = writev(fd, iov, 3);
+    free(names);
+
+    if (n != want) {
+        // Leave no partial block behind for the next one to follow
+        if (n > 0) {
+            struct stat st;
+            if (fstat(fd, &st) == 0) {
+                int ignored = ftruncate(fd, st.st_size - n);
+                (void)ignored;
+            }
+        }
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Copy bytes [offset, offset + length) of a segment to out_fd inside the
+ * kernel: sendfile() where the target allows it, splice() for pipes that
+ * sendfile() refuses, and a read/write loop only as a last resort.
+ */
+static int send_range(int out_fd, int in_fd, off_t offset, size_t length) {
+    int method = 0;                     // 0 sendfile, 1 splice, 2 copy
+
+    while (length > 0) {
+        ssize_t n;
+        if (method == 0) {
+            n = sendfile(out_fd, in_fd, &offset, length);
+        } else if (method == 1) {
+            loff_t off = offset;
+            n = splice(in_fd, &off, out_fd, NULL, length, SPLICE_F_MORE);
+            if (n > 0) offset = off;
+        } else {
+            char buf[65536];
+            n = pread(in_fd, buf, length < sizeof(buf) ? length : sizeof(buf), offset);
+            if (n > 0) {
+                ssize_t done = 0;
+                while (done < n) {
+                    ssize_t w = write(out_fd, buf + done, (size_t)(n - done));
+                    if (w < 0 && errno == EINTR) continue;
+                    if (w <= 0) return -1;
+                    done += w;
+                }
+                offset += n;
+            }
+        }
+
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EINVAL || errno == ENOSYS) && method < 2) {
+            method++;
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        length -= (size_t)n;
+    }
+    return 0;
+}
+
+/*
+ * Forward a block that was just written. A failed or closed receiver stops
+ * shipping; recording carries on.
+ */
+static void ship_block(Recorder *rec, int t, off_t offset, size_t length) {
+    RecTier *tier = &rec->tiers[t];
+    RecShipHeader sh;
+
+    sh.magic = REC_SHIP_MAGIC;
+    sh.tier = (uint32_t)t;
+    sh.bucket_ms = (uint32_t)tier->bucket_ms;
+    sh.length = (uint32_t)length;
+    sh.segment_start_ms = tier->segment_start_ms;
+
+    ssize_t n;
+    do {
+        n = write(rec->ship_fd, &sh, sizeof(sh));
+    } while (n < 0 && errno == EINTR);
+
+    if (n != (ssize_t)sizeof(sh) || send_range(rec->ship_fd, tier->fd, offset, length) != 0) {
+        rec->ship_fd = -1;
+        rec->ship_errors++;
+        return;
+    }
+    rec->shipped_bytes += length;
+}
+
+/*
+ * Write the block being built, rotating segments as needed
+ */
+static int flush_block(Recorder *rec, int t) {
+    RecTier *tier = &rec->tiers[t];
+    if (tier->npoints == 0) {
+        return 0;
+    }
+
+    int rc = 0;
+    int64_t segment = tier->first_ms - tier->first_ms % tier->segment_ms;
+    if (tier->fd < 0 || segment != tier->segment_start_ms) {
+        rc = open_segment(rec, t, segment);
+    }
+    off_t start = (rc == 0) ? lseek(tier->fd, 0, SEEK_END) : -1;
+    if (rc == 0) {
+        rc = recorder_write_block(tier->fd, rec->metrics, tier->block_metrics, tier->nnames,
+                                  tier->points, tier->npoints, tier->first_ms, tier->last_ms);
+    }
+    if (rc == 0 && rec->ship_fd >= 0 && start >= 0) {
+        off_t end = lseek(tier->fd, 0, SEEK_CUR);
+        if (end > start) {
+            ship_block(rec, t, start, (size_t)(end - start));
+        }
+    }
+
+    // The block is dropped on error too, so memory stays bounded
+    for (int i = 0; i < tier->nnames; i++) {
+        tier->local_id[tier->block_metrics[i]] = -1;
+    }
+    tier->nnames = 0;
+    tier->npoints = 0;
+
+    if (rc != 0) {
+        rec->write_errors++;
+    }
+    return rc;
+}
+
+static int append_point(Recorder *rec, int t, int metric, int64_t t_ms,
+                        uint32_t count, double min, double max, double sum) {
+    RecTier *tier = &rec->tiers[t];
+    int rc = 0;
+
+    if (tier->npoints == points_capacity(rec)) {
+        rc = flush_block(rec, t);
+    }
+
+    if (tier->local_id[metric] < 0) {
+        tier->local_id[metric] = tier->nnames;
+        tier->block_metrics[tier->nnames++] = metric;
+    }
+
+    RecPoint *p = &tier->points[tier->npoints++];
+    p->t_ms = t_ms;
+    p->metric = (uint32_t)tier->local_id[metric];
+    p->count = count;
+    p->min = min;
+    p->max = max;
+    p->sum = sum;
+
+    if (tier->npoints == 1 || t_ms < tier->first_ms) tier->first_ms = t_ms;
+    if (tier->npoints == 1 || t_ms > tier->last_ms) tier->last_ms = t_ms;
+    return rc;
+}
+
+/*
+ * Turn a rollup tier's finished bucket into one point per metric and write it
+ */
+static int close_bucket(Recorder *rec, int t) {
+    RecTier *tier = &rec->tiers[t];
+    int rc = 0;
+
+    for (int m = 0; m < rec->nmetrics; m++) {
+        RecAgg *a = &tier->agg[m];
+        if (a->count == 0) {
+            continue;
+        }
+        if (append_point(rec, t, m, tier->bucket_start_ms, a->count, a->min, a->max, a->sum) != 0) {
+            rc = -1;
+        }
+        a->count = 0;
+    }
+    if (flush_block(rec, t) != 0) {
+        rc = -1;
+    }
+    return rc;
+}
+
+int recorder_open(Recorder *rec, const char *dir) {
+    memset(rec, 0, sizeof(*rec));
+
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        return -1;
+    }
+    snprintf(rec->dir, sizeof(rec->dir), "%s", dir);
+
+    for (int t = 0; t < REC_TIERS; t++) {
+        rec->tiers[t].name = tier_specs[t].name;
+        rec->tiers[t].bucket_ms = tier_specs[t].bucket_ms;
+        rec->tiers[t].segment_ms = tier_specs[t].segment_ms;
+        rec->tiers[t].retention_ms = tier_specs[t].retention_ms;
+        rec->tiers[t].fd = -1;
+        rec->tiers[t].bucket_start_ms = -1;
+    }
+    rec->ship_fd = -1;
+
+    if (grow_metrics(rec) != 0 || rehash(rec, 128) != 0) {
+        recorder_close(rec);
+        return -1;
+    }
+
+    // Schema metrics take the first ids so every recording numbers them alike
+    for (int i = 0; i < METRIC_SCHEMA_COUNT; i++) {
+        if (metric_id(rec, metric_schema[i].name, metric_schema[i].unit) < 0) {
+            recorder_close(rec);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Start writing the sample taken at `taken`. Rollup buckets that this
+ * sample falls past are closed and written first.
+ */
+void recorder_begin(Recorder *rec, const struct timespec *taken) {
+    rec->now_ms = (int64_t)taken->tv_sec * 1000 + taken->tv_nsec / 1000000;
+
+    for (int t = 0; t < REC_TIERS; t++) {
+        RecTier *tier = &rec->tiers[t];
+        if (tier->bucket_ms == 0) {
+            continue;
+        }
+        int64_t bucket = rec->now_ms - rec->now_ms % tier->bucket_ms;
+        if (bucket != tier->bucket_start_ms) {
+            if (tier->bucket_start_ms >= 0) {
+                close_bucket(rec, t);
+            }
+            tier->bucket_start_ms = bucket;
+        }
+    }
+}
+
+void recorder_emit(void *ctx, const char *name, double value, const char *unit) {
+    Recorder *rec = ctx;
+    int id = metric_id(rec, name, unit);
+    if (id < 0) {
+        rec->write_errors++;
+        return;
+    }
+
+    append_point(rec, REC_TIER_RAW, id, rec->now_ms, 1, value, value, value);
+
+    for (int t = 0; t < REC_TIERS; t++) {
+        if (rec->tiers[t].bucket_ms == 0) {
+            continue;
+        }
+        RecAgg *a = &rec->tiers[t].agg[id];
+        if (a->count == 0) {
+            a->min = a->max = a->sum = value;
+        } else {
+            if (value < a->min) a->min = value;
+            if (value > a->max) a->max = value;
+            a->sum += value;
+        }
+        a->count++;
+    }
+}
+
+/*
+ * Finish a sample; raw blocks are written once they span REC_BLOCK_SPAN_MS
+ */
+int recorder_end(Recorder *rec) {
+    RecTier *raw = &rec->tiers[REC_TIER_RAW];
+
+    rec->samples++;
+    if (raw->npoints > 0 && raw->last_ms - raw->first_ms >= REC_BLOCK_SPAN_MS) {
+        return flush_block(rec, REC_TIER_RAW);
+    }
+    return 0;
+}
+
+int recorder_write_snapshot(Recorder *rec, const Snapshot *snap) {
+    if (snap->seq == 0) {
+        return 0;
+    }
+    recorder_begin(rec, &snap->taken);
+    snapshot_export(snap, recorder_emit, rec);
+    return recorder_end(rec);
+}
+
+/*
+ * Write partial buckets and pending blocks now
+ */
+void recorder_flush(Recorder *rec) {
+    for (int t = 0; t < REC_TIERS; t++) {
+        RecTier *tier = &rec->tiers[t];
+        if (!tier->points) {
+            continue;
+        }
+        if (tier->bucket_ms > 0 && tier->bucket_start_ms >= 0) {
+            close_bucket(rec, t);
+        }
+        flush_block(rec, t);
+    }
+}
+
+/*
+ * Flush, then release everything
+ */
+void recorder_close(Recorder *rec) {
+    recorder_flush(rec);
+    for (int t = 0; t < REC_TIERS; t++) {
+        RecTier *tier = &rec->tiers[t];
+        if (tier->fd >= 0) {
+            close(tier->fd);
+        }
+        free(tier->points);
+        free(tier->local_id);
+        free(tier->block_metrics);
+        free(tier->agg);
+    }
+    free(rec->metrics);
+    free(rec->index);
+    memset(rec, 0, sizeof(*rec));
+    for (int t = 0; t < REC_TIERS; t++) {
+        rec->tiers[t].fd = -1;
+    }
+    rec->ship_fd = -1;
+}
+
+/*
+ * Open a shipping target: "-" for stdout, a Unix stream socket, or anything
+ * that can be opened for writing (FIFO, file, character device)
+ */
+int recorder_ship_open(const char *target) {
+    if (strcmp(target, "-") == 0) {
+        return dup(STDOUT_FILENO);
+    }
+
+    struct stat st;
+    if (stat(target, &st) == 0 && S_ISSOCK(st.st_mode)) {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (strlen(target) >= sizeof(addr.sun_path)) {
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+        strcpy(addr.sun_path, target);
+
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            return -1;
+        }
+        if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    return open(target, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+}
+
+void recorder_ship_to(Recorder *rec, int fd) {
+    rec->ship_fd = fd;
+}
+
+void recorder_set_retention(Recorder *rec, int tier, int64_t retention_ms) {
+    if (tier >= 0 && tier < REC_TIERS && retention_ms >= 0) {
+        rec->tiers[tier].retention_ms = retention_ms;
+    }
+}
+
+/*
+ * Returns the number of segments removed, or -1 if the directory is unreadable
+ */
+int recorder_expire(Recorder *rec, int t, int64_t before_ms) {
+    if (t < 0 || t >= REC_TIERS) {
+        return -1;
+    }
+
+    RecTier *tier = &rec->tiers[t];
+    DIR *dir = opendir(rec->dir);
+    if (!dir) {
+        return -1;
+    }
+
+    int removed = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        long long start_s;
+        if (parse_segment_name(entry->d_name, tier->name, &start_s) != 0) {
+            continue;
+        }
+
+        int64_t start_ms = (int64_t)start_s * 1000;
+        if (tier->fd >= 0 && start_ms == tier->segment_start_ms) {
+            continue;
+        }
+        // A raw block may run REC_BLOCK_SPAN_MS past its segment's end
+        if (start_ms + tier->segment_ms + REC_BLOCK_SPAN_MS <= before_ms &&
+            unlinkat(dirfd(dir), entry->d_name, 0) == 0) {
+            removed++;
+        }
+    }
+    closedir(dir);
+    return removed;
+}
+
+int recorder_tier_index(const char *name) {
+    for (int t = 0; t < REC_TIERS; t++) {
+        if (strcmp(tier_specs[t].name, name) == 0) {
+            return t;
+        }
+    }
+    return -1;
+}
+
+const char *recorder_tier_name(int tier) {
+    return (tier >= 0 && tier < REC_TIERS) ? tier_specs[tier].name : NULL;
+}
+
+int64_t recorder_tier_bucket_ms(int tier) {
+    return (tier >= 0 && tier < REC_TIERS) ? tier_specs[tier].bucket_ms : -1;
+}
+
+static int cmp_start(const void *a, const void *b) {
+    long long sa = *(const long long *)a;
+    long long sb = *(const long long *)b;
+    return (sa > sb) - (sa < sb);
+}
+
+/*
+ * Walk the blocks of a mapped segment. Returns -1 if the file header is not
+ * a recording's.
+ */
+int recorder_blocks_init(RecBlockIter *it, const void *base, size_t size) {
+    memset(it, 0, sizeof(*it));
+    if (size < sizeof(RecFileHeader) ||
+        memcmp(((const RecFileHeader *)base)->magic, REC_FILE_MAGIC, 8) != 0) {
+        return -1;
+    }
+    it->base = base;
+    it->size = size;
+    it->off = sizeof(RecFileHeader);
+    it->bucket_ms = ((const RecFileHeader *)base)->bucket_ms;
+    return 0;
+}
+
+/*
+ * Move to the next valid block overlapping [from_ms, to_ms] and decode its
+ * name table. Returns 1 with it->block/names/points set, 0 at the end of
+ * the segment (or at a truncated block), -1 if out of memory.
+ */
+int recorder_blocks_next(RecBlockIter *it, int64_t from_ms, int64_t to_ms) {
+    while (it->off + sizeof(RecBlockHeader) <= it->size) {
+        const RecBlockHeader *bh = (const RecBlockHeader *)(it->base + it->off);
+        if (bh->magic != REC_BLOCK_MAGIC || bh->length > it->size - it->off - sizeof(RecBlockHeader)) {
+            return 0;
+        }
+        const char *body = it->base + it->off + sizeof(RecBlockHeader);
+        it->off += sizeof(RecBlockHeader) + bh->length;
+
+        if (bh->last_ms < from_ms || bh->first_ms > to_ms) {
+            continue;
+        }
+
+        if (bh->nnames > it->names_capacity) {
+            RecMetric *grown = realloc(it->names, bh->nnames * sizeof(RecMetric));
+            if (!grown) {
+                return -1;
+            }
+            it->names = grown;
+            it->names_capacity = bh->nnames;
+        }
+
+        // Decode the name table, skipping the block if it does not add up
+        const char *p = body;
+        const char *end = body + bh->length;
+        uint32_t i;
+        for (i = 0; i < bh->nnames; i++) {
+            if (end - p < 2) break;
+            size_t nl = (unsigned char)p[0], ul = (unsigned char)p[1];
+            if (nl >= REC_NAME_MAX || ul >= REC_UNIT_MAX || (size_t)(end - p) < 2 + nl + ul) break;
+            memcpy(it->names[i].name, p + 2, nl);
+            it->names[i].name[nl] = '\0';
+            memcpy(it->names[i].unit, p + 2 + nl, ul);
+            it->names[i].unit[ul] = '\0';
+            p += 2 + nl + ul;
+        }
+        size_t names_len = ((size_t)(p - body) + 7) & ~(size_t)7;
+        if (i < bh->nnames || names_len + (size_t)bh->npoints * sizeof(RecPoint) != bh->length) {
+            continue;
+        }
+
+        it->block = bh;
+        it->points = (const RecPoint *)(body + names_len);
+        return 1;
+    }
+    return 0;
+}
+
+void recorder_blocks_free(RecBlockIter *it) {
+    free(it->names);
+    it->names = NULL;
+    it->names_capacity = 0;
+}
+
+/*
+ * Deliver one mapped segment's points within [from_ms, to_ms].
+ * Returns the number delivered, or -1 once fn asked to stop.
+ */
+static long long read_segment(const char *base, size_t size, int64_t from_ms, int64_t to_ms,
+                              rec_point_fn fn, void *ctx) {
+    long long delivered = 0;
+    RecBlockIter it;
+
+    if (recorder_blocks_init(&it, base, size) != 0) {
+        return 0;
+    }
+    while (recorder_blocks_next(&it, from_ms, to_ms) > 0) {
+        for (uint32_t k = 0; k < it.block->npoints; k++) {
+            const RecPoint *pt = &it.points[k];
+            if (pt->t_ms < from_ms || pt->t_ms > to_ms || pt->metric >= it.block->nnames) {
+                continue;
+            }
+            if (fn(ctx, it.names[pt->metric].name, it.names[pt->metric].unit, pt) != 0) {
+                recorder_blocks_free(&it);
+                return -1;
+            }
+            delivered++;
+        }
+    }
+
+    recorder_blocks_free(&it);
+    return delivered;
+}
+
+/*
+ * Read back one tier's points within [from_ms, to_ms], oldest segment
+ * first. Returns the number of points delivered, or -1 on error.
+ */
+int recorder_read(const char *dir_path, int t, int64_t from_ms, int64_t to_ms,
+                  rec_point_fn fn, void *ctx) {
+    if (t < 0 || t >= REC_TIERS) {
+        return -1;
+    }
+
+    DIR *dir = opendir(dir_path);
+    if (!dir) {
+        return -1;
+    }
+
+    long long *starts = NULL;
+    int count = 0, capacity = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        long long start_s;
+        if (parse_segment_name(entry->d_name, tier_specs[t].name, &start_s) != 0) {
+            continue;
+        }
+        int64_t start_ms = (int64_t)start_s * 1000;
+        if (start_ms > to_ms || start_ms + tier_specs[t].segment_ms + REC_BLOCK_SPAN_MS < from_ms) {
+            continue;
+        }
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 16;
+            long long *grown = realloc(starts, (size_t)capacity * sizeof(long long));
+            if (!grown) {
+                free(starts);
+                closedir(dir);
+                return -1;
+            }
+            starts = grown;
+        }
+        starts[count++] = start_s;
+    }
+    closedir(dir);
+    qsort(starts, (size_t)count, sizeof(long long), cmp_start);
+
+    long long total = 0;
+    for (int i = 0; i < count; i++) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s-%lld.rec", dir_path, tier_specs[t].name, starts[i]);
+
+        int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            continue;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(RecFileHeader)) {
+            close(fd);
+            continue;
+        }
+        char *base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (base == MAP_FAILED) {
+            continue;
+        }
+
+        // Segments with a foreign header are skipped
+        long long n = 0;
+        const RecFileHeader *fh = (const RecFileHeader *)base;
+        if (fh->bucket_ms == (uint32_t)tier_specs[t].bucket_ms) {
+            n = read_segment(base, (size_t)st.st_size, from_ms, to_ms, fn, ctx);
+        }
+        munmap(base, (size_t)st.st_size);
+
+        if (n < 0) {
+            break;
+        }
+        total += n;
+    }
+
+    free(starts);
+    return (int)(total > 0x7fffffff ? 0x7fffffff : total);
+}
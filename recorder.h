@@ -0,0 +1,192 @@
+/*
+ * Metric recorder
+ *
+ * Appends every exported metric to a recording directory at several
+ * resolutions. The raw tier keeps each sample as taken; the coarser tiers
+ * keep min/max/sum/count per metric per bucket, folded in as samples are
+ * written, so reading a week of history touches only the 1 h tier.
+ *
+ * Each tier is a series of segment files "<tier>-<start seconds>.rec": a
+ * RecFileHeader followed by self-contained blocks (RecBlockHeader, the
+ * block's metric names, then its points). A tier expires by unlinking its
+ * old segments, independently of the other tiers.
+ *
+ * With shipping enabled, each block is forwarded as soon as it is on disk:
+ * a RecShipHeader written normally, then the block bytes copied from the
+ * segment file by the kernel (sendfile/splice), so shipped data never
+ * passes through a user-space buffer.
+ */
+
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "sampler.h"
+
+#define REC_FILE_MAGIC "SYSMREC1"
+#define REC_BLOCK_MAGIC 0x4b4c4253u    // "SBLK"
+#define REC_VERSION 1
+
+#define REC_TIER_RAW 0
+#define REC_TIER_10S 1
+#define REC_TIER_1M  2
+#define REC_TIER_1H  3
+#define REC_TIERS    4
+
+// Raw blocks are closed after this many points or this much time
+#define REC_BLOCK_POINTS  1024
+#define REC_BLOCK_SPAN_MS 10000
+
+#define REC_NAME_MAX 64
+#define REC_UNIT_MAX 16
+
+// On-disk layouts, host byte order
+typedef struct {
+    char magic[8];                      // REC_FILE_MAGIC
+    uint32_t version;
+    uint32_t bucket_ms;                 // 0 for the raw tier
+    int64_t start_ms;                   // segment start, ms since the epoch
+} RecFileHeader;
+
+typedef struct {
+    uint32_t magic;                     // REC_BLOCK_MAGIC
+    uint32_t length;                    // bytes after this header
+    uint32_t nnames;                    // name table entries
+    uint32_t npoints;
+    int64_t first_ms;
+    int64_t last_ms;
+} RecBlockHeader;
+
+// Frame in front of every shipped block
+#define REC_SHIP_MAGIC 0x50494853u     // "SHIP"
+
+typedef struct {
+    uint32_t magic;                     // REC_SHIP_MAGIC
+    uint32_t tier;                      // REC_TIER_*
+    uint32_t bucket_ms;
+    uint32_t length;                    // bytes of block that follow
+    int64_t segment_start_ms;           // segment the block was appended to
+} RecShipHeader;
+
+// Name table entry: uint8 name length, uint8 unit length, then both strings
+// unterminated; the table is padded to 8 bytes so the points stay aligned.
+typedef struct {
+    int64_t t_ms;                       // sample time, or bucket start for rollups
+    uint32_t metric;                    // index into the block's name table
+    uint32_t count;                     // samples folded in, 1 in the raw tier
+    double min, max, sum;
+} RecPoint;
+
+typedef struct {
+    char name[REC_NAME_MAX];
+    char unit[REC_UNIT_MAX];
+} RecMetric;
+
+typedef struct {
+    double min, max, sum;
+    uint32_t count;
+} RecAgg;
+
+typedef struct {
+    const char *name;                   // "raw", "10s", "1m", "1h"
+    int64_t bucket_ms;
+    int64_t segment_ms;                 // time covered by one segment file
+    int64_t retention_ms;               // 0 = keep forever
+
+    int fd;
+    int64_t segment_start_ms;
+    int64_t bucket_start_ms;
+    RecAgg *agg;                        // per metric, current bucket (rollups only)
+
+    // Block being built
+    RecPoint *points;
+    int npoints;
+    int *local_id;                      // metric -> name table slot, -1 if absent
+    int *block_metrics;                 // metrics in the name table, in slot order
+    int nnames;
+    int64_t first_ms, last_ms;
+} RecTier;
+
+typedef struct {
+    char dir[256];
+    RecMetric *metrics;
+    int nmetrics;
+    int metric_capacity;
+    int *index;                         // open addressing on the metric name
+    int index_size;
+    int64_t now_ms;                     // time of the sample being written
+    RecTier tiers[REC_TIERS];
+    unsigned long long samples;
+    int write_errors;
+
+    int ship_fd;                        // -1 unless shipping
+    unsigned long long shipped_bytes;
+    int ship_errors;
+} Recorder;
+
+// Position of a reader in a mapped segment, see recorder_blocks_next()
+typedef struct {
+    const char *base;
+    size_t size;
+    size_t off;                         // next block header
+    uint32_t bucket_ms;                 // from the file header
+    const RecBlockHeader *block;
+    const RecPoint *points;
+    RecMetric *names;                   // decoded name table of the block
+    uint32_t names_capacity;
+} RecBlockIter;
+
+// Called for each point read back; return non-zero to stop early
+typedef int (*rec_point_fn)(void *ctx, const char *name, const char *unit, const RecPoint *p);
+
+/*
+ * Writing. recorder_emit() is a sysmon_emit_fn and may also be fed
+ * directly between recorder_begin() and recorder_end().
+ */
+int recorder_open(Recorder *rec, const char *dir);
+void recorder_begin(Recorder *rec, const struct timespec *taken);
+void recorder_emit(void *ctx, const char *name, double value, const char *unit);
+int recorder_end(Recorder *rec);
+int recorder_write_snapshot(Recorder *rec, const Snapshot *snap);
+void recorder_flush(Recorder *rec);
+void recorder_close(Recorder *rec);
+
+/*
+ * Shipping. recorder_ship_open() connects to a target path ("-" = stdout,
+ * a Unix socket, a FIFO or a file); recorder_ship_to() starts forwarding
+ * every finished block to fd. The caller keeps ownership of fd. Shipping
+ * stops (ship_fd back to -1) if the receiver goes away.
+ */
+int recorder_ship_open(const char *target);
+void recorder_ship_to(Recorder *rec, int fd);
+
+/*
+ * Retention. recorder_expire() unlinks the tier's segments holding only
+ * data older than before_ms; it is also run on every segment rotation with
+ * the tier's retention.
+ */
+void recorder_set_retention(Recorder *rec, int tier, int64_t retention_ms);
+int recorder_expire(Recorder *rec, int tier, int64_t before_ms);
+
+/*
+ * Reading
+ */
+int recorder_tier_index(const char *name);
+const char *recorder_tier_name(int tier);
+int64_t recorder_tier_bucket_ms(int tier);
+int recorder_read(const char *dir, int tier, int64_t from_ms, int64_t to_ms,
+                  rec_point_fn fn, void *ctx);
+
+/*
+ * Segment file primitives, for tools that read or write segments directly
+ */
+int recorder_write_header(int fd, uint32_t bucket_ms, int64_t start_ms);
+int recorder_write_block(int fd, const RecMetric *metrics, const int *order, int nnames,
+                         const RecPoint *points, int npoints, int64_t first_ms, int64_t last_ms);
+int recorder_blocks_init(RecBlockIter *it, const void *base, size_t size);
+int recorder_blocks_next(RecBlockIter *it, int64_t from_ms, int64_t to_ms);
+void recorder_blocks_free(RecBlockIter *it);
+
+#endif
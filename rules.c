@@ -0,0 +1,124 @@
+/*
+ * Alert rules checked against every snapshot
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fnmatch.h>
+
+#include "rules.h"
+
+static const char *op_names[] = { ">", ">=", "<", "<=" };
+
+int rule_add(RuleSet *set, const char *text) {
+    Rule rule;
+    char metric[64], op[3], extra[16];
+    double threshold;
+    int for_samples = 1;
+
+    memset(&rule, 0, sizeof(rule));
+    int fields = sscanf(text, "%63s %2[<>=] %lf %15s %d", metric, op, &threshold, extra, &for_samples);
+    if (fields != 3 && !(fields == 5 && strcmp(extra, "for") == 0 && for_samples > 0)) {
+        fprintf(stderr, "Error: Invalid alert '%s' (expected e.g. cpu.active > 90 for 3)\n", text);
+        return -1;
+    }
+
+    int found = 0;
+    for (int i = 0; i < 4; i++) {
+        if (strcmp(op, op_names[i]) == 0) {
+            rule.op = (RuleOp)i;
+            found = 1;
+        }
+    }
+    if (!found) {
+        fprintf(stderr, "Error: Invalid alert comparison '%s', use >, >=, < or <=\n", op);
+        return -1;
+    }
+    if (set->count >= MAX_RULES) {
+        fprintf(stderr, "Error: At most %d alerts\n", MAX_RULES);
+        return -1;
+    }
+
+    memcpy(rule.metric, metric, sizeof(rule.metric));
+    rule.threshold = threshold;
+    rule.for_samples = for_samples;
+    set->rules[set->count++] = rule;
+    return 0;
+}
+
+void rule_describe(const Rule *rule, char *buf, size_t size) {
+    if (rule->for_samples > 1) {
+        snprintf(buf, size, "%s %s %g for %d", rule->metric, op_names[rule->op],
+                 rule->threshold, rule->for_samples);
+    } else {
+        snprintf(buf, size, "%s %s %g", rule->metric, op_names[rule->op], rule->threshold);
+    }
+}
+
+static int same_rule(const Rule *a, const Rule *b) {
+    return strcmp(a->metric, b->metric) == 0 && a->op == b->op &&
+           a->threshold == b->threshold && a->for_samples == b->for_samples;
+}
+
+void rules_carry_over(RuleSet *next, const RuleSet *prev) {
+    for (int i = 0; i < next->count; i++) {
+        for (int j = 0; j < prev->count; j++) {
+            if (same_rule(&next->rules[i], &prev->rules[j])) {
+                next->rules[i] = prev->rules[j];
+                break;
+            }
+        }
+    }
+}
+
+static int crosses(const Rule *rule, double value) {
+    switch (rule->op) {
+        case RULE_GT: return value > rule->threshold;
+        case RULE_GE: return value >= rule->threshold;
+        case RULE_LT: return value < rule->threshold;
+        case RULE_LE: return value <= rule->threshold;
+    }
+    return 0;
+}
+
+static void check_metric(void *ctx, const char *name, double value, const char *unit) {
+    RuleSet *set = ctx;
+    (void)unit;
+
+    for (int i = 0; i < set->count; i++) {
+        Rule *rule = &set->rules[i];
+        if (rule->held || fnmatch(rule->metric, name, 0) != 0 || !crosses(rule, value)) {
+            continue;
+        }
+        rule->held = 1;
+        rule->value = value;
+        snprintf(rule->culprit, sizeof(rule->culprit), "%s", name);
+    }
+}
+
+void rules_check(RuleSet *set, const Snapshot *snap, rule_alert_fn alert, void *ctx) {
+    if (set->count == 0) {
+        return;
+    }
+
+    for (int i = 0; i < set->count; i++) {
+        set->rules[i].held = 0;
+    }
+    snapshot_export(snap, check_metric, set);
+
+    for (int i = 0; i < set->count; i++) {
+        Rule *rule = &set->rules[i];
+        if (!rule->held) {
+            rule->streak = 0;
+        } else if (rule->streak < rule->for_samples) {
+            rule->streak++;
+        }
+
+        int firing = rule->streak >= rule->for_samples;
+        if (firing != rule->firing) {
+            rule->firing = firing;
+            alert(rule, firing, ctx);
+        }
+    }
+}
@@ -0,0 +1,70 @@
+/*
+ * Alert rules
+ *
+ * A rule compares one exported metric against a threshold on every
+ * sample, e.g. from the config file:
+ *
+ *     alert = cpu.active > 90
+ *     alert = mem.used_pct >= 95 for 3
+ *     alert = disk.*.util > 80
+ *
+ * The metric may be a glob matching several names; the rule holds while
+ * any of them crosses the threshold. "for N" waits for N samples in a row
+ * before firing. The caller is told when a rule starts and stops firing,
+ * not on every sample it holds.
+ */
+
+#ifndef RULES_H
+#define RULES_H
+
+#include <stddef.h>
+
+#include "sampler.h"
+
+#define MAX_RULES 32
+
+typedef enum {
+    RULE_GT,
+    RULE_GE,
+    RULE_LT,
+    RULE_LE
+} RuleOp;
+
+typedef struct {
+    char metric[64];                    // name or glob, e.g. disk.*.util
+    RuleOp op;
+    double threshold;
+    int for_samples;                    // samples in a row before firing, at least 1
+
+    // Evaluation state, carried over to the same rule on reload
+    int streak;                         // samples in a row the rule held
+    int firing;
+    int held;                           // held in the sample being checked
+    char culprit[64];                   // metric that crossed the threshold
+    double value;
+} Rule;
+
+typedef struct {
+    Rule rules[MAX_RULES];
+    int count;
+} RuleSet;
+
+// Parse "metric op value [for N]" and append it. Returns 0, or -1 with a message on stderr.
+int rule_add(RuleSet *set, const char *text);
+
+// "cpu.active > 90 for 3", the form rule_add() accepts
+void rule_describe(const Rule *rule, char *buf, size_t size);
+
+/*
+ * Keep the state of every rule in next that is also in prev, so a reload
+ * neither repeats an alert that is already firing nor restarts its count
+ */
+void rules_carry_over(RuleSet *next, const RuleSet *prev);
+
+// Called when a rule starts (firing = 1) or stops (firing = 0) firing
+typedef void (*rule_alert_fn)(const Rule *rule, int firing, void *ctx);
+
+// Check every rule against one snapshot
+void rules_check(RuleSet *set, const Snapshot *snap, rule_alert_fn alert, void *ctx);
+
+#endif
@@ -0,0 +1,442 @@
+/*
+ * Run configuration: getopt_long, config file and mode resolution
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <getopt.h>
+
+#include "runconfig.h"
+#include "format.h"
+
+#define WARMUP_DEFAULT_MS 100
+#define WARMUP_MIN_MS 10                // /proc/stat counts in 10 ms ticks
+#define WARMUP_MAX_MS 5000
+
+// Long-only options
+enum {
+    OPT_SHIP = 256,
+    OPT_WARMUP,
+    OPT_CONFIG,
+    OPT_PIN,
+    OPT_PIN_SAMPLER,
+    OPT_PIN_RENDER,
+    OPT_NICE,
+    OPT_IDLE,
+    OPT_MLOCK,
+    OPT_ALERT
+};
+
+static const struct option long_options[] = {
+    { "metrics",     required_argument, NULL, 'm' },
+    { "interval",    required_argument, NULL, 'c' },
+    { "count",       required_argument, NULL, 'n' },
+    { "format",      required_argument, NULL, 'f' },
+    { "once",        required_argument, NULL, 'F' },
+    { "top",         no_argument,       NULL, 't' },
+    { "record",      required_argument, NULL, 'R' },
+    { "statsd",      required_argument, NULL, 'S' },
+    { "ship",        required_argument, NULL, OPT_SHIP },
+    { "export",      required_argument, NULL, 'E' },
+    { "warmup",      required_argument, NULL, OPT_WARMUP },
+    { "config",      required_argument, NULL, OPT_CONFIG },
+    { "pin",         required_argument, NULL, OPT_PIN },
+    { "pin-sampler", required_argument, NULL, OPT_PIN_SAMPLER },
+    { "pin-render",  required_argument, NULL, OPT_PIN_RENDER },
+    { "nice",        required_argument, NULL, OPT_NICE },
+    { "idle",        no_argument,       NULL, OPT_IDLE },
+    { "mlock",       no_argument,       NULL, OPT_MLOCK },
+    { "alert",       required_argument, NULL, OPT_ALERT },
+    { "help",        no_argument,       NULL, 'h' },
+    { NULL, 0, NULL, 0 }
+};
+
+static const char short_options[] = "m:c:n:f:F:tR:S:E:h";
+
+int parse_duration_ms(const char *text, int bare_unit_ms) {
+    char *end;
+    errno = 0;
+    double value = strtod(text, &end);
+    if (end == text || errno != 0 || value <= 0) {
+        return -1;
+    }
+
+    double unit;
+    if (*end == '\0') unit = bare_unit_ms;
+    else if (strcmp(end, "ms") == 0) unit = 1;
+    else if (strcmp(end, "s") == 0) unit = 1000;
+    else if (strcmp(end, "m") == 0) unit = 60 * 1000;
+    else if (strcmp(end, "h") == 0) unit = 60 * 60 * 1000;
+    else return -1;
+
+    double ms = value * unit;
+    if (ms < 1 || ms > 24.0 * 60 * 60 * 1000) {
+        return -1;
+    }
+    return (int)(ms + 0.5);
+}
+
+void runconfig_init(RunConfig *cfg) {
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->format = RUN_FORMAT_TEXT;
+    cfg->warmup_ms = WARMUP_DEFAULT_MS;
+
+    // Kept from before --warmup existed
+    const char *env = getenv("SYSMON_WARMUP_MS");
+    if (env && atoi(env) > 0) {
+        int ms = atoi(env);
+        cfg->warmup_ms = ms < WARMUP_MIN_MS ? WARMUP_MIN_MS : ms > WARMUP_MAX_MS ? WARMUP_MAX_MS : ms;
+    }
+}
+
+static int copy_value(char *dst, size_t size, const char *key, const char *value) {
+    if (strlen(value) >= size || *value == '\0') {
+        fprintf(stderr, "Error: Invalid value for %s: '%s'\n", key, value);
+        return -1;
+    }
+    memcpy(dst, value, strlen(value) + 1);
+    return 0;
+}
+
+// yes/no for flags; an empty value (a bare command-line flag) means yes
+static int parse_flag(const char *value) {
+    if (*value == '\0' || strcmp(value, "yes") == 0 || strcmp(value, "true") == 0 ||
+        strcmp(value, "1") == 0 || strcmp(value, "on") == 0) {
+        return 1;
+    }
+    if (strcmp(value, "no") == 0 || strcmp(value, "false") == 0 ||
+        strcmp(value, "0") == 0 || strcmp(value, "off") == 0) {
+        return 0;
+    }
+    return -1;
+}
+
+static int set_pin(RunConfig *cfg, const char *key, const char *value) {
+    cpu_set_t set;
+    if (housekeeping_parse_cpus(value, &set) != 0) {
+        fprintf(stderr, "Error: Invalid CPU list '%s' (expected e.g. 0 or 0-1,6)\n", value);
+        return -1;
+    }
+    if (strcmp(key, "pin-render") != 0) {
+        cfg->housekeeping.sampler_cpus = set;
+        cfg->housekeeping.pin_sampler = 1;
+    }
+    if (strcmp(key, "pin-sampler") != 0) {
+        cfg->housekeeping.render_cpus = set;
+        cfg->housekeeping.pin_render = 1;
+    }
+    return 0;
+}
+
+int runconfig_set(RunConfig *cfg, const char *key, const char *value) {
+    if (strcmp(key, "metrics") == 0) {
+        return copy_value(cfg->metrics, sizeof(cfg->metrics), key, value);
+    }
+    if (strcmp(key, "interval") == 0) {
+        cfg->interval_ms = parse_duration_ms(value, 1000);
+        if (cfg->interval_ms < 0) {
+            fprintf(stderr, "Error: interval must be a positive duration such as 2, 2s or 500ms.\n");
+            return -1;
+        }
+        cfg->interval_set = 1;
+        return 0;
+    }
+    if (strcmp(key, "count") == 0) {
+        char *end;
+        long n = strtol(value, &end, 10);
+        if (*end != '\0' || n <= 0 || n > 1000000000L) {
+            fprintf(stderr, "Error: count needs a positive number of samples.\n");
+            return -1;
+        }
+        cfg->count = (int)n;
+        return 0;
+    }
+    if (strcmp(key, "format") == 0 || strcmp(key, "once") == 0) {
+        int format = strcmp(value, "text") == 0 ? RUN_FORMAT_TEXT : format_parse(value);
+        if (format == -1 && strcmp(value, "text") != 0) {
+            fprintf(stderr, "Error: Unknown format '%s'. Use json, csv, prom or text.\n", value);
+            return -1;
+        }
+        cfg->format = format;
+        cfg->once |= strcmp(key, "once") == 0;
+        return 0;
+    }
+    if (strcmp(key, "top") == 0 || strcmp(key, "help") == 0 ||
+        strcmp(key, "idle") == 0 || strcmp(key, "mlock") == 0) {
+        int on = parse_flag(value);
+        if (on < 0) {
+            fprintf(stderr, "Error: %s takes yes or no, not '%s'\n", key, value);
+            return -1;
+        }
+        if (key[0] == 't') cfg->top = on;
+        else if (key[0] == 'h') cfg->help = on;
+        else if (key[0] == 'i') cfg->housekeeping.idle = on;
+        else cfg->housekeeping.lock_memory = on;
+        return 0;
+    }
+    if (strcmp(key, "record") == 0) {
+        return copy_value(cfg->record_dir, sizeof(cfg->record_dir), key, value);
+    }
+    if (strcmp(key, "statsd") == 0) {
+        return copy_value(cfg->statsd_target, sizeof(cfg->statsd_target), key, value);
+    }
+    if (strcmp(key, "ship") == 0) {
+        return copy_value(cfg->ship_target, sizeof(cfg->ship_target), key, value);
+    }
+    if (strcmp(key, "export") == 0) {
+        return copy_value(cfg->export_dir, sizeof(cfg->export_dir), key, value);
+    }
+    if (strcmp(key, "warmup") == 0) {
+        int ms = parse_duration_ms(value, 1);
+        if (ms < WARMUP_MIN_MS || ms > WARMUP_MAX_MS) {
+            fprintf(stderr, "Error: warmup must be between %d ms and %d s.\n",
+                    WARMUP_MIN_MS, WARMUP_MAX_MS / 1000);
+            return -1;
+        }
+        cfg->warmup_ms = ms;
+        return 0;
+    }
+    if (strcmp(key, "config") == 0) {
+        return copy_value(cfg->config_path, sizeof(cfg->config_path), key, value);
+    }
+    if (strcmp(key, "pin") == 0 || strcmp(key, "pin-sampler") == 0 || strcmp(key, "pin-render") == 0) {
+        return set_pin(cfg, key, value);
+    }
+    if (strcmp(key, "nice") == 0) {
+        char *end;
+        long n = strtol(value, &end, 10);
+        if (*end != '\0' || end == value || n < -20 || n > 19) {
+            fprintf(stderr, "Error: nice must be between -20 and 19\n");
+            return -1;
+        }
+        cfg->housekeeping.nice = (int)n;
+        cfg->housekeeping.set_nice = 1;
+        return 0;
+    }
+
+    if (strcmp(key, "alert") == 0) {
+        return rule_add(&cfg->rules, value);
+    }
+
+    fprintf(stderr, "Error: Unknown option '%s'\n", key);
+    return -1;
+}
+
+static char *trim(char *s) {
+    while (isspace((unsigned char)*s)) {
+        s++;
+    }
+    char *end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1])) {
+        *--end = '\0';
+    }
+    return s;
+}
+
+int runconfig_load_file(RunConfig *cfg, const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "Error: Cannot read config file %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    char line[1024];
+    int lineno = 0;
+    int errors = 0;
+    while (fgets(line, sizeof(line), f)) {
+        lineno++;
+        char *hash = strchr(line, '#');
+        if (hash) {
+            *hash = '\0';
+        }
+        char *key = trim(line);
+        if (*key == '\0') {
+            continue;
+        }
+
+        char *eq = strchr(key, '=');
+        char *value = "";
+        if (eq) {
+            *eq = '\0';
+            value = trim(eq + 1);
+            key = trim(key);
+        }
+        // A config file cannot name another one
+        if (strcmp(key, "config") == 0) {
+            fprintf(stderr, "Error: config files cannot include others\n");
+            fprintf(stderr, "  at %s line %d\n", path, lineno);
+            errors++;
+        } else if (runconfig_set(cfg, key, value) != 0) {
+            fprintf(stderr, "  at %s line %d\n", path, lineno);
+            errors++;
+        }
+    }
+
+    fclose(f);
+    return errors ? -1 : 0;
+}
+
+/*
+ * Arguments left over after the options are the old positional forms:
+ * "-R dir 100", "-S host:port 1000", "-F json 500", "-t 3",
+ * "-E dir file 1h" and "-m cpu json".
+ */
+static int apply_positional(RunConfig *cfg, int count, char **args) {
+    int used = 0;
+
+    // A format name anywhere, as in "-m cpu json"
+    for (int i = 0; i < count; i++) {
+        int format = format_parse(args[i]);
+        if (format >= 0) {
+            cfg->format = format;
+            memmove(&args[i], &args[i + 1], (size_t)(count - i - 1) * sizeof(char *));
+            count--;
+            i--;
+        }
+    }
+
+    if (cfg->export_dir[0]) {
+        if (count >= 1 && copy_value(cfg->export_file, sizeof(cfg->export_file), "export", args[0]) != 0) {
+            return -1;
+        }
+        if (count >= 2 && copy_value(cfg->export_tier, sizeof(cfg->export_tier), "tier", args[1]) != 0) {
+            return -1;
+        }
+        used = count < 2 ? count : 2;
+    } else if (count >= 1 && !cfg->interval_set) {
+        // Seconds for -t, milliseconds for the headless modes and -F
+        int bare = (cfg->top && !cfg->record_dir[0] && !cfg->statsd_target[0]) ? 1000 : 1;
+        if (cfg->top || cfg->record_dir[0] || cfg->statsd_target[0] || cfg->once) {
+            cfg->interval_ms = parse_duration_ms(args[0], bare);
+            if (cfg->interval_ms < 0) {
+                fprintf(stderr, "Error: interval must be a positive number.\n");
+                return -1;
+            }
+            cfg->interval_set = 1;
+            used = 1;
+        }
+    }
+
+    if (used < count) {
+        fprintf(stderr, "Error: Unexpected argument '%s'. Use -h for help.\n", args[used]);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Pick the mode from what was set, fill in the mode's defaults and
+ * reject combinations that cannot run together
+ */
+static int resolve(RunConfig *cfg) {
+    int modes = !!cfg->export_dir[0] + !!(cfg->record_dir[0] || cfg->statsd_target[0]) +
+                !!cfg->top + !!cfg->once;
+    if (modes > 1) {
+        fprintf(stderr, "Error: Choose one of -R/-S, -t, -F and -E.\n");
+        return -1;
+    }
+    if (cfg->count && !cfg->interval_set && !cfg->once) {
+        fprintf(stderr, "Error: -n needs -c <interval>.\n");
+        return -1;
+    }
+    if (cfg->ship_target[0] && !cfg->record_dir[0]) {
+        fprintf(stderr, "Error: --ship needs -R <dir>.\n");
+        return -1;
+    }
+    if (cfg->housekeeping.idle && !cfg->housekeeping.set_nice) {
+        cfg->housekeeping.nice = 19;
+        cfg->housekeeping.set_nice = 1;
+    }
+
+    if (cfg->help) {
+        cfg->mode = RUN_HELP;
+    } else if (cfg->export_dir[0]) {
+        if (!cfg->export_file[0]) {
+            fprintf(stderr, "Error: missing parameter. Use -E <dir> <file> [raw/10s/1m/1h].\n");
+            return -1;
+        }
+        cfg->mode = RUN_EXPORT;
+    } else if (cfg->record_dir[0] || cfg->statsd_target[0]) {
+        cfg->mode = RUN_RECORD;
+        if (!cfg->interval_set) {
+            cfg->interval_ms = cfg->record_dir[0] ? 100 : 1000;
+        }
+        cfg->first_ms = cfg->interval_ms;
+    } else if (cfg->top) {
+        cfg->mode = RUN_TOP;
+        if (!cfg->interval_set) {
+            cfg->interval_ms = 2000;
+        }
+    } else if (cfg->once) {
+        // One sample of everything measured over the window
+        cfg->mode = RUN_SAMPLE;
+        if (!cfg->interval_set) {
+            cfg->interval_ms = 1000;
+        }
+        cfg->first_ms = cfg->interval_ms;
+        cfg->count = 1;
+    } else if (cfg->interval_set) {
+        cfg->mode = RUN_SAMPLE;
+        cfg->first_ms = cfg->warmup_ms;
+    } else if (strcmp(cfg->metrics, "cpu") == 0 || strcmp(cfg->metrics, "mem") == 0 ||
+               strcmp(cfg->metrics, "proc") == 0) {
+        cfg->mode = RUN_REPORT;
+    } else if (cfg->metrics[0] || cfg->format != RUN_FORMAT_TEXT) {
+        cfg->mode = RUN_SAMPLE;
+        cfg->first_ms = cfg->interval_ms = cfg->warmup_ms;
+        cfg->count = 1;
+    } else {
+        cfg->mode = RUN_INTERACTIVE;
+    }
+    return 0;
+}
+
+int runconfig_parse(RunConfig *cfg, int argc, char *argv[]) {
+    // The config file comes first so the command line can override it
+    const char *config = getenv("SYSMON_CONFIG");
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--config") == 0 && i + 1 < argc) {
+            config = argv[i + 1];
+        } else if (strncmp(argv[i], "--config=", 9) == 0) {
+            config = argv[i] + 9;
+        }
+    }
+    if (config && *config) {
+        if (runconfig_load_file(cfg, config) != 0) {
+            return -1;
+        }
+        if (copy_value(cfg->config_path, sizeof(cfg->config_path), "config", config) != 0) {
+            return -1;
+        }
+    }
+
+    opterr = 0;
+    optind = 0;                         // 0 makes glibc start over, as on a reload
+    int opt, index;
+    while ((opt = getopt_long(argc, argv, short_options, long_options, &index)) != -1) {
+        if (opt == '?' || opt == ':') {
+            fprintf(stderr, "Invalid option. Use -h for help.\n");
+            return -1;
+        }
+        const char *name = NULL;
+        for (const struct option *o = long_options; o->name; o++) {
+            if (o->val == opt) {
+                name = o->name;
+                break;
+            }
+        }
+        if (runconfig_set(cfg, name, optarg ? optarg : "") != 0) {
+            return -1;
+        }
+    }
+
+    if (apply_positional(cfg, argc - optind, argv + optind) != 0) {
+        return -1;
+    }
+    return resolve(cfg);
+}
@@ -0,0 +1,101 @@
+/*
+ * Run configuration
+ *
+ * Everything one run of sysmonitor needs, gathered in one struct before
+ * anything starts. Command-line options are parsed with getopt_long, so
+ * short and long forms combine in any order ("-m proc -c 2 --format json");
+ * a config file may set the same options with their long names as keys,
+ * and the command line overrides it. The mode is resolved from what was
+ * set, and sysmonitor.c only dispatches on the result.
+ *
+ * Durations take a unit: "250ms", "2s", "1.5m", "1h". A bare number keeps
+ * the unit the option always had (seconds for -c and -t, milliseconds for
+ * the -R, -S and -F arguments).
+ *
+ * Config file: one "key = value" per line, '#' starts a comment, flags
+ * (idle, mlock) take yes/no. Example:
+ *
+ *     metrics  = cpu,mem,disk
+ *     interval = 500ms
+ *     statsd   = metrics.internal:8125
+ *     pin      = 0
+ *     idle     = yes
+ *     alert    = cpu.active > 90 for 3
+ *
+ * "alert" may be given any number of times (see rules.h). A running
+ * monitor re-reads the file on SIGHUP or when it changes (confwatch.h);
+ * collectors, interval, alerts and the StatsD target take effect between
+ * two ticks, everything else only on the next start.
+ */
+
+#ifndef RUNCONFIG_H
+#define RUNCONFIG_H
+
+#include "housekeeping.h"
+#include "rules.h"
+
+typedef enum {
+    RUN_INTERACTIVE,                    // the menu
+    RUN_HELP,
+    RUN_REPORT,                         // one cpu, mem or proc report, no sampler
+    RUN_SAMPLE,                         // collectors on the sampler, printed count times
+    RUN_TOP,                            // live process view
+    RUN_RECORD,                         // recording and/or StatsD until stopped
+    RUN_EXPORT                          // columnar export of a recording
+} RunMode;
+
+// format value for the human-readable panels and reports
+#define RUN_FORMAT_TEXT -1
+
+typedef struct {
+    RunMode mode;
+    char metrics[256];                  // collectors to run, "" = the default set
+    int interval_ms;                    // between samples or frames
+    int first_ms;                       // until the first sample
+    int warmup_ms;                      // first CPU reading window
+    int count;                          // samples to print, 0 = until stopped
+    int format;                         // OutputFormat or RUN_FORMAT_TEXT
+
+    char record_dir[512];
+    char ship_target[256];
+    char statsd_target[256];
+    char export_dir[512];
+    char export_file[512];
+    char export_tier[8];
+    char config_path[512];
+
+    HousekeepingOptions housekeeping;
+    RuleSet rules;
+
+    // What was asked for, before the mode is resolved
+    int interval_set;                   // -c / interval
+    int once;                           // -F
+    int top;                            // -t
+    int help;
+} RunConfig;
+
+/*
+ * "250ms", "2s", "1.5m", "1h", or a bare number in units of bare_unit_ms.
+ * Returns milliseconds, or -1 if the text is not a positive duration.
+ */
+int parse_duration_ms(const char *text, int bare_unit_ms);
+
+// Defaults: nothing selected, warmup from SYSMON_WARMUP_MS or 100 ms
+void runconfig_init(RunConfig *cfg);
+
+/*
+ * Set one option by its long name, as the command line and the config
+ * file both do. Returns 0, or -1 with a message on stderr.
+ */
+int runconfig_set(RunConfig *cfg, const char *key, const char *value);
+
+// Apply every line of a config file; -1 if it cannot be read or has errors
+int runconfig_load_file(RunConfig *cfg, const char *path);
+
+/*
+ * Parse argv (after an optional config file) and resolve the mode.
+ * Returns 0, or -1 with a message on stderr.
+ */
+int runconfig_parse(RunConfig *cfg, int argc, char *argv[]);
+
+#endif
@@ -0,0 +1,438 @@
+/*
+ * Sampler thread and lock-free triple-buffer snapshot handoff
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+
+#include "sampler.h"
+
+#define MAX_READERS 4
+
+// `middle` holds the index of the slot in the middle of the handoff plus a
+// flag telling the reader whether it is newer than what it already has.
+#define SLOT_INDEX_MASK 3u
+#define SLOT_FRESH      4u
+
+struct SnapshotReader {
+    Snapshot slots[3];
+    unsigned char *data;            // backing store for the result blocks of all 3 slots
+    _Atomic unsigned int middle;
+    unsigned int back;              // owned by the sampler thread
+    unsigned int front;             // owned by the reader
+    int event_fd;                   // counts publishes so readers can sleep in poll()
+};
+
+static SnapshotReader readers[MAX_READERS];
+static int reader_count = 0;
+
+static pthread_t sampler_thread;
+static int sampler_running = 0;
+static int stop_fd = -1;
+static unsigned int first_delay_ms;
+static unsigned int tick_ms;
+static int pinned = 0;
+static cpu_set_t pin_cpus;
+static SamplerTiming timing;        // written and read on the sampler thread
+
+// Shared by the collectors, updated on the first request of each tick;
+// kept for the life of the process like the collectors' own state
+static CPUTable cpu_table;
+static int cpu_table_ready = 0;
+static int cpu_table_ok = 0;
+static unsigned long cpu_table_tick = 0;
+static unsigned long current_tick = 0;
+static int want_cpu_counters = 0;
+
+// A new collector list and interval, handed over by sampler_reconfigure()
+typedef struct {
+    int keep_collectors;
+    char names[256];
+    unsigned int interval_ms;
+} SamplerPlan;
+
+static _Atomic(SamplerPlan *) pending_plan;
+
+// Offset of each collector's result block inside one slot; recomputed
+// when the collector list changes, the slot size covers any list
+static size_t result_offsets[MAX_COLLECTORS];
+static size_t slot_size;
+
+SnapshotReader *sampler_subscribe(void) {
+    if (sampler_running || reader_count >= MAX_READERS) {
+        return NULL;
+    }
+
+    SnapshotReader *r = &readers[reader_count];
+    memset(r, 0, sizeof(*r));
+    r->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (r->event_fd < 0) {
+        return NULL;
+    }
+    r->front = 0;
+    atomic_init(&r->middle, 1u);
+    r->back = 2;
+
+    reader_count++;
+    return r;
+}
+
+/*
+ * Hand the back slot to the reader and take the old middle slot in exchange
+ */
+static void publish(SnapshotReader *r) {
+    unsigned int old = atomic_exchange_explicit(&r->middle, r->back | SLOT_FRESH,
+                                                memory_order_acq_rel);
+    r->back = old & SLOT_INDEX_MASK;
+
+    // Non-blocking: if the counter is somehow saturated the reader is
+    // already guaranteed to wake up, so a failed write is harmless.
+    uint64_t one = 1;
+    ssize_t ignored = write(r->event_fd, &one, sizeof(one));
+    (void)ignored;
+}
+
+static void fill_slot(Snapshot *snap, unsigned long seq, const CPUTable *table) {
+    snap->seq = seq;
+    clock_gettime(CLOCK_REALTIME, &snap->taken);
+    snap->count = collector_count();
+    snap->have_cpu_counters = table != NULL;
+    if (table) {
+        snap->cpu_counters = table->all;
+    }
+
+    for (int i = 0; i < snap->count; i++) {
+        snap->collectors[i] = collector_at(i);
+        snap->ok[i] = collector_result_ok(i);
+        if (snap->ok[i]) {
+            memcpy((void *)snap->results[i], collector_result(i),
+                   collector_at(i)->result_size);
+        }
+    }
+}
+
+/*
+ * Sleep until the absolute deadline or until sampler_stop() is called.
+ * Returns 0 when the deadline was reached, -1 when asked to stop.
+ */
+static int wait_until(const struct timespec *deadline) {
+    while (1) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        long long remaining_ns = (deadline->tv_sec - now.tv_sec) * 1000000000LL +
+                                 (deadline->tv_nsec - now.tv_nsec);
+        if (remaining_ns <= 0) {
+            return 0;
+        }
+        // Round up: waking before the deadline would only poll again
+        long long remaining_ms = (remaining_ns + 999999) / 1000000;
+
+        struct pollfd pfd = { .fd = stop_fd, .events = POLLIN };
+        int rc = poll(&pfd, 1, (int)remaining_ms);
+        if (rc > 0) {
+            return -1;
+        }
+        if (rc < 0 && errno != EINTR) {
+            return -1;
+        }
+    }
+}
+
+static size_t aligned_size(const Collector *c) {
+    return (c->result_size + 15) & ~(size_t)15;
+}
+
+static void layout_results(void) {
+    size_t offset = 0;
+    for (int i = 0; i < collector_count(); i++) {
+        result_offsets[i] = offset;
+        offset += aligned_size(collector_at(i));
+    }
+}
+
+/*
+ * Point each slot's result blocks at the current layout. Only slots the
+ * sampler owns are touched: a reader's front slot keeps the layout it was
+ * filled with, and the middle slot is rewritten before it is published.
+ */
+static void point_slot(SnapshotReader *r, unsigned int slot) {
+    for (int c = 0; c < collector_count(); c++) {
+        r->slots[slot].results[c] = r->data + slot * slot_size + result_offsets[c];
+    }
+}
+
+/*
+ * Take over a plan from sampler_reconfigure(), between two ticks
+ */
+static void apply_plan(void) {
+    SamplerPlan *plan = atomic_exchange_explicit(&pending_plan, NULL, memory_order_acquire);
+    if (!plan) {
+        return;
+    }
+    if (!plan->keep_collectors && collector_select(plan->names) == 0) {
+        collectors_init_all();
+        layout_results();
+    }
+    if (plan->interval_ms > 0) {
+        tick_ms = plan->interval_ms;
+    }
+    free(plan);
+}
+
+static void advance(struct timespec *ts, unsigned int ms) {
+    ts->tv_sec += ms / 1000;
+    ts->tv_nsec += (long)(ms % 1000) * 1000000L;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+static double elapsed_us(const struct timespec *from, const struct timespec *to) {
+    return (to->tv_sec - from->tv_sec) * 1e6 + (to->tv_nsec - from->tv_nsec) / 1e3;
+}
+
+static void *sampler_main(void *arg) {
+    (void)arg;
+    struct timespec deadline, woke, done;
+    unsigned long seq = 0;
+
+    // Deadlines are absolute so time spent sampling does not cause drift
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    advance(&deadline, first_delay_ms);
+
+    while (wait_until(&deadline) == 0) {
+        // A late wakeup means the sampler itself is being crowded out
+        clock_gettime(CLOCK_MONOTONIC, &woke);
+        timing.ticks++;
+        timing.late_us = elapsed_us(&deadline, &woke);
+        if (timing.late_us > timing.late_max_us) {
+            timing.late_max_us = timing.late_us;
+        }
+
+        seq++;
+        current_tick++;                 // never reset, unlike seq
+        collectors_sample_all();
+
+        // Free when a CPU collector already read the table this tick
+        const CPUTable *table = NULL;
+        if (want_cpu_counters || (cpu_table_ready && cpu_table_tick == current_tick)) {
+            table = sampler_cpu_table();
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &done);
+        timing.busy_us = elapsed_us(&woke, &done);
+
+        for (int i = 0; i < reader_count; i++) {
+            SnapshotReader *r = &readers[i];
+            point_slot(r, r->back);
+            fill_slot(&r->slots[r->back], seq, table);
+            publish(r);
+        }
+
+        apply_plan();
+        advance(&deadline, tick_ms);
+    }
+
+    return NULL;
+}
+
+void sampler_want_cpu_counters(int want) {
+    want_cpu_counters = want;
+}
+
+void sampler_set_affinity(const cpu_set_t *cpus) {
+    pinned = cpus != NULL;
+    if (cpus) {
+        pin_cpus = *cpus;
+    }
+}
+
+void sampler_timing(SamplerTiming *out) {
+    *out = timing;
+}
+
+const CPUTable *sampler_cpu_table(void) {
+    if (!cpu_table_ready) {
+        // Baseline for the first delta
+        if (cputable_init(&cpu_table) != 0) {
+            return NULL;
+        }
+        cpu_table_ready = 1;
+        cpu_table_ok = 1;
+        cpu_table_tick = current_tick;
+    } else if (cpu_table_tick != current_tick) {
+        // A failed read is not retried by the next collector of the same tick
+        cpu_table_ok = cputable_update(&cpu_table) >= 0;
+        cpu_table_tick = current_tick;
+    }
+    return cpu_table_ok ? &cpu_table : NULL;
+}
+
+int sampler_start(unsigned int first_ms, unsigned int interval_ms) {
+    if (sampler_running) {
+        return -1;
+    }
+
+    // Collectors that fail to initialize are reported as failed in every
+    // snapshot, the remaining ones still run.
+    collectors_init_all();
+
+    // One slot holds every known collector's result block, each aligned
+    // for any type, so any later collector list fits as well
+    slot_size = 0;
+    for (int i = 0; i < collector_catalog_count(); i++) {
+        slot_size += aligned_size(collector_catalog_at(i));
+    }
+    layout_results();
+
+    for (int i = 0; i < reader_count; i++) {
+        SnapshotReader *r = &readers[i];
+        r->data = calloc(3, slot_size ? slot_size : 1);
+        if (!r->data) {
+            return -1;
+        }
+    }
+
+    stop_fd = eventfd(0, EFD_CLOEXEC);
+    if (stop_fd < 0) {
+        return -1;
+    }
+
+    first_delay_ms = first_ms;
+    tick_ms = interval_ms;
+    memset(&timing, 0, sizeof(timing));
+
+    // The thread starts on its CPUs, never briefly on the caller's
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    if (pinned) {
+        pthread_attr_setaffinity_np(&attr, sizeof(pin_cpus), &pin_cpus);
+    }
+
+    // Signals such as SIGINT are left to the main thread
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+    int rc = pthread_create(&sampler_thread, &attr, sampler_main, NULL);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    pthread_attr_destroy(&attr);
+
+    if (rc != 0) {
+        close(stop_fd);
+        stop_fd = -1;
+        return -1;
+    }
+
+    sampler_running = 1;
+    return 0;
+}
+
+void sampler_stop(void) {
+    if (!sampler_running) {
+        return;
+    }
+
+    uint64_t one = 1;
+    ssize_t ignored = write(stop_fd, &one, sizeof(one));
+    (void)ignored;
+    pthread_join(sampler_thread, NULL);
+
+    close(stop_fd);
+    stop_fd = -1;
+    sampler_running = 0;
+    free(atomic_exchange(&pending_plan, NULL));
+}
+
+int sampler_reconfigure(const char *names, unsigned int interval_ms) {
+    if (!sampler_running) {
+        return -1;
+    }
+
+    SamplerPlan *plan = calloc(1, sizeof(*plan));
+    if (!plan) {
+        return -1;
+    }
+    plan->keep_collectors = names == NULL;
+    if (names) {
+        snprintf(plan->names, sizeof(plan->names), "%s", names);
+    }
+    plan->interval_ms = interval_ms;
+
+    // A plan the sampler has not taken yet comes back here and is dropped
+    free(atomic_exchange_explicit(&pending_plan, plan, memory_order_acq_rel));
+    return 0;
+}
+
+const Snapshot *snapshot_latest(SnapshotReader *reader) {
+    if (atomic_load_explicit(&reader->middle, memory_order_relaxed) & SLOT_FRESH) {
+        unsigned int old = atomic_exchange_explicit(&reader->middle, reader->front,
+                                                    memory_order_acq_rel);
+        reader->front = old & SLOT_INDEX_MASK;
+    }
+    return &reader->slots[reader->front];
+}
+
+const Snapshot *snapshot_wait(SnapshotReader *reader, int timeout_ms) {
+    while (!(atomic_load_explicit(&reader->middle, memory_order_acquire) & SLOT_FRESH)) {
+        struct pollfd pfd = { .fd = reader->event_fd, .events = POLLIN };
+        if (poll(&pfd, 1, timeout_ms) <= 0) {
+            return NULL;
+        }
+
+        // Drain the publish counter; the triple buffer itself says what is new.
+        // A wakeup for a snapshot already taken by snapshot_latest() is spurious.
+        uint64_t count;
+        ssize_t ignored = read(reader->event_fd, &count, sizeof(count));
+        (void)ignored;
+
+        if (timeout_ms >= 0 &&
+            !(atomic_load_explicit(&reader->middle, memory_order_acquire) & SLOT_FRESH)) {
+            return NULL;
+        }
+    }
+
+    return snapshot_latest(reader);
+}
+
+/*
+ * Draw every collector panel from a snapshot
+ */
+void snapshot_render(const Snapshot *snap, FILE *out) {
+    for (int i = 0; i < snap->count; i++) {
+        const Collector *c = snap->collectors[i];
+        if (!c->render) {
+            continue;
+        }
+
+        if (snap->ok[i]) {
+            c->render(snap->results[i], out);
+        } else {
+            render_box_top(out, c->title ? c->title : c->name);
+            fprintf(out, "│ Error reading %s statistics\n", c->name);
+            render_box_bottom(out);
+        }
+        fprintf(out, "\n");
+    }
+}
+
+void snapshot_export(const Snapshot *snap, sysmon_emit_fn emit, void *ctx) {
+    for (int i = 0; i < snap->count; i++) {
+        const Collector *c = snap->collectors[i];
+        if (snap->ok[i] && c->export) {
+            c->export(snap->results[i], emit, ctx);
+        }
+    }
+}
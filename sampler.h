@@ -0,0 +1,100 @@
+/*
+ * Sampler thread and snapshot handoff
+ *
+ * The sampler runs every registered collector on its own thread and
+ * publishes the results as immutable snapshots. Each consumer (renderer,
+ * exporter, ...) subscribes once and gets its own triple buffer, so a slow
+ * consumer only ever skips snapshots: the sampler never waits on it and
+ * never takes a lock.
+ *
+ * Result blocks are copied into the snapshot with memcpy, so collectors used
+ * with the sampler must produce flat results (no pointers). Each snapshot
+ * names its own collectors, and slots have room for every known collector,
+ * so the set can change while consumers still hold older snapshots.
+ */
+
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <stdio.h>
+#include <time.h>
+#include <sched.h>
+
+#include "collector.h"
+#include "cputable.h"
+
+typedef struct {
+    unsigned long seq;                  // sample number, 0 = nothing sampled yet
+    struct timespec taken;              // wall-clock time of the sample
+    int count;                          // collectors in this snapshot
+    const Collector *collectors[MAX_COLLECTORS];
+    int ok[MAX_COLLECTORS];             // collector_result_ok() at sample time
+    const void *results[MAX_COLLECTORS];
+    int have_cpu_counters;              // cpu_counters were read this tick
+    CPUStats cpu_counters;              // aggregate /proc/stat counters
+} Snapshot;
+
+// How the sampler thread itself is doing, for the self-overhead panel
+typedef struct {
+    unsigned long ticks;
+    double late_us;                     // wakeup after the deadline, last tick
+    double late_max_us;                 // worst wakeup since start
+    double busy_us;                     // collectors' run time, last tick
+} SamplerTiming;
+
+typedef struct SnapshotReader SnapshotReader;
+
+/*
+ * Setup: subscribe every consumer first, then start the sampler.
+ * The first sample is taken first_ms after start, then every interval_ms.
+ */
+SnapshotReader *sampler_subscribe(void);
+int sampler_start(unsigned int first_ms, unsigned int interval_ms);
+void sampler_stop(void);
+
+/*
+ * Switch to another collector list (see collector_select(), NULL keeps the
+ * current one) and interval while running. The sampler thread applies it
+ * after the tick in progress, so no sample mixes old and new settings; a
+ * newer call before then replaces the older one. Returns -1 if not running
+ * or out of memory; validate names with collector_check() first.
+ */
+int sampler_reconfigure(const char *names, unsigned int interval_ms);
+
+/*
+ * Put the aggregate CPU counters into every snapshot, reading the per-CPU
+ * table on ticks where no collector did; call before sampler_start().
+ * Without it, snapshots carry them only on ticks a CPU collector ran.
+ */
+void sampler_want_cpu_counters(int want);
+
+// Restrict the sampler thread to these CPUs; call before sampler_start()
+void sampler_set_affinity(const cpu_set_t *cpus);
+
+// Only meaningful on the sampler thread, i.e. from a collector callback
+void sampler_timing(SamplerTiming *out);
+
+/*
+ * The per-CPU table of the current tick, for collector callbacks. The
+ * first call in a tick reads the online mask and /proc/stat, later calls
+ * in the same tick return the same table, so every CPU collector sees one
+ * reading. The first call ever takes the baseline; a collector calls it
+ * from init so its first delta has one. NULL if /proc/stat is unreadable.
+ */
+const CPUTable *sampler_cpu_table(void);
+
+/*
+ * Consumers. The returned snapshot belongs to the caller until its next
+ * call on the same reader.
+ *
+ * snapshot_wait() blocks up to timeout_ms (-1 = forever) for a snapshot newer
+ * than the last one returned, and returns NULL if none arrived.
+ * snapshot_latest() never blocks and may return the same snapshot again.
+ */
+const Snapshot *snapshot_wait(SnapshotReader *reader, int timeout_ms);
+const Snapshot *snapshot_latest(SnapshotReader *reader);
+
+void snapshot_render(const Snapshot *snap, FILE *out);
+void snapshot_export(const Snapshot *snap, sysmon_emit_fn emit, void *ctx);
+
+#endif
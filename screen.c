@@ -0,0 +1,283 @@
+/*
+ * Full-screen terminal output with a diff renderer
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+
+#include "screen.h"
+
+static struct termios saved_termios;
+static int terminal_raw = 0;
+
+/*
+ * Put the terminal back the way we found it; also runs from exit() so a
+ * Ctrl+C in the live view does not leave the shell in raw mode
+ */
+static void restore_terminal(void) {
+    if (!terminal_raw) {
+        return;
+    }
+    const char *leave = "\033[0m\033[?25h\033[?1049l";
+    ssize_t ignored = write(STDOUT_FILENO, leave, strlen(leave));
+    (void)ignored;
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &saved_termios);
+    terminal_raw = 0;
+}
+
+static void free_rows(Screen *scr) {
+    for (int i = 0; i < scr->rows; i++) {
+        if (scr->prev) free(scr->prev[i]);
+        if (scr->next) free(scr->next[i]);
+    }
+    free(scr->prev);
+    free(scr->next);
+    free(scr->prev_attr);
+    free(scr->next_attr);
+    scr->prev = scr->next = NULL;
+    scr->prev_attr = scr->next_attr = NULL;
+}
+
+/*
+ * Re-read the terminal size and reallocate the frame buffers
+ */
+int screen_resize(Screen *scr) {
+    struct winsize ws;
+
+    free_rows(scr);
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 0 && ws.ws_col > 0) {
+        scr->rows = ws.ws_row;
+        scr->cols = ws.ws_col;
+    } else {
+        scr->rows = 24;
+        scr->cols = 80;
+    }
+
+    scr->prev = calloc((size_t)scr->rows, sizeof(char *));
+    scr->next = calloc((size_t)scr->rows, sizeof(char *));
+    scr->prev_attr = calloc((size_t)scr->rows, 1);
+    scr->next_attr = calloc((size_t)scr->rows, 1);
+    if (!scr->prev || !scr->next || !scr->prev_attr || !scr->next_attr) {
+        return -1;
+    }
+    for (int i = 0; i < scr->rows; i++) {
+        scr->prev[i] = calloc((size_t)scr->cols + 1, 1);
+        scr->next[i] = calloc((size_t)scr->cols + 1, 1);
+        if (!scr->prev[i] || !scr->next[i]) {
+            return -1;
+        }
+    }
+
+    scr->full_redraw = 1;
+    return 0;
+}
+
+/*
+ * Switch to the alternate screen in raw, no-echo mode
+ */
+int screen_open(Screen *scr) {
+    memset(scr, 0, sizeof(*scr));
+
+    if (!isatty(STDIN_FILENO) || !isatty(STDOUT_FILENO)) {
+        return -1;
+    }
+    if (tcgetattr(STDIN_FILENO, &saved_termios) != 0) {
+        return -1;
+    }
+
+    struct termios raw = saved_termios;
+    // Keep ISIG so Ctrl+C still reaches the SIGINT handler
+    raw.c_lflag &= ~(ICANON | ECHO);
+    raw.c_iflag &= ~(IXON | ICRNL);
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+    if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw) != 0) {
+        return -1;
+    }
+
+    static int registered = 0;
+    if (!registered) {
+        atexit(restore_terminal);
+        registered = 1;
+    }
+    terminal_raw = 1;
+
+    const char *enter = "\033[?1049h\033[?25l\033[2J";
+    ssize_t ignored = write(STDOUT_FILENO, enter, strlen(enter));
+    (void)ignored;
+
+    if (screen_resize(scr) != 0) {
+        screen_close(scr);
+        return -1;
+    }
+    return 0;
+}
+
+void screen_close(Screen *scr) {
+    free_rows(scr);
+    restore_terminal();
+}
+
+/*
+ * Set the contents of one row of the frame being built, cut to the width
+ */
+void screen_line(Screen *scr, int row, int attr, const char *fmt, ...) {
+    if (row < 0 || row >= scr->rows) {
+        return;
+    }
+
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(scr->next[row], (size_t)scr->cols + 1, fmt, ap);
+    va_end(ap);
+    scr->next_attr[row] = (unsigned char)attr;
+}
+
+/*
+ * Write the rows that differ from what is on the terminal, then make the
+ * new frame the current one. Rows not set since the last flush are blank.
+ */
+void screen_flush(Screen *scr) {
+    size_t cap = (size_t)scr->rows * ((size_t)scr->cols + 32) + 64;
+    char *out = malloc(cap);
+    if (!out) {
+        return;
+    }
+    size_t len = 0;
+
+    for (int i = 0; i < scr->rows; i++) {
+        if (!scr->full_redraw &&
+            scr->prev_attr[i] == scr->next_attr[i] &&
+            strcmp(scr->prev[i], scr->next[i]) == 0) {
+            scr->next[i][0] = '\0';
+            continue;
+        }
+
+        // Move to the row, draw it, clear whatever the old row left behind
+        len += (size_t)snprintf(out + len, cap - len, "\033[%d;1H%s%s\033[K%s",
+                                i + 1,
+                                scr->next_attr[i] == SCREEN_REVERSE ? "\033[7m" : "",
+                                scr->next[i],
+                                scr->next_attr[i] == SCREEN_REVERSE ? "\033[0m" : "");
+
+        char *tmp = scr->prev[i];
+        scr->prev[i] = scr->next[i];
+        scr->next[i] = tmp;
+        scr->prev_attr[i] = scr->next_attr[i];
+        scr->next[i][0] = '\0';
+    }
+    scr->full_redraw = 0;
+
+    size_t off = 0;
+    while (off < len) {
+        ssize_t n = write(STDOUT_FILENO, out + off, len - off);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        off += (size_t)n;
+    }
+    free(out);
+
+    // Untouched rows in the next frame start out blank
+    memset(scr->next_attr, 0, (size_t)scr->rows);
+}
+
+/*
+ * Wait up to timeout_ms for a key press. Returns KEY_NONE on timeout or
+ * when interrupted by a signal (e.g. SIGWINCH).
+ */
+int screen_read_key(int timeout_ms) {
+    struct pollfd pfd = { .fd = STDIN_FILENO, .events = POLLIN };
+    if (poll(&pfd, 1, timeout_ms) <= 0) {
+        return KEY_NONE;
+    }
+
+    unsigned char c;
+    if (read(STDIN_FILENO, &c, 1) != 1) {
+        return KEY_NONE;
+    }
+    if (c != KEY_ESCAPE) {
+        return (c == '\n') ? KEY_ENTER : (c == 0x08 ? KEY_BACKSPACE : c);
+    }
+
+    // Escape sequences arrive in one burst; a lone ESC times out quickly
+    unsigned char seq[3];
+    if (poll(&pfd, 1, 30) <= 0 || read(STDIN_FILENO, &seq[0], 1) != 1) {
+        return KEY_ESCAPE;
+    }
+    if (seq[0] != '[' && seq[0] != 'O') {
+        return KEY_ESCAPE;
+    }
+    if (poll(&pfd, 1, 30) <= 0 || read(STDIN_FILENO, &seq[1], 1) != 1) {
+        return KEY_ESCAPE;
+    }
+
+    switch (seq[1]) {
+        case 'A': return KEY_UP;
+        case 'B': return KEY_DOWN;
+        case 'H': return KEY_HOME;
+        case 'F': return KEY_END;
+    }
+    if (seq[1] >= '0' && seq[1] <= '9') {
+        if (poll(&pfd, 1, 30) <= 0 || read(STDIN_FILENO, &seq[2], 1) != 1 || seq[2] != '~') {
+            return KEY_ESCAPE;
+        }
+        switch (seq[1]) {
+            case '1': case '7': return KEY_HOME;
+            case '4': case '8': return KEY_END;
+            case '5': return KEY_PAGE_UP;
+            case '6': return KEY_PAGE_DOWN;
+        }
+    }
+    return KEY_ESCAPE;
+}
+
+/*
+ * Read a line of text on the bottom row. Returns 0 on Enter, -1 on Escape
+ * (buf is left unchanged then).
+ */
+int screen_prompt(Screen *scr, const char *label, char *buf, int size) {
+    char edit[256];
+    int len = 0;
+
+    snprintf(edit, sizeof(edit), "%s", buf);
+    len = (int)strlen(edit);
+    if (size > (int)sizeof(edit)) {
+        size = (int)sizeof(edit);
+    }
+
+    printf("\033[?25h");
+    while (1) {
+        printf("\033[%d;1H\033[K%s%s", scr->rows, label, edit);
+        fflush(stdout);
+
+        int key = screen_read_key(-1);
+        if (key == KEY_ENTER) {
+            snprintf(buf, (size_t)size, "%s", edit);
+            break;
+        }
+        if (key == KEY_ESCAPE) {
+            printf("\033[?25l");
+            scr->full_redraw = 1;
+            return -1;
+        }
+        if (key == KEY_BACKSPACE) {
+            if (len > 0) edit[--len] = '\0';
+        } else if (key >= 0x20 && key < 0x7f && len < size - 1) {
+            edit[len++] = (char)key;
+            edit[len] = '\0';
+        }
+    }
+    printf("\033[?25l");
+    fflush(stdout);
+    scr->full_redraw = 1;
+    return 0;
+}
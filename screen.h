@@ -0,0 +1,47 @@
+/*
+ * Full-screen terminal output with a diff renderer
+ *
+ * Callers describe the whole frame row by row; screen_flush() compares it
+ * with the frame already on the terminal and rewrites only the rows that
+ * changed, in a single write(2). An unchanged table costs no output at all.
+ */
+
+#ifndef SCREEN_H
+#define SCREEN_H
+
+#define SCREEN_NORMAL  0
+#define SCREEN_REVERSE 1
+
+// Key codes returned by screen_read_key() besides plain characters
+#define KEY_NONE      -1
+#define KEY_UP        0x101
+#define KEY_DOWN      0x102
+#define KEY_PAGE_UP   0x103
+#define KEY_PAGE_DOWN 0x104
+#define KEY_HOME      0x105
+#define KEY_END       0x106
+#define KEY_ESCAPE    0x1b
+#define KEY_ENTER     '\r'
+#define KEY_BACKSPACE 0x7f
+
+typedef struct {
+    int rows;
+    int cols;
+    char **prev;            // rows currently on the terminal
+    char **next;            // rows of the frame being built
+    unsigned char *prev_attr;
+    unsigned char *next_attr;
+    int full_redraw;
+} Screen;
+
+int screen_open(Screen *scr);
+void screen_close(Screen *scr);
+int screen_resize(Screen *scr);
+void screen_line(Screen *scr, int row, int attr, const char *fmt, ...)
+    __attribute__((format(printf, 4, 5)));
+void screen_flush(Screen *scr);
+
+int screen_read_key(int timeout_ms);
+int screen_prompt(Screen *scr, const char *label, char *buf, int size);
+
+#endif
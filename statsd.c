@@ -0,0 +1,268 @@
+/*
+ * StatsD exporter
+ */
+
+// sendmmsg()
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <math.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "statsd.h"
+
+static unsigned int hash_name(const char *s) {
+    unsigned int h = 2166136261u;
+    while (*s) {
+        h ^= (unsigned char)*s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// StatsD reserves ':', '|', '@' and newlines; anything odd becomes '_'
+static void sanitize(char *s) {
+    for (; *s; s++) {
+        if (*s == ':' || *s == '|' || *s == '@' || *s == ' ' || (unsigned char)*s < 0x20) {
+            *s = '_';
+        }
+    }
+}
+
+static int rehash(StatsdExporter *e, int size) {
+    int *index = malloc((size_t)size * sizeof(int));
+    if (!index) {
+        return -1;
+    }
+    memset(index, 0xff, (size_t)size * sizeof(int));
+    for (int i = 0; i < e->nnames; i++) {
+        unsigned int slot = hash_name(e->names[i].name) & (unsigned int)(size - 1);
+        while (index[slot] >= 0) {
+            slot = (slot + 1) & (unsigned int)(size - 1);
+        }
+        index[slot] = i;
+    }
+    free(e->index);
+    e->index = index;
+    e->index_size = size;
+    return 0;
+}
+
+/*
+ * Preformatted line head for a metric, built on first sight
+ */
+static const StatsdName *lookup(StatsdExporter *e, const char *name) {
+    unsigned int mask = (unsigned int)(e->index_size - 1);
+    unsigned int slot = hash_name(name) & mask;
+
+    while (e->index[slot] >= 0) {
+        if (strcmp(e->names[e->index[slot]].name, name) == 0) {
+            return &e->names[e->index[slot]];
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    if (strlen(name) >= sizeof(e->names[0].name)) {
+        return NULL;
+    }
+    if (e->nnames == e->capacity) {
+        int cap = e->capacity ? e->capacity * 2 : 128;
+        StatsdName *grown = realloc(e->names, (size_t)cap * sizeof(StatsdName));
+        if (!grown) {
+            return NULL;
+        }
+        e->names = grown;
+        e->capacity = cap;
+    }
+
+    StatsdName *n = &e->names[e->nnames];
+    snprintf(n->name, sizeof(n->name), "%s", name);
+    n->head_len = snprintf(n->head, sizeof(n->head), "%s%s", e->prefix, name);
+    sanitize(n->head);
+    n->head[n->head_len++] = ':';
+    n->head[n->head_len] = '\0';
+
+    int id = e->nnames++;
+    if (e->nnames * 2 > e->index_size) {
+        if (rehash(e, e->index_size * 2) != 0) {
+            e->nnames--;
+            return NULL;
+        }
+    } else {
+        e->index[slot] = id;
+    }
+    return n;
+}
+
+int statsd_open(StatsdExporter *e, const char *target, const char *prefix) {
+    char host[256] = "127.0.0.1";
+    const char *port = target;
+
+    memset(e, 0, sizeof(*e));
+    e->fd = -1;
+
+    // Split "host:port" on the last colon; "[v6]:port" keeps its colons
+    const char *colon = strrchr(target, ':');
+    if (colon) {
+        const char *h = target;
+        size_t len = (size_t)(colon - target);
+        if (len >= 2 && h[0] == '[' && h[len - 1] == ']') {
+            h++;
+            len -= 2;
+        }
+        if (len == 0 || len >= sizeof(host)) {
+            return -1;
+        }
+        memcpy(host, h, len);
+        host[len] = '\0';
+        port = colon + 1;
+    }
+
+    struct addrinfo hints, *res;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    if (getaddrinfo(host, port, &hints, &res) != 0) {
+        return -1;
+    }
+
+    for (struct addrinfo *ai = res; ai; ai = ai->ai_next) {
+        e->fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (e->fd < 0) {
+            continue;
+        }
+        // Connected, so datagrams need no address and errors come back
+        if (connect(e->fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+            break;
+        }
+        close(e->fd);
+        e->fd = -1;
+    }
+    freeaddrinfo(res);
+    if (e->fd < 0) {
+        return -1;
+    }
+
+    if (prefix) {
+        snprintf(e->prefix, sizeof(e->prefix), "%s", prefix);
+    } else {
+        char hostname[64];
+        if (gethostname(hostname, sizeof(hostname)) != 0) {
+            snprintf(hostname, sizeof(hostname), "localhost");
+        }
+        hostname[sizeof(hostname) - 1] = '\0';
+        // Dots would split the host into several StatsD path levels
+        for (char *p = hostname; *p; p++) {
+            if (*p == '.') *p = '_';
+        }
+        snprintf(e->prefix, sizeof(e->prefix), "sysmon.%s.", hostname);
+    }
+
+    e->datagrams = malloc((size_t)STATSD_MAX_DATAGRAMS * STATSD_MTU);
+    if (!e->datagrams || rehash(e, 256) != 0) {
+        statsd_close(e);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Send every datagram packed so far in one sendmmsg() call
+ */
+int statsd_flush(StatsdExporter *e) {
+    struct mmsghdr msgs[STATSD_MAX_DATAGRAMS];
+    struct iovec iov[STATSD_MAX_DATAGRAMS];
+    int n = e->ndatagrams;
+
+    // The datagram being filled counts once it holds a line
+    if (n < STATSD_MAX_DATAGRAMS && e->lengths[n] > 0) {
+        n++;
+    }
+    if (n == 0) {
+        return 0;
+    }
+
+    memset(msgs, 0, sizeof(msgs[0]) * (size_t)n);
+    for (int i = 0; i < n; i++) {
+        iov[i].iov_base = e->datagrams + (size_t)i * STATSD_MTU;
+        iov[i].iov_len = (size_t)e->lengths[i];
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    int sent = 0, retried = 0, rc = 0;
+    while (sent < n) {
+        int r = sendmmsg(e->fd, msgs + sent, (unsigned int)(n - sent), 0);
+        e->send_calls++;
+        if (r < 0) {
+            // A refusal can be left over from an earlier send; retry once
+            if ((errno == EINTR || errno == ECONNREFUSED) && !retried) {
+                retried = 1;
+                continue;
+            }
+            e->dropped += (unsigned long long)(n - sent);
+            rc = -1;
+            break;
+        }
+        sent += r;
+    }
+    e->datagrams_sent += (unsigned long long)sent;
+
+    e->ndatagrams = 0;
+    memset(e->lengths, 0, sizeof(e->lengths));
+    return rc;
+}
+
+void statsd_emit(void *ctx, const char *name, double value, const char *unit) {
+    StatsdExporter *e = ctx;
+    char tail[40];
+    (void)unit;
+
+    if (!isfinite(value)) {
+        return;
+    }
+    const StatsdName *n = lookup(e, name);
+    if (!n) {
+        return;
+    }
+
+    int tail_len = snprintf(tail, sizeof(tail), "%.10g|g\n", value);
+    int len = n->head_len + tail_len;
+
+    if (e->lengths[e->ndatagrams] + len > STATSD_MTU) {
+        if (++e->ndatagrams == STATSD_MAX_DATAGRAMS) {
+            statsd_flush(e);
+        }
+    }
+
+    char *d = e->datagrams + (size_t)e->ndatagrams * STATSD_MTU + e->lengths[e->ndatagrams];
+    memcpy(d, n->head, (size_t)n->head_len);
+    memcpy(d + n->head_len, tail, (size_t)tail_len);
+    e->lengths[e->ndatagrams] += len;
+    e->lines++;
+}
+
+int statsd_send_snapshot(StatsdExporter *e, const Snapshot *snap) {
+    if (snap->seq == 0) {
+        return 0;
+    }
+    snapshot_export(snap, statsd_emit, e);
+    return statsd_flush(e);
+}
+
+void statsd_close(StatsdExporter *e) {
+    if (e->fd >= 0) {
+        close(e->fd);
+    }
+    free(e->names);
+    free(e->index);
+    free(e->datagrams);
+    memset(e, 0, sizeof(*e));
+    e->fd = -1;
+}
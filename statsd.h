@@ -0,0 +1,57 @@
+/*
+ * StatsD exporter
+ *
+ * Sends every metric a snapshot exports as a StatsD gauge over UDP. Lines
+ * are packed into datagrams of at most STATSD_MTU bytes and a whole tick
+ * leaves in one sendmmsg() call. The "<prefix><name>:" head of each line
+ * is formatted once per metric name and kept in a table, so a tick only
+ * formats values.
+ */
+
+#ifndef STATSD_H
+#define STATSD_H
+
+#include "sampler.h"
+
+// Fits a 1500-byte Ethernet frame after IP and UDP headers, with room to spare
+#define STATSD_MTU 1432
+#define STATSD_MAX_DATAGRAMS 64
+#define STATSD_LINE_MAX 192
+
+typedef struct {
+    char name[64];                      // metric name as exported
+    char head[STATSD_LINE_MAX];         // "<prefix><sanitized name>:"
+    int head_len;
+} StatsdName;
+
+typedef struct {
+    int fd;                             // connected UDP socket
+    char prefix[96];
+
+    StatsdName *names;
+    int nnames;
+    int capacity;
+    int *index;
+    int index_size;
+
+    char *datagrams;                    // STATSD_MAX_DATAGRAMS x STATSD_MTU
+    int lengths[STATSD_MAX_DATAGRAMS];
+    int ndatagrams;
+
+    unsigned long long lines;
+    unsigned long long datagrams_sent;
+    unsigned long long send_calls;
+    unsigned long long dropped;         // datagrams the kernel refused
+} StatsdExporter;
+
+/*
+ * target is "host:port", "[v6addr]:port" or just a port on localhost.
+ * prefix NULL means "sysmon.<hostname>.".
+ */
+int statsd_open(StatsdExporter *e, const char *target, const char *prefix);
+void statsd_emit(void *ctx, const char *name, double value, const char *unit);
+int statsd_flush(StatsdExporter *e);
+int statsd_send_snapshot(StatsdExporter *e, const Snapshot *snap);
+void statsd_close(StatsdExporter *e);
+
+#endif
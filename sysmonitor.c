@@ -7,52 +7,60 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
-#include <dirent.h>
-#include <ctype.h>
 #include <sys/types.h>
 #include <signal.h>
 #include <time.h>
 #include <errno.h>
 
-// Structure to hold process information
-typedef struct {
-    int pid;
-    char name[256];
-    unsigned long long utime;
-    unsigned long long stime;
-    unsigned long long total_time;
-} ProcessInfo;
-
-typedef struct {
-    unsigned long long total_kb;
-    unsigned long long free_kb;
-    unsigned long long available_kb;
-    unsigned long long buffers_kb;
-    unsigned long long cached_kb;
-} MemInfo;
+#include "libsysmon.h"
+#include "collector.h"
+#include "sampler.h"
+#include "topview.h"
+#include "recorder.h"
+#include "colfile.h"
+#include "merge.h"
+#include "statsd.h"
+#include "format.h"
+#include "housekeeping.h"
+#include "runconfig.h"
+#include "rules.h"
+#include "confwatch.h"
+#include "cpucache.h"
 
 // Global log file pointer
 FILE *log_file = NULL;
 
+// Options and config file of this run, see runconfig.h
+static RunConfig run;
+
+// The original arguments, parsed again with the config file on reload
+static int run_argc;
+static char **run_argv;
+
+// How often the sampling loops look for a config reload between snapshots
+#define RELOAD_POLL_MS 500
+
+#define CACHED_MIN_MS 50                // shorter windows are mostly tick rounding
+
 // Function prototypes
 void display_menu();
 void cpu_usage();
 void memory_usage();
 void top_processes();
 void continuous_monitoring();
-void continuous_monitoring_with_interval(int interval);
+void continuous_monitoring_with_interval(int interval_ms, int count);
+int record_metrics(const char *dir, int interval_ms, const char *ship_target, const char *statsd_target);
+int merge_command(int argc, char *argv[]);
+int print_metrics(int format, int first_ms, int interval_ms, int count);
 void clear_screen();
-int is_numeric(const char *str);
-int read_process_info(int pid, ProcessInfo *proc);
-int read_meminfo(MemInfo *info);
-int compare_processes(const void *a, const void *b);
 void init_log();
 void write_log(const char *mode, const char *details);
 void close_log();
 void signal_handler(int signum);
 char* get_timestamp();
 void display_help();
-int parse_arguments(int argc, char *argv[]);
+int run_configured(const RunConfig *cfg);
+static int start_sampler(unsigned int first_ms, unsigned int interval_ms);
 
 int main(int argc, char *argv[]) {
     int choice;
@@ -63,13 +71,47 @@ int main(int argc, char *argv[]) {
     
     // Register signal handler for SIGINT (Ctrl+C)
     signal(SIGINT, signal_handler);
+
+    // Register built-in collectors, then any plugins from SYSMON_PLUGINS
+    collector_register_builtins();
+    if (collector_load_plugins_from_env() != 0) {
+        write_log("ERROR", "Failed to load one or more collector plugins");
+    }
     
     // Log program start
     write_log("SYSTEM", "System Monitor started");
 
-    // Check for command-line arguments (non-interactive mode)
-    if (argc > 1) {
-        int result = parse_arguments(argc, argv);
+    // The merge subcommand has its own argument list
+    if (argc > 1 && strcmp(argv[1], "merge") == 0) {
+        int result = merge_command(argc, argv);
+        close_log();
+        return result;
+    }
+
+    // Config file and options, in any order; getopt reorders argv, so keep
+    // the original order for parsing again on reload
+    run_argc = argc;
+    run_argv = malloc((size_t)(argc + 1) * sizeof(char *));
+    if (run_argv) {
+        memcpy(run_argv, argv, (size_t)(argc + 1) * sizeof(char *));
+    }
+    runconfig_init(&run);
+    if (runconfig_parse(&run, argc, argv) != 0) {
+        write_log("ERROR", "Invalid command-line option or config file");
+        close_log();
+        return 1;
+    }
+    housekeeping_apply(&run.housekeeping);
+
+    // Long-running modes pick up config file edits without a restart
+    if (run.config_path[0] && (run.mode == RUN_SAMPLE || run.mode == RUN_RECORD) &&
+        confwatch_start(run.config_path) != 0) {
+        write_log("ERROR", "Cannot watch the config file, reloading on SIGHUP only");
+    }
+
+    // Anything but the menu runs non-interactively
+    if (run.mode != RUN_INTERACTIVE) {
+        int result = run_configured(&run);
         close_log();
         return result;
     }
@@ -98,7 +140,12 @@ int main(int argc, char *argv[]) {
                 memory_usage();
                 break;
             case 3:
-                top_processes();
+                // Live view on a terminal, the static top 5 otherwise
+                if (top_view(2, &run.housekeeping) != 0) {
+                    top_processes();
+                } else {
+                    write_log("MENU", "Live process view closed");
+                }
                 break;
             case 4:
                 continuous_monitoring();
@@ -128,79 +175,95 @@ void display_menu() {
     printf("=====================================\n");
     printf("1. CPU Usage\n");
     printf("2. Memory Usage\n");
-    printf("3. Top 5 Processes\n");
+    printf("3. Top Processes (live view)\n");
     printf("4. Continuous Monitoring\n");
     printf("5. Exit\n");
     printf("=====================================\n");
 }
 
 /*
- * Display CPU usage statistics
+ * One "Label: value" line of the menu screens, driven by metric_schema.h
  */
-typedef struct {
-    unsigned long long user, nice, system, idle, iowait, irq, softirq, steal;
-    unsigned long long total, active; 
-} CPUStats;
+static void print_metric(const char *label, double value, const char *unit, int show) {
+    char formatted[32];
 
-int get_cpu_stats(CPUStats *stats) {
-    FILE *fp = fopen("/proc/stat", "r");
-    if (!fp) return -1;
+    if (show == METRIC_IF_NONZERO && value <= 0.1) {
+        return;
+    }
+    metric_format_value(formatted, sizeof(formatted), value, unit);
+    printf("%-20s: %s\n", label, formatted);
+}
 
-    // Read all fields including steal
-    int fields = fscanf(fp, "%*s %llu %llu %llu %llu %llu %llu %llu %llu",
-                        &stats->user, &stats->nice, &stats->system, &stats->idle,
-                        &stats->iowait, &stats->irq, &stats->softirq, &stats->steal);
-    fclose(fp);
+#define PRINT_METRIC(type, field, name, unit, label, show) \
+    print_metric(label, (double)r->field, unit, show);
 
-    if (fields < 8) return -1;
+/*
+ * Window for the first CPU reading (--warmup or SYSMON_WARMUP_MS). Short
+ * windows answer fast but are coarse: /proc/stat only moves in clock ticks.
+ */
+static int warmup_ms(void) {
+    return run.warmup_ms;
+}
 
+static void sleep_ms(int ms) {
+    struct timespec ts = { ms / 1000, (long)(ms % 1000) * 1000000L };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR);
+}
 
-    stats->active = stats->user + stats->nice + stats->system + 
-                    stats->irq + stats->softirq;
-    
-    // Total includes everything.
-    stats->total = stats->active + stats->idle + stats->iowait + stats->steal;
+/*
+ * Measure CPU usage. With a recorder running, its cached counters are the
+ * first reading and the answer is immediate; otherwise two readings a
+ * short window apart. Returns 0, or -1 if /proc/stat cannot be read.
+ */
+static int measure_cpu(CPUUsage *usage, int *window_ms, int *cached) {
+    CPUStats prev, curr;
+
+    *cached = cpucache_load(&prev, CPUCACHE_MAX_AGE_MS, window_ms) == 0;
+    if (*cached) {
+        // A cache that fresh has hardly seen a tick; let it age a little
+        if (*window_ms < CACHED_MIN_MS) {
+            sleep_ms(CACHED_MIN_MS - *window_ms);
+            *window_ms = CACHED_MIN_MS;
+        }
+        if (sysmon_cpu_sample(&curr) != 0) return -1;
+        // Counters from a previous boot run ahead of this one's
+        *cached = sysmon_cpu_usage(&prev, &curr, usage) == 0;
+    }
+    if (!*cached) {
+        *window_ms = warmup_ms();
+        if (sysmon_cpu_sample(&prev) != 0) return -1;
+        sleep_ms(*window_ms);
+        if (sysmon_cpu_sample(&curr) != 0) return -1;
 
+        sysmon_cpu_usage(&prev, &curr, usage);
+    }
     return 0;
 }
 
+/*
+ * Display CPU usage statistics
+ */
 void cpu_usage() {
-    CPUStats prev, curr;
+    CPUUsage usage;
+    int window_ms, cached;
     
     clear_screen();
     printf("=== CPU Usage Monitor ===\n");
-    printf("Sampling CPU... (1 second)\n");
-
-    if (get_cpu_stats(&prev) != 0) return;
-    sleep(1);
-    if (get_cpu_stats(&curr) != 0) return;
-
-    unsigned long long total_delta = curr.total - prev.total;
-    unsigned long long active_delta = curr.active - prev.active;
-    unsigned long long idle_delta = curr.idle - prev.idle;
-    unsigned long long iowait_delta = curr.iowait - prev.iowait;
-    unsigned long long steal_delta = curr.steal - prev.steal; // Calculate steal separately
+    printf("Sampling CPU... (up to %d ms)\n", warmup_ms());
+    fflush(stdout);
 
-    if (total_delta == 0) total_delta = 1;
-
-    double usage_percent = (double)active_delta / total_delta * 100.0;
-    double idle_percent = (double)idle_delta / total_delta * 100.0;
-    double iowait_percent = (double)iowait_delta / total_delta * 100.0;
-    double steal_percent = (double)steal_delta / total_delta * 100.0;
+    if (measure_cpu(&usage, &window_ms, &cached) != 0) return;
 
     printf("\n--------------------------------\n");
-    printf("Real-time CPU Usage:\n");
-    printf("%-20s: %.2f%%\n", "Active Usage", usage_percent);
-    printf("%-20s: %.2f%%\n", "Idle", idle_percent);
-    printf("%-20s: %.2f%%\n", "I/O Wait", iowait_percent);
-    
-    //Only show steal if it's significant
-    if (steal_percent > 0.1) {
-        printf("%-20s: %.2f%% (Waiting for Host)\n", "Steal Time", steal_percent);
-    }
+    printf("Real-time CPU Usage (last %d ms%s):\n", window_ms, cached ? ", from the recorder" : "");
+    const CPUUsage *r = &usage;
+    SYSMON_CPU_METRICS(PRINT_METRIC)
     printf("--------------------------------\n");
 
-    write_log("MENU", "CPU Usage viewed");
+    char log_msg[128];
+    snprintf(log_msg, sizeof(log_msg), "CPU Usage viewed (%d ms window, %s)", window_ms,
+             cached ? "cached counters" : "measured");
+    write_log("MENU", log_msg);
     printf("\nPress Enter to return to menu...");
     getchar(); 
 }
@@ -210,12 +273,12 @@ void cpu_usage() {
  */
 void memory_usage() {
     MemInfo mem;
-    memset(&mem, 0, sizeof(MemInfo));
+    MemUsage usage;
 
     clear_screen();
     printf("=== Memory Usage ===\n\n");
 
-    if (read_meminfo(&mem) != 0) {
+    if (sysmon_mem_sample(&mem) != 0) {
         perror("Error reading /proc/meminfo");
         write_log("ERROR", "Failed to read /proc/meminfo");
         printf("\nPress Enter to return to menu...");
@@ -223,26 +286,10 @@ void memory_usage() {
         return;
     }
 
-    // Fallback if MemAvailable is missing on very old kernels
-    if (mem.available_kb == 0) {
-        mem.available_kb = mem.free_kb + mem.buffers_kb + mem.cached_kb;
-    }
-
-    unsigned long long used_kb = (mem.total_kb > mem.available_kb)
-                                 ? (mem.total_kb - mem.available_kb)
-                                 : 0;
-
-    double total_gb = mem.total_kb / 1048576.0;
-    double used_gb = used_kb / 1048576.0;
-    double free_gb = mem.available_kb / 1048576.0;
-    double used_pct = (mem.total_kb == 0) ? 0.0 : ((double)used_kb / mem.total_kb) * 100.0;
+    sysmon_mem_usage(&mem, &usage);
 
-    printf("%-12s: %.2f GB\n", "Total", total_gb);
-    printf("%-12s: %.2f GB (%.2f%%)\n", "Used", used_gb, used_pct);
-    printf("%-12s: %.2f GB\n", "Available", free_gb);
-    printf("%-12s: %.2f GB\n", "Free", mem.free_kb / 1048576.0);
-    printf("%-12s: %.2f GB\n", "Buffers", mem.buffers_kb / 1048576.0);
-    printf("%-12s: %.2f GB\n", "Cached", mem.cached_kb / 1048576.0);
+    const MemUsage *r = &usage;
+    SYSMON_MEM_METRICS(PRINT_METRIC)
 
     write_log("MENU", "Memory Usage viewed");
     printf("\nPress Enter to return to menu...");
@@ -250,85 +297,50 @@ void memory_usage() {
 }
 
 /*
- * Display top 5 processes by CPU/memory usage
+ * Every process, sorted by total CPU time. Returns a malloc'd array and
+ * its length in count, or NULL with count -1 (no /proc) or 0 (no memory).
  */
-void top_processes() {
-    clear_screen();
-    printf("=== Top 5 Processes ===\n\n");
-
-    DIR *proc_dir;
-    struct dirent *entry;
+static ProcessInfo *scan_processes(int *count) {
     ProcessInfo *processes = NULL;
-    int proc_count = 0;
-    int capacity = 100;
+    int capacity = 256;
 
-    // Allocate initial array for processes
-    processes = (ProcessInfo *)malloc(capacity * sizeof(ProcessInfo));
-    if (!processes) {
-        perror("Error: Memory allocation failed");
-        write_log("ERROR", "Memory allocation failed for process array");
-        printf("\nPress Enter to return to menu...");
-        getchar();
-        return;
-    }
-
-    // Open /proc directory
-    proc_dir = opendir("/proc");
-    if (!proc_dir) {
-        perror("Error: Cannot open /proc directory");
-        write_log("ERROR", "Failed to open /proc directory");
-        printf("\nPress Enter to return to menu...");
-        free(processes);
-        getchar();
-        return;
-    }
-
-    // Read all process directories
-    while ((entry = readdir(proc_dir)) != NULL) {
-        // Check if directory name is numeric (PID)
-        if (!is_numeric(entry->d_name)) {
-            continue;
-        }
-
-        int pid = atoi(entry->d_name);
-        
-        // Expand array if needed
-        if (proc_count >= capacity) {
-            capacity *= 2;
-            ProcessInfo *temp = (ProcessInfo *)realloc(processes, capacity * sizeof(ProcessInfo));
-            if (!temp) {
-                printf("Error: Memory reallocation failed\n");
-                break;
-            }
-            processes = temp;
+    // Sample into a buffer, growing it until every process fits
+    while (1) {
+        ProcessInfo *temp = (ProcessInfo *)realloc(processes, capacity * sizeof(ProcessInfo));
+        if (!temp) {
+            perror("Error: Memory allocation failed");
+            write_log("ERROR", "Memory allocation failed for process array");
+            free(processes);
+            *count = 0;
+            return NULL;
         }
+        processes = temp;
 
-        // Read process information
-        if (read_process_info(pid, &processes[proc_count])) {
-            proc_count++;
+        *count = sysmon_proc_scan(processes, capacity);
+        if (*count <= capacity) {
+            break;
         }
+        capacity = *count + *count / 4;
     }
 
-    closedir(proc_dir);
-
-    if (proc_count == 0) {
-        printf("No processes found\n");
+    if (*count < 0) {
+        perror("Error: Cannot open /proc directory");
+        write_log("ERROR", "Failed to open /proc directory");
         free(processes);
-        printf("\nPress Enter to return to menu...");
-        getchar();
-        return;
+        return NULL;
     }
 
     // Sort processes by total CPU time (descending)
-    qsort(processes, proc_count, sizeof(ProcessInfo), compare_processes);
+    sysmon_proc_sort_by_time(processes, *count);
+    return processes;
+}
 
-    // Display top 5 processes
+static void print_top_processes(const ProcessInfo *processes, int count) {
     printf("%-8s %-20s %-15s %-15s %-15s\n", 
            "PID", "Process Name", "User Time", "System Time", "Total Time");
     printf("--------------------------------------------------------------------------------\n");
 
-    int display_count = (proc_count < 5) ? proc_count : 5;
-    for (int i = 0; i < display_count; i++) {
+    for (int i = 0; i < count; i++) {
         printf("%-8d %-20s %-15llu %-15llu %-15llu\n",
                processes[i].pid,
                processes[i].name,
@@ -336,6 +348,33 @@ void top_processes() {
                processes[i].stime,
                processes[i].total_time);
     }
+}
+
+/*
+ * Display top 5 processes by CPU/memory usage
+ */
+void top_processes() {
+    clear_screen();
+    printf("=== Top 5 Processes ===\n\n");
+
+    int proc_count;
+    ProcessInfo *processes = scan_processes(&proc_count);
+    if (!processes) {
+        printf("\nPress Enter to return to menu...");
+        getchar();
+        return;
+    }
+
+    if (proc_count == 0) {
+        printf("No processes found\n");
+        free(processes);
+        printf("\nPress Enter to return to menu...");
+        getchar();
+        return;
+    }
+
+    // Display top 5 processes
+    print_top_processes(processes, (proc_count < 5) ? proc_count : 5);
 
     printf("\nNote: Times are in clock ticks (divide by sysconf(_SC_CLK_TCK) for seconds)\n");
     
@@ -349,6 +388,98 @@ void top_processes() {
     getchar();
 }
 
+/*
+ * Batch variant of -m: sample once, print once and exit, never waiting
+ * for input. format is an OutputFormat, or -1 for the "Label: value"
+ * text of the menu screens without the screen clearing.
+ */
+static int batch_report(const char *what, int format) {
+    Formatter f;
+    struct timespec now;
+    char name[64];
+
+    if (format >= 0) {
+        format_init(&f, stdout, (OutputFormat)format);
+    }
+
+    if (strcmp(what, "cpu") == 0) {
+        CPUUsage usage;
+        int window_ms, cached;
+        if (measure_cpu(&usage, &window_ms, &cached) != 0) {
+            fprintf(stderr, "Error: Cannot read /proc/stat\n");
+            write_log("ERROR", "Failed to read /proc/stat");
+            return 1;
+        }
+        const CPUUsage *r = &usage;
+        if (format < 0) {
+            printf("CPU Usage (last %d ms%s):\n", window_ms, cached ? ", from the recorder" : "");
+            SYSMON_CPU_METRICS(PRINT_METRIC)
+        } else {
+            sysmon_emit_fn emit = format_emit;
+            void *ctx = &f;
+            clock_gettime(CLOCK_REALTIME, &now);
+            format_begin(&f, &now);
+            SYSMON_CPU_METRICS(METRIC_EMIT)
+            format_end(&f);
+        }
+    } else if (strcmp(what, "mem") == 0) {
+        MemInfo mem;
+        MemUsage usage;
+        if (sysmon_mem_sample(&mem) != 0) {
+            fprintf(stderr, "Error: Cannot read /proc/meminfo\n");
+            write_log("ERROR", "Failed to read /proc/meminfo");
+            return 1;
+        }
+        sysmon_mem_usage(&mem, &usage);
+        const MemUsage *r = &usage;
+        if (format < 0) {
+            SYSMON_MEM_METRICS(PRINT_METRIC)
+        } else {
+            sysmon_emit_fn emit = format_emit;
+            void *ctx = &f;
+            clock_gettime(CLOCK_REALTIME, &now);
+            format_begin(&f, &now);
+            SYSMON_MEM_METRICS(METRIC_EMIT)
+            format_end(&f);
+        }
+    } else if (strcmp(what, "proc") == 0) {
+        int count;
+        ProcessInfo *processes = scan_processes(&count);
+        if (!processes) {
+            return 1;
+        }
+        int shown = (count < 5) ? count : 5;
+        if (format < 0) {
+            print_top_processes(processes, shown);
+        } else {
+            // CPU time since start in clock ticks, keyed by rank. The proc
+            // collector's proc.topN.* are rates over an interval, hence
+            // the separate proc.ticks prefix; names are in the text form
+            clock_gettime(CLOCK_REALTIME, &now);
+            format_begin(&f, &now);
+            for (int i = 0; i < shown; i++) {
+                snprintf(name, sizeof(name), "proc.ticks.top%d.pid", i + 1);
+                format_emit(&f, name, (double)processes[i].pid, "");
+                snprintf(name, sizeof(name), "proc.ticks.top%d.utime", i + 1);
+                format_emit(&f, name, (double)processes[i].utime, "ticks");
+                snprintf(name, sizeof(name), "proc.ticks.top%d.stime", i + 1);
+                format_emit(&f, name, (double)processes[i].stime, "ticks");
+                snprintf(name, sizeof(name), "proc.ticks.top%d.total", i + 1);
+                format_emit(&f, name, (double)processes[i].total_time, "ticks");
+            }
+            format_end(&f);
+        }
+        free(processes);
+    } else {
+        fprintf(stderr, "Invalid option. Use -h for help.\n");
+        write_log("ERROR", "Invalid mode parameter");
+        return 1;
+    }
+
+    fflush(stdout);
+    return 0;
+}
+
 /*
  * Continuously monitor system statistics (interactive mode)
  */
@@ -377,7 +508,7 @@ void continuous_monitoring() {
     }
     
     write_log("MENU", "Continuous monitoring started from interactive menu");
-    continuous_monitoring_with_interval(interval);
+    continuous_monitoring_with_interval(interval * 1000, 0);
 }
 
 /*
@@ -391,123 +522,6 @@ void clear_screen() {
     #endif
 }
 
-/*
- * Check if a string is numeric
- */
-int is_numeric(const char *str) {
-    if (*str == '\0') {
-        return 0;
-    }
-    while (*str) {
-        if (!isdigit(*str)) {
-            return 0;
-        }
-        str++;
-    }
-    return 1;
-}
-
-/*
- * Read process information from /proc/[PID]/stat and /proc/[PID]/comm
- */
-int read_process_info(int pid, ProcessInfo *proc) {
-    char stat_path[256];
-    char comm_path[256];
-    FILE *fp;
-
-    // Initialize process structure
-    proc->pid = pid;
-    proc->utime = 0;
-    proc->stime = 0;
-    proc->total_time = 0;
-    strcpy(proc->name, "unknown");
-
-    // Read process name from /proc/[PID]/comm
-    snprintf(comm_path, sizeof(comm_path), "/proc/%d/comm", pid);
-    fp = fopen(comm_path, "r");
-    if (fp) {
-        if (fgets(proc->name, sizeof(proc->name), fp)) {
-            // Remove trailing newline
-            size_t len = strlen(proc->name);
-            if (len > 0 && proc->name[len-1] == '\n') {
-                proc->name[len-1] = '\0';
-            }
-        }
-        fclose(fp);
-    }
-
-    // Read CPU time from /proc/[PID]/stat
-    snprintf(stat_path, sizeof(stat_path), "/proc/%d/stat", pid);
-    fp = fopen(stat_path, "r");
-    if (!fp) {
-        return 0;
-    }
-
-    // Parse /proc/[PID]/stat
-    // Fields: pid, comm, state, ppid, pgrp, session, tty_nr, tpgid, flags,
-    //         minflt, cminflt, majflt, cmajflt, utime(14), stime(15)...
-    int fields_read = fscanf(fp, "%*d %*s %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu",
-                             &proc->utime, &proc->stime);
-    
-    fclose(fp);
-
-    if (fields_read != 2) {
-        return 0;
-    }
-
-    proc->total_time = proc->utime + proc->stime;
-    return 1;
-}
-
-/*
- * Read memory statistics from /proc/meminfo
- */
-int read_meminfo(MemInfo *info) {
-    FILE *fp = fopen("/proc/meminfo", "r");
-    if (!fp) {
-        return -1;
-    }
-
-    char label[64];
-    unsigned long long value;
-    char unit[16];
-
-    while (fscanf(fp, "%63s %llu %15s", label, &value, unit) == 3) {
-        if (strcmp(label, "MemTotal:") == 0) {
-            info->total_kb = value;
-        } else if (strcmp(label, "MemFree:") == 0) {
-            info->free_kb = value;
-        } else if (strcmp(label, "MemAvailable:") == 0) {
-            info->available_kb = value;
-        } else if (strcmp(label, "Buffers:") == 0) {
-            info->buffers_kb = value;
-        } else if (strcmp(label, "Cached:") == 0) {
-            info->cached_kb = value;
-        }
-    }
-
-    fclose(fp);
-
-    if (info->total_kb == 0) {
-        return -1;
-    }
-
-    return 0;
-}
-
-/*
- * Comparison function for sorting processes by total CPU time
- */
-int compare_processes(const void *a, const void *b) {
-    ProcessInfo *proc_a = (ProcessInfo *)a;
-    ProcessInfo *proc_b = (ProcessInfo *)b;
-    
-    // Sort in descending order (highest CPU time first)
-    if (proc_b->total_time > proc_a->total_time) return 1;
-    if (proc_b->total_time < proc_a->total_time) return -1;
-    return 0;
-}
-
 /*
  * Get current timestamp as a formatted string
  */
@@ -572,196 +586,560 @@ void signal_handler(int signum) {
 void display_help() {
     printf("Usage: sysmonitor [OPTIONS]\n\n");
     printf("Options:\n");
-    printf("  -m cpu          Display CPU usage only\n");
-    printf("  -m mem          Display memory usage only\n");
-    printf("  -m proc         List top 5 active processes\n");
-    printf("  -c <interval>   Continuous monitoring every <interval> seconds\n");
+    printf("  -m cpu [format] Print CPU usage once and exit (format: json, csv or prom)\n");
+    printf("  -m mem [format] Print memory usage once and exit\n");
+    printf("  -m proc [format]  Print the top 5 active processes once and exit\n");
+    printf("  -m <a,b,...> [format] [-c <interval> [-n <count>]]  Sample several collectors\n");
+    printf("                  (cpu, mem, load, disk, proc, ...) together in one process\n");
+    printf("  -c <interval> [-n <count>]  Continuous monitoring every <interval> seconds,\n");
+    printf("                  stopping after <count> frames if given\n");
+    printf("  -t [interval]   Live process view (sort/filter/scroll), default every 2 seconds\n");
+    printf("  -R <dir> [ms]   Record all metrics to <dir> every [ms] milliseconds (default 100)\n");
+    printf("     [--ship <target>]        ...and forward finished blocks to a socket, FIFO or - (stdout)\n");
+    printf("     [--statsd <host:port>]   ...and send every sample to StatsD as gauges\n");
+    printf("  -S <host:port> [ms]  Send all metrics to StatsD every [ms] milliseconds (default 1000)\n");
+    printf("  -F <json|csv|prom> [ms]  Print every metric once, measured over [ms] (default 1000)\n");
+    printf("  -E <dir> <file> [tier]  Export a recording tier (raw/10s/1m/1h) to a columnar file\n");
+    printf("  merge -o <out> <files...>        Merge recording segments from many hosts by time\n");
+    printf("  merge -p <seconds> <files...>    Fleet-wide percentiles per time bucket as CSV\n");
     printf("  -h              Display this help message\n\n");
+    printf("Long forms (combine freely, e.g. -m proc -c 2 --format json):\n");
+    printf("  --metrics <a,b,...>   Collectors to run (-m)\n");
+    printf("  --interval <time>     Sample every <time> (-c): 250ms, 2s, 1.5m or 1h\n");
+    printf("  --count <n>           Stop after <n> samples (-n)\n");
+    printf("  --format <fmt>        json, csv, prom or text\n");
+    printf("  --once <fmt>          Print once, like -F\n");
+    printf("  --top, --record <dir>, --statsd <host:port>, --export <dir>  Same as -t, -R, -S, -E\n");
+    printf("  --warmup <time>       First CPU reading window (default 100ms, SYSMON_WARMUP_MS)\n");
+    printf("  --config <file>       Read \"key = value\" options from <file> (or SYSMON_CONFIG);\n");
+    printf("                        keys are the long option names, the command line wins;\n");
+    printf("                        -c, -m, -R and -S re-read it on SIGHUP or when it is saved\n");
+    printf("  --alert <rule>        Log when a metric crosses a threshold, e.g. \"cpu.active > 90 for 3\"\n");
+    printf("  A bare number keeps its old unit: seconds for -c and -t, ms for -R, -S and -F\n\n");
+    printf("Placement (with any option above):\n");
+    printf("  --pin <cpus>          Run the sampler and renderer on <cpus>, e.g. 0 or 0-1,6\n");
+    printf("  --pin-sampler <cpus>  Pin only the sampler thread\n");
+    printf("  --pin-render <cpus>   Pin only the renderer thread\n");
+    printf("  --idle                Lowest CPU and I/O priority (SCHED_IDLE, idle I/O class, nice 19)\n");
+    printf("  --nice <n>            Set the nice value\n");
+    printf("  --mlock               Lock the monitor's memory once sampling or -t has started\n\n");
     printf("Examples:\n");
     printf("  ./sysmonitor -m cpu     # Display CPU usage and save to log\n");
     printf("  ./sysmonitor -m mem     # Display memory info and save to log\n");
     printf("  ./sysmonitor -m proc    # List top 5 processes\n");
-    printf("  ./sysmonitor -c 2       # Monitor continuously every 2 seconds\n\n");
+    printf("  ./sysmonitor -c 2       # Monitor continuously every 2 seconds\n");
+    printf("  ./sysmonitor -m cpu json  # One JSON line for a health check\n");
+    printf("  ./sysmonitor -c 1 -n 5 > run.txt  # Five frames, then exit\n");
+    printf("  ./sysmonitor -m cpu,mem,proc,disk -c 1 -n 60 csv  # One minute of samples\n");
+    printf("  ./sysmonitor -m proc --interval 500ms --count 10 --format json\n");
+    printf("  ./sysmonitor --config /etc/sysmon.conf  # Options from a file\n");
+    printf("  ./sysmonitor -t         # Live process view, press q to quit\n");
+    printf("  ./sysmonitor -R rec     # Record to ./rec with 10s/1m/1h rollups\n");
+    printf("  ./sysmonitor -S 8125    # Gauges to the StatsD agent on localhost\n");
+    printf("  ./sysmonitor -c 1 --pin 0 --idle --mlock  # Stay on CPU 0, out of the workload's way\n");
+    printf("  ./sysmonitor -E rec week.col 1h  # Hourly rollups as a column file\n");
+    printf("  ./sysmonitor merge -p 60 fleet/*/1m-*.rec  # Per-minute p50/p90/p99 across hosts\n\n");
     printf("If no options are provided, the program runs in interactive menu mode.\n");
 }
 
 /*
- * Parse command-line arguments and execute appropriate function
+ * Run the mode a RunConfig resolved to
  */
-int parse_arguments(int argc, char *argv[]) {
-    if (argc < 2) {
-        return 1; // Will fall through to interactive mode
-    }
+int run_configured(const RunConfig *cfg) {
+    char log_msg[1024];
 
-    // Check for help flag
-    if (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0) {
-        display_help();
-        write_log("CLI", "Help displayed");
-        return 0;
+    // Collector list for every mode that runs the sampler
+    if ((cfg->mode == RUN_SAMPLE || cfg->mode == RUN_RECORD) && cfg->metrics[0] &&
+        collector_select(cfg->metrics) != 0) {
+        fprintf(stderr, "Invalid option. Use -h for help.\n");
+        write_log("ERROR", "Invalid mode parameter");
+        return 1;
     }
 
-    // Check for -m flag (mode)
-    if (strcmp(argv[1], "-m") == 0) {
-        if (argc < 3) {
-            fprintf(stderr, "Error: missing parameter. Use -m [cpu/mem/proc].\n");
-            write_log("ERROR", "Missing parameter for -m flag");
-            return 1;
-        }
-
-        if (strcmp(argv[2], "cpu") == 0) {
-            write_log("CLI", "CPU usage displayed via command-line");
-            cpu_usage();
+    switch (cfg->mode) {
+        case RUN_HELP:
+            display_help();
+            write_log("CLI", "Help information displayed");
             return 0;
-        } else if (strcmp(argv[2], "mem") == 0) {
-            write_log("CLI", "Memory usage displayed via command-line");
-            memory_usage();
+
+        case RUN_REPORT:
+            snprintf(log_msg, sizeof(log_msg), "Batch report of %s via command-line", cfg->metrics);
+            write_log("CLI", log_msg);
+            return batch_report(cfg->metrics, cfg->format);
+
+        case RUN_SAMPLE:
+            snprintf(log_msg, sizeof(log_msg), "Monitoring %s every %d ms (%d samples)",
+                     cfg->metrics[0] ? cfg->metrics : "all collectors", cfg->interval_ms, cfg->count);
+            write_log("CLI", log_msg);
+            // Repeated text output is the continuous monitor with its frame header
+            if (cfg->format == RUN_FORMAT_TEXT && cfg->count != 1) {
+                continuous_monitoring_with_interval(cfg->interval_ms, cfg->count);
+                return 0;
+            }
+            return print_metrics(cfg->format, cfg->first_ms, cfg->interval_ms, cfg->count) == 0 ? 0 : 1;
+
+        case RUN_TOP:
+            write_log("CLI", "Live process view started via command-line");
+            if (top_view((cfg->interval_ms + 999) / 1000, &cfg->housekeeping) != 0) {
+                fprintf(stderr, "Error: the live process view needs a terminal.\n");
+                write_log("ERROR", "Live process view needs a terminal");
+                return 1;
+            }
             return 0;
-        } else if (strcmp(argv[2], "proc") == 0) {
-            write_log("CLI", "Top processes displayed via command-line");
-            top_processes();
+
+        case RUN_RECORD:
+            return record_metrics(cfg->record_dir[0] ? cfg->record_dir : NULL, cfg->interval_ms,
+                                  cfg->ship_target[0] ? cfg->ship_target : NULL,
+                                  cfg->statsd_target[0] ? cfg->statsd_target : NULL) == 0 ? 0 : 1;
+
+        case RUN_EXPORT: {
+            int tier = recorder_tier_index(cfg->export_tier[0] ? cfg->export_tier : "raw");
+            if (tier < 0) {
+                fprintf(stderr, "Error: tier must be raw, 10s, 1m or 1h.\n");
+                write_log("ERROR", "Invalid tier for columnar export");
+                return 1;
+            }
+
+            long long points = colfile_export(cfg->export_dir, tier, cfg->export_file);
+            if (points < 0) {
+                fprintf(stderr, "Error: Could not export %s to %s\n", cfg->export_dir, cfg->export_file);
+                snprintf(log_msg, sizeof(log_msg), "Columnar export of %s failed", cfg->export_dir);
+                write_log("ERROR", log_msg);
+                return 1;
+            }
+            snprintf(log_msg, sizeof(log_msg), "Exported %lld %s points from %.480s to %.480s",
+                     points, recorder_tier_name(tier), cfg->export_dir, cfg->export_file);
+            write_log("CLI", log_msg);
+            printf("%s\n", log_msg);
             return 0;
-        } else {
-            fprintf(stderr, "Invalid option. Use -h for help.\n");
-            write_log("ERROR", "Invalid mode parameter");
-            return 1;
         }
+
+        case RUN_INTERACTIVE:
+            break;
     }
+    return 1;
+}
 
-    // Check for -c flag (continuous monitoring)
-    if (strcmp(argv[1], "-c") == 0) {
-        if (argc < 3) {
-            fprintf(stderr, "Error: missing parameter. Use -c <interval>.\n");
-            write_log("ERROR", "Missing interval for -c flag");
-            return 1;
-        }
+/*
+ * Log an alert rule starting or stopping to fire
+ */
+static void report_alert(const Rule *rule, int firing, void *ctx) {
+    char text[128], log_msg[256];
+    (void)ctx;
 
-        int interval = atoi(argv[2]);
-        if (interval <= 0) {
-            fprintf(stderr, "Error: interval must be a positive number.\n");
-            write_log("ERROR", "Invalid interval value for continuous monitoring");
-            return 1;
-        }
+    rule_describe(rule, text, sizeof(text));
+    if (firing) {
+        snprintf(log_msg, sizeof(log_msg), "%s (%s = %g)", text, rule->culprit, rule->value);
+    } else {
+        snprintf(log_msg, sizeof(log_msg), "cleared: %s", text);
+    }
+    write_log("ALERT", log_msg);
+    fprintf(stderr, "ALERT %s\n", log_msg);
+}
 
-        char log_msg[256];
-        snprintf(log_msg, sizeof(log_msg), "Continuous monitoring started with %d second interval", interval);
-        write_log("CLI", log_msg);
-        continuous_monitoring_with_interval(interval);
+/*
+ * After SIGHUP or a config file change, parse the options again and swap
+ * the result in. Collectors and interval go to the running sampler, which
+ * switches between two ticks; alerts keep their state; the caller compares
+ * run.statsd_target to swap its exporter. Anything else, or an invalid
+ * file, leaves the running configuration as it was. Returns 1 if the new
+ * configuration was taken.
+ */
+static int reload_run_config(void) {
+    RunConfig next;
+    char log_msg[640];
+
+    if (!confwatch_changed() || !run_argv) {
         return 0;
     }
 
-    // Check for -x flag (invalid option for testing)
-    if (strcmp(argv[1], "-x") == 0) {
-        fprintf(stderr, "Invalid option. Use -h for help.\n");
-        write_log("ERROR", "Invalid option -x provided");
-        return 1;
+    // runconfig_parse() reorders its argv, so give it a copy
+    char **args = malloc((size_t)(run_argc + 1) * sizeof(char *));
+    if (!args) {
+        return 0;
+    }
+    memcpy(args, run_argv, (size_t)(run_argc + 1) * sizeof(char *));
+    runconfig_init(&next);
+    int rc = runconfig_parse(&next, run_argc, args);
+    free(args);
+
+    if (rc != 0 || collector_check(next.metrics) != 0) {
+        snprintf(log_msg, sizeof(log_msg), "Config reload from %s failed, keeping the running configuration",
+                 run.config_path);
+        write_log("ERROR", log_msg);
+        fprintf(stderr, "%s\n", log_msg);
+        return 0;
+    }
+    if (next.mode != run.mode) {
+        snprintf(log_msg, sizeof(log_msg), "Config reload from %s changes the mode, restart to apply it",
+                 run.config_path);
+        write_log("ERROR", log_msg);
+        fprintf(stderr, "%s\n", log_msg);
+        return 0;
+    }
+    if (next.format != run.format || next.count != run.count || next.warmup_ms != run.warmup_ms ||
+        strcmp(next.record_dir, run.record_dir) != 0 || strcmp(next.ship_target, run.ship_target) != 0 ||
+        memcmp(&next.housekeeping, &run.housekeeping, sizeof(next.housekeeping)) != 0) {
+        write_log("CONFIG", "Output, recording and placement changes apply on the next start");
     }
 
-    // Unknown option
-    fprintf(stderr, "Invalid option. Use -h for help.\n");
-    write_log("ERROR", "Unknown command-line option");
+    if (strcmp(next.metrics, run.metrics) != 0 || next.interval_ms != run.interval_ms) {
+        sampler_reconfigure(strcmp(next.metrics, run.metrics) != 0 ? next.metrics : NULL,
+                            (unsigned int)next.interval_ms);
+        memcpy(run.metrics, next.metrics, sizeof(run.metrics));
+        run.interval_ms = next.interval_ms;
+    }
+    rules_carry_over(&next.rules, &run.rules);
+    run.rules = next.rules;
+    memcpy(run.statsd_target, next.statsd_target, sizeof(run.statsd_target));
+
+    snprintf(log_msg, sizeof(log_msg), "Reloaded %s: %s every %d ms, %d alert%s", run.config_path,
+             run.metrics[0] ? run.metrics : "all collectors", run.interval_ms,
+             run.rules.count, run.rules.count == 1 ? "" : "s");
+    write_log("CONFIG", log_msg);
     return 1;
 }
 
+/*
+ * Start the sampler, then lock memory if asked: by now the collectors'
+ * buffers and the sampler's stack exist and are what needs to stay put
+ */
+static int start_sampler(unsigned int first_ms, unsigned int interval_ms) {
+    if (sampler_start(first_ms, interval_ms) != 0) {
+        return -1;
+    }
+    housekeeping_lock_memory(&run.housekeeping);
+    return 0;
+}
+
+// "2 seconds" or "500 ms", for the status line
+static void format_every(char *buf, size_t size, int interval_ms) {
+    if (interval_ms % 1000 == 0) {
+        snprintf(buf, size, "%d seconds", interval_ms / 1000);
+    } else {
+        snprintf(buf, size, "%d ms", interval_ms);
+    }
+}
+
 /*
  * Continuous monitoring with specified interval
+ *
+ * Sampling runs on the sampler thread; this loop only renders the newest
+ * snapshot, so a slow terminal delays frames but never delays samples.
+ * A count above 0 stops after that many frames.
  */
-void continuous_monitoring_with_interval(int interval) {
-    CPUStats prev, curr;
-    MemInfo mem;
-    
-    printf("=== Continuous Monitoring (Every %d seconds) ===\n", interval);
+void continuous_monitoring_with_interval(int interval_ms, int count) {
+    char every[32];
+    format_every(every, sizeof(every), interval_ms);
+
+    printf("=== Continuous Monitoring (Every %s) ===\n", every);
     printf("Press Ctrl+C to stop...\n\n");
     
-    // Get initial CPU stats for delta calculation
-    if (get_cpu_stats(&prev) != 0) {
-        fprintf(stderr, "Error: Could not read CPU stats\n");
-        write_log("ERROR", "Failed to read initial CPU stats for continuous monitoring");
+    SnapshotReader *reader = sampler_subscribe();
+    
+    // Collectors take their baseline sample here; the first frame follows
+    // after a short warmup window instead of a full interval
+    if (!reader || start_sampler((unsigned int)warmup_ms(), (unsigned int)interval_ms) != 0) {
+        fprintf(stderr, "Error: Could not start the sampler\n");
+        write_log("ERROR", "Failed to start sampler thread for continuous monitoring");
         return;
     }
-    sleep(1); // Allow time for CPU stats to accumulate
     
+    // Piped output (scripts, -n) gets plain frames one after another
+    int tty = isatty(STDOUT_FILENO);
+
     int iteration = 0;
-    while (1) {
+    while (count == 0 || iteration < count) {
+        if (reload_run_config()) {
+            format_every(every, sizeof(every), run.interval_ms);
+        }
+        const Snapshot *snap = snapshot_wait(reader, run.config_path[0] ? RELOAD_POLL_MS : -1);
+        if (!snap) {
+            continue;
+        }
         iteration++;
+        rules_check(&run.rules, snap, report_alert, NULL);
+        
+        char taken[64];
+        time_t taken_sec = snap->taken.tv_sec;
+        strftime(taken, sizeof(taken), "%Y-%m-%d %H:%M:%S", localtime(&taken_sec));
         
         // Clear screen and display header
-        clear_screen();
+        if (tty) {
+            clear_screen();
+        }
         printf("═══════════════════════════════════════════════════════════════\n");
         printf("         CONTINUOUS SYSTEM MONITORING - Iteration %d\n", iteration);
         printf("═══════════════════════════════════════════════════════════════\n");
-        printf("Refresh Interval: %d seconds | Press Ctrl+C to stop\n", interval);
-        printf("Last Update: %s\n\n", get_timestamp());
+        printf("Refresh Interval: %s | Press Ctrl+C to stop\n", every);
+        printf("Last Update: %s\n\n", taken);
         
-        // Get current CPU stats
-        if (get_cpu_stats(&curr) == 0) {
-            unsigned long long total_delta = curr.total - prev.total;
-            unsigned long long active_delta = curr.active - prev.active;
-            unsigned long long idle_delta = curr.idle - prev.idle;
-            unsigned long long iowait_delta = curr.iowait - prev.iowait;
-            unsigned long long steal_delta = curr.steal - prev.steal;
-            
-            if (total_delta == 0) total_delta = 1;
-            
-            double usage_percent = (double)active_delta / total_delta * 100.0;
-            double idle_percent = (double)idle_delta / total_delta * 100.0;
-            double iowait_percent = (double)iowait_delta / total_delta * 100.0;
-            double steal_percent = (double)steal_delta / total_delta * 100.0;
-            
-            printf("┌─ CPU Usage ─────────────────────────────────────────────────┐\n");
-            printf("│ Active Usage:        %6.2f%%                              │\n", usage_percent);
-            printf("│ Idle:                %6.2f%%                              │\n", idle_percent);
-            printf("│ I/O Wait:            %6.2f%%                              │\n", iowait_percent);
-            if (steal_percent > 0.1) {
-                printf("│ Steal Time (Host):   %6.2f%% (VM waiting for host CPU)      │\n", steal_percent);
+        snapshot_render(snap, stdout);
+
+        // Alerts still firing stay on screen, not only in the log
+        for (int i = 0; i < run.rules.count; i++) {
+            if (run.rules.rules[i].firing) {
+                char text[128];
+                rule_describe(&run.rules.rules[i], text, sizeof(text));
+                printf("ALERT: %s (%s = %g)\n", text, run.rules.rules[i].culprit, run.rules.rules[i].value);
             }
-            printf("└─────────────────────────────────────────────────────────────┘\n\n");
-            
-            // Update prev stats for next iteration
-            prev = curr;
-        } else {
-            printf("┌─ CPU Usage ─────────────────────────────────────────────────┐\n");
-            printf("│ Error reading CPU statistics\n");
-            printf("└─────────────────────────────────────────────────────────────┘\n\n");
         }
         
-        // Display memory statistics
-        memset(&mem, 0, sizeof(MemInfo));
-        if (read_meminfo(&mem) == 0) {
-            if (mem.available_kb == 0) {
-                mem.available_kb = mem.free_kb + mem.buffers_kb + mem.cached_kb;
-            }
-            
-            unsigned long long used_kb = (mem.total_kb > mem.available_kb)
-                                         ? (mem.total_kb - mem.available_kb)
-                                         : 0;
-            
-            double total_gb = mem.total_kb / 1048576.0;
-            double used_gb = used_kb / 1048576.0;
-            double free_gb = mem.available_kb / 1048576.0;
-            double used_pct = (mem.total_kb == 0) ? 0.0 : ((double)used_kb / mem.total_kb) * 100.0;
-            
-            printf("┌─ Memory Usage ──────────────────────────────────────────────┐\n");
-            printf("│ Total:               %8.2f GB                           │\n", total_gb);
-            printf("│ Used:                %8.2f GB (%.2f%%)                   │\n", used_gb, used_pct);
-            printf("│ Available:           %8.2f GB                           │\n", free_gb);
-            printf("│ Buffers:             %8.2f GB                           │\n", mem.buffers_kb / 1048576.0);
-            printf("│ Cached:              %8.2f GB                           │\n", mem.cached_kb / 1048576.0);
-            printf("└─────────────────────────────────────────────────────────────┘\n");
-        } else {
-            printf("┌─ Memory Usage ──────────────────────────────────────────────┐\n");
-            printf("│ Error reading memory statistics\n");
-            printf("└─────────────────────────────────────────────────────────────┘\n");
+        if (count == 0 || iteration < count) {
+            printf("Next refresh in %s... (Press Ctrl+C to exit)\n", every);
         }
-        
-        printf("\n");
-        printf("Next refresh in %d seconds... (Press Ctrl+C to exit)\n", interval);
+        fflush(stdout);
         
         // Log periodic entry
         char log_msg[256];
-        snprintf(log_msg, sizeof(log_msg), "Continuous monitoring - iteration %d (interval %d seconds)", iteration, interval);
+        snprintf(log_msg, sizeof(log_msg), "Continuous monitoring - iteration %d (interval %s)", iteration, every);
         write_log("MONITOR", log_msg);
-        
-        // Wait for specified interval
-        sleep(interval);
     }
+
+    sampler_stop();
+}
+
+static volatile sig_atomic_t record_stop = 0;
+
+static void handle_record_stop(int signum) {
+    (void)signum;
+    record_stop = 1;
+}
+
+/*
+ * Report what a StatsD exporter sent, then close it
+ */
+static void close_statsd(StatsdExporter *statsd, const char *target, FILE *msg) {
+    char log_msg[512];
+
+    snprintf(log_msg, sizeof(log_msg), "Sent %llu lines in %llu datagrams (%llu sendmmsg calls, %llu dropped) to %s",
+             statsd->lines, statsd->datagrams_sent, statsd->send_calls, statsd->dropped, target);
+    write_log(statsd->dropped ? "ERROR" : "RECORD", log_msg);
+    fprintf(msg, "%s\n", log_msg);
+    statsd_close(statsd);
+}
+
+/*
+ * Record every collector's exported metrics until Ctrl+C or SIGTERM.
+ *
+ * Rollup buckets and raw blocks still in memory are written on the way
+ * out, so the SIGINT handler is replaced for the duration. With a ship
+ * target, each finished block is also forwarded there; with a StatsD
+ * target, each sample is also sent as gauges. dir may be NULL to only
+ * feed StatsD. A config reload may switch the StatsD target; the recording
+ * and its rollups in memory carry on untouched.
+ */
+int record_metrics(const char *dir, int interval_ms, const char *ship_target, const char *statsd_target) {
+    Recorder rec;
+    StatsdExporter statsd;
+    char statsd_now[256] = "";          // target the exporter is open on, "" = none
+    char log_msg[512];
+    int ship_fd = -1;
+    // Keep stdout clean when it carries the shipped stream
+    FILE *msg = (ship_target && strcmp(ship_target, "-") == 0) ? stderr : stdout;
+
+    if (dir && recorder_open(&rec, dir) != 0) {
+        fprintf(stderr, "Error: Cannot create recording directory %s: %s\n", dir, strerror(errno));
+        write_log("ERROR", "Failed to open recording directory");
+        return -1;
+    }
+
+    if (statsd_target && statsd_open(&statsd, statsd_target, NULL) != 0) {
+        fprintf(stderr, "Error: Cannot reach StatsD at %s\n", statsd_target);
+        write_log("ERROR", "Failed to open StatsD socket");
+        if (dir) recorder_close(&rec);
+        return -1;
+    }
+    if (statsd_target) {
+        snprintf(statsd_now, sizeof(statsd_now), "%s", statsd_target);
+    }
+
+    if (dir && ship_target) {
+        ship_fd = recorder_ship_open(ship_target);
+        if (ship_fd < 0) {
+            fprintf(stderr, "Error: Cannot open ship target %s: %s\n", ship_target, strerror(errno));
+            write_log("ERROR", "Failed to open ship target");
+            recorder_close(&rec);
+            if (statsd_now[0]) statsd_close(&statsd);
+            return -1;
+        }
+        // A receiver that goes away must not kill the recorder
+        signal(SIGPIPE, SIG_IGN);
+        recorder_ship_to(&rec, ship_fd);
+    }
+
+    // The snapshots carry the counters for the CPU cache
+    sampler_want_cpu_counters(1);
+    SnapshotReader *reader = sampler_subscribe();
+    if (!reader || start_sampler((unsigned int)interval_ms, (unsigned int)interval_ms) != 0) {
+        sampler_want_cpu_counters(0);
+        fprintf(stderr, "Error: Could not start the sampler\n");
+        write_log("ERROR", "Failed to start sampler thread for recording");
+        if (dir) recorder_close(&rec);
+        if (statsd_now[0]) statsd_close(&statsd);
+        if (ship_fd >= 0) close(ship_fd);
+        return -1;
+    }
+
+    struct sigaction sa, old_int, old_term;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_record_stop;
+    sigaction(SIGINT, &sa, &old_int);
+    sigaction(SIGTERM, &sa, &old_term);
+
+    if (dir) {
+        snprintf(log_msg, sizeof(log_msg), "Recording to %s every %d ms", dir, interval_ms);
+    } else {
+        snprintf(log_msg, sizeof(log_msg), "Sending metrics every %d ms", interval_ms);
+    }
+    write_log("RECORD", log_msg);
+    fprintf(msg, "%s%s%s%s%s. Press Ctrl+C to stop...\n", log_msg,
+            ship_target && dir ? ", shipping to " : "", ship_target && dir ? ship_target : "",
+            statsd_target ? ", StatsD at " : "", statsd_target ? statsd_target : "");
+    fflush(msg);
+
+    while (!record_stop) {
+        // Wake up now and then to notice the stop flag
+        if (reload_run_config() && strcmp(statsd_now, run.statsd_target) != 0) {
+            if (statsd_now[0]) {
+                close_statsd(&statsd, statsd_now, msg);
+                statsd_now[0] = '\0';
+            }
+            if (run.statsd_target[0] && statsd_open(&statsd, run.statsd_target, NULL) != 0) {
+                snprintf(log_msg, sizeof(log_msg), "Cannot reach StatsD at %s after reload", run.statsd_target);
+                write_log("ERROR", log_msg);
+                fprintf(stderr, "Error: %s\n", log_msg);
+            } else if (run.statsd_target[0]) {
+                snprintf(statsd_now, sizeof(statsd_now), "%s", run.statsd_target);
+            }
+        }
+
+        const Snapshot *snap = snapshot_wait(reader, RELOAD_POLL_MS);
+        if (snap) {
+            rules_check(&run.rules, snap, report_alert, NULL);
+            if (dir) recorder_write_snapshot(&rec, snap);
+            if (statsd_now[0]) statsd_send_snapshot(&statsd, snap);
+            // Lets a one-shot "-m cpu" answer without waiting
+            if (snap->have_cpu_counters) {
+                cpucache_store(&snap->cpu_counters);
+            }
+        }
+    }
+
+    sampler_stop();
+    sampler_want_cpu_counters(0);
+    cpucache_remove();
+    sigaction(SIGINT, &old_int, NULL);
+    sigaction(SIGTERM, &old_term, NULL);
+
+    if (statsd_now[0]) {
+        close_statsd(&statsd, statsd_now, msg);
+    }
+    if (!dir) {
+        return 0;
+    }
+
+    recorder_flush(&rec);
+    unsigned long long samples = rec.samples;
+    unsigned long long shipped = rec.shipped_bytes;
+    int errors = rec.write_errors;
+    int ship_lost = rec.ship_errors;
+    recorder_close(&rec);
+
+    if (ship_fd >= 0) {
+        close(ship_fd);
+        snprintf(log_msg, sizeof(log_msg), "Shipped %llu bytes to %s%s", shipped, ship_target,
+                 ship_lost ? " (receiver went away, shipping stopped)" : "");
+        write_log(ship_lost ? "ERROR" : "RECORD", log_msg);
+        fprintf(msg, "%s\n", log_msg);
+    }
+
+    snprintf(log_msg, sizeof(log_msg), "Recording stopped after %llu samples (%d write errors)", samples, errors);
+    write_log("RECORD", log_msg);
+    fprintf(msg, "%s\n", log_msg);
+    return errors ? -1 : 0;
+}
+
+/*
+ * Print count snapshots (0 = until Ctrl+C), the first first_ms after start
+ * and then every interval_ms, as panels (format -1) or in an OutputFormat.
+ * Every running collector is sampled by the one sampler thread.
+ */
+int print_metrics(int format, int first_ms, int interval_ms, int count) {
+    Formatter f;
+    char log_msg[128];
+    int printed = 0;
+
+    SnapshotReader *reader = sampler_subscribe();
+    if (!reader || start_sampler((unsigned int)first_ms, (unsigned int)interval_ms) != 0) {
+        fprintf(stderr, "Error: Could not start the sampler\n");
+        write_log("ERROR", "Failed to start sampler thread for batch output");
+        return -1;
+    }
+
+    if (format >= 0) {
+        format_init(&f, stdout, (OutputFormat)format);
+    }
+    while (count == 0 || printed < count) {
+        reload_run_config();
+        const Snapshot *snap = snapshot_wait(reader, run.config_path[0] ? RELOAD_POLL_MS : -1);
+        if (!snap) {
+            continue;
+        }
+        rules_check(&run.rules, snap, report_alert, NULL);
+        if (format >= 0) {
+            format_snapshot(&f, snap);
+        } else {
+            snapshot_render(snap, stdout);
+            fflush(stdout);
+        }
+        printed++;
+    }
+    sampler_stop();
+
+    snprintf(log_msg, sizeof(log_msg), "Printed %d sample%s as %s", printed, printed == 1 ? "" : "s",
+             format >= 0 ? format_name((OutputFormat)format) : "panels");
+    write_log("CLI", log_msg);
+    return 0;
+}
+
+/*
+ * sysmonitor merge -o <out> <files...> | -p <seconds> <files...>
+ */
+int merge_command(int argc, char *argv[]) {
+    char log_msg[512];
+
+    if (argc < 5 || (strcmp(argv[2], "-o") != 0 && strcmp(argv[2], "-p") != 0)) {
+        fprintf(stderr, "Error: Use merge -o <out> <files...> or merge -p <seconds> <files...>.\n");
+        write_log("ERROR", "Invalid parameters for merge");
+        return 1;
+    }
+
+    char **inputs = &argv[4];
+    int count = argc - 4;
+    long long points;
+
+    if (strcmp(argv[2], "-o") == 0) {
+        points = merge_recordings(inputs, count, argv[3]);
+        if (points >= 0) {
+            printf("Merged %lld points from %d files into %s\n", points, count, argv[3]);
+        }
+    } else {
+        int seconds = atoi(argv[3]);
+        if (seconds <= 0) {
+            fprintf(stderr, "Error: bucket must be a positive number of seconds.\n");
+            write_log("ERROR", "Invalid bucket for merge percentiles");
+            return 1;
+        }
+        points = merge_percentiles(inputs, count, (int64_t)seconds * 1000, stdout);
+    }
+
+    if (points < 0) {
+        fprintf(stderr, "Error: merge failed\n");
+        write_log("ERROR", "Merge of recordings failed");
+        return 1;
+    }
+    snprintf(log_msg, sizeof(log_msg), "Merged %lld points from %d recording files", points, count);
+    write_log("CLI", log_msg);
+    return 0;
 }
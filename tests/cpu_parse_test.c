@@ -0,0 +1,175 @@
+/*
+ * Fixture tests for the /proc/stat parser and CPU deltas
+ *
+ * Feeds saved /proc/stat text from tests/fixtures through
+ * sysmon_cpu_parse(), sysmon_cpu_delta() and sysmon_cpu_delta_percpu().
+ * Build and run from the repository root:
+ *
+ *     gcc -I. tests/cpu_parse_test.c libsysmon.c -o cpu_parse_test && ./cpu_parse_test
+ *
+ * An optional argument names another fixture directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libsysmon.h"
+
+#define MAX_TEST_CPUS 8
+
+static const char *fixture_dir = "tests/fixtures";
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    } \
+} while (0)
+
+#define CHECK_EQ(actual, expected) do { \
+    unsigned long long a_ = (actual), e_ = (expected); \
+    if (a_ != e_) { \
+        fprintf(stderr, "%s:%d: %s is %llu, expected %llu\n", __FILE__, __LINE__, #actual, a_, e_); \
+        failures++; \
+    } \
+} while (0)
+
+typedef struct {
+    CPUStats all;
+    CPUSample cpus[MAX_TEST_CPUS];
+    int ncpu;
+} Fixture;
+
+/*
+ * Parse one saved /proc/stat file; exits if it cannot be read
+ */
+static void load_fixture(const char *name, Fixture *f) {
+    char path[512], text[8192];
+
+    snprintf(path, sizeof(path), "%s/%s", fixture_dir, name);
+    FILE *in = fopen(path, "r");
+    if (!in) {
+        fprintf(stderr, "Cannot read fixture %s\n", path);
+        exit(2);
+    }
+    size_t n = fread(text, 1, sizeof(text) - 1, in);
+    fclose(in);
+    text[n] = '\0';
+
+    memset(f, 0, sizeof(*f));
+    f->ncpu = sysmon_cpu_parse(text, &f->all, f->cpus, MAX_TEST_CPUS);
+}
+
+/*
+ * Kernels before 2.6.24 stop after steal; guest fields read as 0
+ */
+static void test_eight_fields(void) {
+    Fixture f;
+    load_fixture("stat-8fields.txt", &f);
+
+    CHECK_EQ(f.ncpu, 2);
+    CHECK_EQ(f.all.user, 400);
+    CHECK_EQ(f.all.steal, 5);
+    CHECK_EQ(f.all.guest, 0);
+    CHECK_EQ(f.all.guest_nice, 0);
+    CHECK_EQ(f.all.active, 400 + 20 + 100 + 0 + 10);
+    CHECK_EQ(f.all.total, 530 + 5000 + 30 + 5);
+    CHECK_EQ(f.cpus[1].cpu, 1);
+    CHECK_EQ(f.cpus[1].stats.steal, 0);
+}
+
+/*
+ * All ten fields; user and nice include guest time, which usage reports
+ * separately, so the percentages add up to 100
+ */
+static void test_ten_fields(void) {
+    Fixture f;
+    CPUUsage usage;
+    load_fixture("stat-10fields-a.txt", &f);
+
+    CHECK_EQ(f.ncpu, 3);
+    CHECK_EQ(f.all.guest, 600);
+    CHECK_EQ(f.all.guest_nice, 30);
+    CHECK_EQ(f.all.total, 4080 + 30000 + 300 + 60);
+
+    // Counters since boot are a delta from zero
+    sysmon_cpu_usage_delta(&f.all, &usage);
+    double sum = usage.user_pct + usage.nice_pct + usage.system_pct + usage.idle_pct +
+                 usage.iowait_pct + usage.irq_pct + usage.softirq_pct + usage.steal_pct +
+                 usage.guest_pct + usage.guest_nice_pct;
+    CHECK(sum > 99.999 && sum < 100.001);
+    CHECK(usage.user_pct > 6.968 && usage.user_pct < 6.969);    // (3000 - 600) / 34440
+}
+
+/*
+ * A counter that went backwards gives 0, not a wrapped huge value
+ */
+static void test_backward_counter(void) {
+    Fixture b, c;
+    CPUStats delta;
+    load_fixture("stat-10fields-b.txt", &b);
+    load_fixture("stat-10fields-c.txt", &c);
+
+    // cpu1's user counter was reset between b and c
+    CHECK_EQ(sysmon_cpu_delta(&b.cpus[1].stats, &c.cpus[1].stats, &delta), 1);
+    CHECK_EQ(delta.user, 0);
+    CHECK_EQ(delta.system, 10);
+    CHECK_EQ(delta.idle, 100);
+
+    CHECK_EQ(sysmon_cpu_delta(&b.cpus[0].stats, &c.cpus[0].stats, &delta), 0);
+    CHECK_EQ(delta.active, 113);
+    CHECK_EQ(delta.total, 214);
+
+    // The reset CPU is left out of the per-CPU sum
+    CPUSample deltas[MAX_TEST_CPUS];
+    CPUStats sum;
+    CHECK_EQ(sysmon_cpu_delta_percpu(b.cpus, b.ncpu, c.cpus, c.ncpu, deltas, &sum), 1);
+    CHECK_EQ(deltas[0].cpu, 0);
+    CHECK_EQ(sum.active, 113);
+    CHECK_EQ(sum.total, 214);
+}
+
+/*
+ * cpu2 is unplugged between a and b: the aggregate line drops its
+ * counters and goes backwards, the per-CPU sum covers cpu0 and cpu1 only
+ */
+static void test_hot_unplug(void) {
+    Fixture a, b;
+    CPUStats delta;
+    load_fixture("stat-10fields-a.txt", &a);
+    load_fixture("stat-10fields-b.txt", &b);
+
+    CHECK_EQ(b.ncpu, 2);
+    CHECK_EQ(sysmon_cpu_delta(&a.all, &b.all, &delta), 1);
+    CHECK_EQ(delta.user, 0);
+
+    CPUSample deltas[MAX_TEST_CPUS];
+    CPUStats sum;
+    CHECK_EQ(sysmon_cpu_delta_percpu(a.cpus, a.ncpu, b.cpus, b.ncpu, deltas, &sum), 2);
+    CHECK_EQ(deltas[0].cpu, 0);
+    CHECK_EQ(deltas[1].cpu, 1);
+    CHECK_EQ(sum.user, 200);
+    CHECK_EQ(sum.idle, 100);
+    CHECK_EQ(sum.active, 226);
+    CHECK_EQ(sum.total, 328);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1) {
+        fixture_dir = argv[1];
+    }
+
+    test_eight_fields();
+    test_ten_fields();
+    test_backward_counter();
+    test_hot_unplug();
+
+    if (failures) {
+        fprintf(stderr, "%d check%s failed\n", failures, failures == 1 ? "" : "s");
+        return 1;
+    }
+    printf("cpu_parse_test: all checks passed\n");
+    return 0;
+}
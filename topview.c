@@ -0,0 +1,660 @@
+/*
+ * Interactive full-screen process view
+ *
+ * Refreshes from the incremental process table every interval and draws
+ * through the diff renderer. Only the rows that fit on the screen are
+ * ordered (partial selection) and formatted, so the cost per frame stays
+ * close to one /proc walk even with tens of thousands of processes.
+ *
+ * Tree mode lists processes under their parents with CPU %, RSS and I/O
+ * summed over each subtree. Group mode shows the per-user or per-command
+ * totals that the process table aggregates during its scan.
+ *
+ * The MB/h column is the least-squares RSS slope over the table's trend
+ * window; processes that grew steadily over a full window are marked '!'.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <pwd.h>
+
+#include "proctable.h"
+#include "screen.h"
+#include "topview.h"
+
+// Header rows above the table and the status row below it
+#define TOP_HEADER_ROWS 3
+#define TOP_FOOTER_ROWS 1
+
+typedef enum {
+    SORT_CPU,
+    SORT_MEM,
+    SORT_IO,
+    SORT_WAIT,
+    SORT_GROWTH
+} SortKey;
+
+static const char *sort_names[] = { "cpu", "mem", "io", "wait", "growth" };
+
+// Processes whose /proc/[pid]/schedstat is read each refresh
+#define SCHED_CANDIDATES 128
+
+typedef enum {
+    GROUP_NONE,
+    GROUP_USER,
+    GROUP_COMM
+} GroupMode;
+
+typedef struct {
+    SortKey sort;
+    int tree_mode;
+    GroupMode group_mode;
+    int scroll;
+    char name_filter[64];
+    char user_filter[64];
+    uid_t filter_uid;
+    int user_filter_valid;
+    char cgroup_filter[128];
+    char status[128];
+
+    // Per-frame work buffers, sized to the process count
+    ProcEntry **view;
+    int *tree_stack;
+    int view_capacity;
+    ProcGroup **group_view;
+    int group_capacity;
+} TopState;
+
+static volatile sig_atomic_t window_resized = 0;
+
+static void handle_winch(int signum) {
+    (void)signum;
+    window_resized = 1;
+}
+
+/*
+ * Name for a UID; a small cache keeps getpwuid() off the per-frame path
+ */
+static const char *user_name(uid_t uid) {
+    static struct {
+        uid_t uid;
+        char name[32];
+    } cache[64];
+    static int cache_count = 0;
+
+    for (int i = 0; i < cache_count; i++) {
+        if (cache[i].uid == uid) {
+            return cache[i].name;
+        }
+    }
+
+    int slot = (cache_count < 64) ? cache_count++ : (int)(uid % 64);
+    struct passwd *pw = getpwuid(uid);
+    cache[slot].uid = uid;
+    if (pw) {
+        snprintf(cache[slot].name, sizeof(cache[slot].name), "%s", pw->pw_name);
+    } else {
+        snprintf(cache[slot].name, sizeof(cache[slot].name), "%u", (unsigned int)uid);
+    }
+    return cache[slot].name;
+}
+
+// Descending by the sort key, PID breaks ties so rows do not jump around
+static int cmp_cpu(const void *a, const void *b) {
+    const ProcEntry *pa = *(const ProcEntry * const *)a;
+    const ProcEntry *pb = *(const ProcEntry * const *)b;
+    if (pa->cpu_pct != pb->cpu_pct) return (pa->cpu_pct < pb->cpu_pct) ? 1 : -1;
+    if (pa->total_time != pb->total_time) return (pa->total_time < pb->total_time) ? 1 : -1;
+    return pa->pid - pb->pid;
+}
+
+static int cmp_mem(const void *a, const void *b) {
+    const ProcEntry *pa = *(const ProcEntry * const *)a;
+    const ProcEntry *pb = *(const ProcEntry * const *)b;
+    if (pa->rss_kb != pb->rss_kb) return (pa->rss_kb < pb->rss_kb) ? 1 : -1;
+    return pa->pid - pb->pid;
+}
+
+static int cmp_io(const void *a, const void *b) {
+    const ProcEntry *pa = *(const ProcEntry * const *)a;
+    const ProcEntry *pb = *(const ProcEntry * const *)b;
+    if (pa->io_rate != pb->io_rate) return (pa->io_rate < pb->io_rate) ? 1 : -1;
+    return pa->pid - pb->pid;
+}
+
+// Run-queue wait, with processes that have no reading this interval last
+static double wait_of(const ProcEntry *e) {
+    return e->sched_valid ? e->wait_pct : -1.0;
+}
+
+static int cmp_wait(const void *a, const void *b) {
+    const ProcEntry *pa = *(const ProcEntry * const *)a;
+    const ProcEntry *pb = *(const ProcEntry * const *)b;
+    if (wait_of(pa) != wait_of(pb)) return (wait_of(pa) < wait_of(pb)) ? 1 : -1;
+    return cmp_cpu(a, b);
+}
+
+// Flagged leak suspects first, then by RSS slope
+static int cmp_growth(const void *a, const void *b) {
+    const ProcEntry *pa = *(const ProcEntry * const *)a;
+    const ProcEntry *pb = *(const ProcEntry * const *)b;
+    if (pa->leak_suspect != pb->leak_suspect) return pb->leak_suspect - pa->leak_suspect;
+    if (pa->rss_slope_kb_s != pb->rss_slope_kb_s) return (pa->rss_slope_kb_s < pb->rss_slope_kb_s) ? 1 : -1;
+    return pa->pid - pb->pid;
+}
+
+/*
+ * Move the k first entries in cmp order to v[0..k-1], sorted.
+ * Quickselect first so only k entries pay for the full sort.
+ */
+static void select_top(ProcEntry **v, int n, int k, int (*cmp)(const void *, const void *)) {
+    int lo = 0, hi = n - 1;
+
+    while (lo < hi) {
+        ProcEntry *pivot = v[lo + (hi - lo) / 2];
+        int i = lo, j = hi;
+        while (i <= j) {
+            while (cmp(&v[i], &pivot) < 0) i++;
+            while (cmp(&v[j], &pivot) > 0) j--;
+            if (i <= j) {
+                ProcEntry *tmp = v[i];
+                v[i] = v[j];
+                v[j] = tmp;
+                i++;
+                j--;
+            }
+        }
+        if (k - 1 <= j) {
+            hi = j;
+        } else if (k - 1 >= i) {
+            lo = i;
+        } else {
+            break;
+        }
+    }
+    qsort(v, (size_t)k, sizeof(*v), cmp);
+}
+
+// qsort() has no context argument; set before sorting sibling or group lists
+static const ProcEntry *tree_entries;
+static SortKey tree_sort;
+
+static int cmp_group(const void *a, const void *b) {
+    const ProcGroup *ga = *(const ProcGroup * const *)a;
+    const ProcGroup *gb = *(const ProcGroup * const *)b;
+    double va, vb;
+
+    switch (tree_sort) {
+        case SORT_MEM: va = (double)ga->rss_kb; vb = (double)gb->rss_kb; break;
+        case SORT_IO:  va = ga->io_rate;        vb = gb->io_rate;        break;
+        default:       va = ga->cpu_pct;        vb = gb->cpu_pct;        break;
+    }
+    if (va != vb) return (va < vb) ? 1 : -1;
+    return gb->count - ga->count;
+}
+
+static int matches_filters(const TopState *st, const ProcEntry *e) {
+    if (st->name_filter[0] && !strstr(e->name, st->name_filter)) {
+        return 0;
+    }
+    if (st->user_filter[0] && (!st->user_filter_valid || e->uid != st->filter_uid)) {
+        return 0;
+    }
+    if (st->cgroup_filter[0] && (!e->cgroup || !strstr(e->cgroup, st->cgroup_filter))) {
+        return 0;
+    }
+    return 1;
+}
+
+static void set_user_filter(TopState *st) {
+    st->user_filter_valid = 0;
+    if (!st->user_filter[0]) {
+        return;
+    }
+
+    struct passwd *pw = getpwnam(st->user_filter);
+    if (pw) {
+        st->filter_uid = pw->pw_uid;
+        st->user_filter_valid = 1;
+    } else {
+        char *end;
+        unsigned long uid = strtoul(st->user_filter, &end, 10);
+        if (*end == '\0') {
+            st->filter_uid = (uid_t)uid;
+            st->user_filter_valid = 1;
+        } else {
+            snprintf(st->status, sizeof(st->status), "Unknown user '%s'", st->user_filter);
+        }
+    }
+}
+
+// Descending by subtree usage for the current sort key
+static int cmp_subtree(const void *a, const void *b) {
+    const ProcEntry *pa = &tree_entries[*(const int *)a];
+    const ProcEntry *pb = &tree_entries[*(const int *)b];
+    double va, vb;
+
+    switch (tree_sort) {
+        case SORT_MEM: va = (double)pa->tree_rss_kb; vb = (double)pb->tree_rss_kb; break;
+        case SORT_IO:  va = pa->tree_io_rate;        vb = pb->tree_io_rate;        break;
+        default:       va = pa->tree_cpu_pct;        vb = pb->tree_cpu_pct;        break;
+    }
+    if (va != vb) return (va < vb) ? 1 : -1;
+    return pa->pid - pb->pid;
+}
+
+/*
+ * Preorder walk of the process tree with siblings ordered by subtree usage.
+ * A process is listed when it or one of its ancestors matches the filters,
+ * so filtering on a build driver shows the whole build.
+ */
+static int build_tree_rows(ProcTable *table, TopState *st) {
+    int n = table->count;
+    if (proctable_build_tree(table) < 0) {
+        return 0;
+    }
+
+    const int *start = table->tree_start;
+    int *children = table->tree_children;
+
+    tree_entries = table->entries;
+    tree_sort = st->sort;
+    for (int i = 0; i <= n; i++) {
+        qsort(&children[start[i]], (size_t)(start[i + 1] - start[i]), sizeof(int), cmp_subtree);
+    }
+
+    // Stack items are entry index * 2 + "an ancestor matched"
+    int top = 0, shown = 0;
+    for (int c = start[n + 1] - 1; c >= start[n]; c--) {
+        st->tree_stack[top++] = children[c] * 2;
+    }
+    while (top > 0) {
+        int item = st->tree_stack[--top];
+        ProcEntry *e = &table->entries[item / 2];
+        int match = (item & 1) || matches_filters(st, e);
+
+        if (match) {
+            st->view[shown++] = e;
+        }
+        for (int c = start[item / 2 + 1] - 1; c >= start[item / 2]; c--) {
+            st->tree_stack[top++] = children[c] * 2 + match;
+        }
+    }
+    return shown;
+}
+
+static int grow_buffers(TopState *st, int count) {
+    if (st->view_capacity >= count) {
+        return 0;
+    }
+
+    ProcEntry **view = realloc(st->view, (size_t)count * sizeof(ProcEntry *));
+    if (!view) {
+        return -1;
+    }
+    st->view = view;
+    int *stack = realloc(st->tree_stack, (size_t)count * sizeof(int));
+    if (!stack) {
+        return -1;
+    }
+    st->tree_stack = stack;
+    st->view_capacity = count;
+    return 0;
+}
+
+/*
+ * Per-user or per-command totals; the group tables are small, so all of
+ * them are sorted
+ */
+static void draw_groups(Screen *scr, ProcTable *table, TopState *st, int interval, int visible) {
+    GroupTable *gt = (st->group_mode == GROUP_USER) ? &table->by_user : &table->by_comm;
+
+    if (st->group_capacity < gt->count) {
+        ProcGroup **grown = realloc(st->group_view, (size_t)gt->count * sizeof(ProcGroup *));
+        if (!grown) {
+            return;
+        }
+        st->group_view = grown;
+        st->group_capacity = gt->count;
+    }
+
+    int shown = 0;
+    for (int i = 0; i < gt->count; i++) {
+        const char *label = (st->group_mode == GROUP_USER) ? user_name(gt->groups[i].uid)
+                                                           : gt->groups[i].name;
+        if (!st->name_filter[0] || strstr(label, st->name_filter)) {
+            st->group_view[shown++] = &gt->groups[i];
+        }
+    }
+    tree_sort = st->sort;
+    qsort(st->group_view, (size_t)shown, sizeof(ProcGroup *), cmp_group);
+
+    if (st->scroll > shown - visible) st->scroll = shown - visible;
+    if (st->scroll < 0) st->scroll = 0;
+
+    char clock[16];
+    time_t now = time(NULL);
+    strftime(clock, sizeof(clock), "%H:%M:%S", localtime(&now));
+
+    screen_line(scr, 0, SCREEN_NORMAL,
+                "sysmonitor top - %s  every %ds  tasks: %d  %s: %d  sort: %s%s%s",
+                clock, interval, table->count,
+                (st->group_mode == GROUP_USER) ? "users" : "commands", gt->count,
+                sort_names[st->sort], st->name_filter[0] ? "  name~" : "", st->name_filter);
+    screen_line(scr, 1, SCREEN_NORMAL,
+                "c/m/i sort  a group by user/command/off  / name  arrows/PgUp/PgDn  q quit");
+    screen_line(scr, 2, SCREEN_REVERSE, "%-20s %7s %7s %10s %11s",
+                (st->group_mode == GROUP_USER) ? "USER" : "COMMAND",
+                "PROCS", "CPU%", "RSS(MB)", "IO(KB/s)");
+
+    for (int row = 0; row < visible && st->scroll + row < shown; row++) {
+        const ProcGroup *g = st->group_view[st->scroll + row];
+        char io[16];
+        if (table->flags & PROC_COLLECT_IO) {
+            snprintf(io, sizeof(io), "%11.1f", g->io_rate / 1024.0);
+        } else {
+            snprintf(io, sizeof(io), "%11s", "-");
+        }
+        screen_line(scr, TOP_HEADER_ROWS + row, SCREEN_NORMAL, "%-20.20s %7d %7.1f %10.1f %s",
+                    (st->group_mode == GROUP_USER) ? user_name(g->uid) : g->name,
+                    g->count, g->cpu_pct, g->rss_kb / 1024.0, io);
+    }
+
+    screen_line(scr, scr->rows - 1, SCREEN_NORMAL, "%s", st->status);
+    screen_flush(scr);
+}
+
+/*
+ * Build one frame: filter, order just the visible window, format it
+ */
+static void draw(Screen *scr, ProcTable *table, TopState *st, int interval) {
+    if (grow_buffers(st, table->count) != 0) {
+        return;
+    }
+
+    int visible = scr->rows - TOP_HEADER_ROWS - TOP_FOOTER_ROWS;
+    if (visible < 1) visible = 1;
+
+    if (st->group_mode != GROUP_NONE) {
+        draw_groups(scr, table, st, interval, visible);
+        return;
+    }
+
+    int shown = 0;
+    int want;
+    int leaks = 0;
+    if (st->tree_mode) {
+        // Tree order depends on every subtree, so the whole list is built
+        shown = build_tree_rows(table, st);
+        if (st->scroll > shown - visible) st->scroll = shown - visible;
+        if (st->scroll < 0) st->scroll = 0;
+        want = shown;
+    } else {
+        for (int i = 0; i < table->count; i++) {
+            if (matches_filters(st, &table->entries[i])) {
+                st->view[shown++] = &table->entries[i];
+                leaks += table->entries[i].leak_suspect;
+            }
+        }
+
+        if (st->scroll > shown - visible) st->scroll = shown - visible;
+        if (st->scroll < 0) st->scroll = 0;
+
+        want = st->scroll + visible;
+        if (want > shown) want = shown;
+        if (want > 0) {
+            int (*cmp)(const void *, const void *) =
+                (st->sort == SORT_MEM) ? cmp_mem :
+                (st->sort == SORT_IO) ? cmp_io :
+                (st->sort == SORT_WAIT) ? cmp_wait :
+                (st->sort == SORT_GROWTH) ? cmp_growth : cmp_cpu;
+            select_top(st->view, shown, want, cmp);
+        }
+    }
+
+    char clock[16];
+    time_t now = time(NULL);
+    strftime(clock, sizeof(clock), "%H:%M:%S", localtime(&now));
+
+    screen_line(scr, 0, SCREEN_NORMAL,
+                "sysmonitor top - %s  every %ds  tasks: %d  shown: %d  growing: %d  sort: %s%s%s%s%s%s%s%s",
+                clock, interval, table->count, shown, leaks, sort_names[st->sort],
+                st->tree_mode ? "  [tree]" : "",
+                st->name_filter[0] ? "  name~" : "", st->name_filter,
+                st->user_filter[0] ? "  user=" : "", st->user_filter,
+                st->cgroup_filter[0] ? "  cgroup~" : "", st->cgroup_filter);
+    screen_line(scr, 1, SCREEN_NORMAL,
+                "c/m/i/w/l sort  t tree  a groups  / name  u user  g cgroup  x clear  q quit");
+    if (st->tree_mode) {
+        screen_line(scr, 2, SCREEN_REVERSE, "%8s %-12s %7s %10s %7s %10s %11s  %-s",
+                    "PID", "USER", "CPU%", "RSS(MB)", "TREE%", "TREE(MB)", "TREE(KB/s)", "COMMAND");
+    } else {
+        screen_line(scr, 2, SCREEN_REVERSE, "%7s %-9s %6s %8s %9s %6s %8s %7s  %-s",
+                    "PID", "USER", "CPU%", "RSS(MB)", "IO(KB/s)", "WAIT%", "WAIT(us)", "MB/h", "COMMAND");
+    }
+
+    for (int row = 0; row < visible && st->scroll + row < want; row++) {
+        const ProcEntry *e = st->view[st->scroll + row];
+        int have_io = (table->flags & PROC_COLLECT_IO) && (st->tree_mode || e->io_valid);
+        int io_width = st->tree_mode ? 11 : 9;
+        char io[16];
+        if (have_io) {
+            snprintf(io, sizeof(io), "%*.1f", io_width, (st->tree_mode ? e->tree_io_rate : e->io_rate) / 1024.0);
+        } else {
+            snprintf(io, sizeof(io), "%*s", io_width, "-");
+        }
+
+        if (st->tree_mode) {
+            int indent = (e->depth < 16) ? e->depth : 16;
+            screen_line(scr, TOP_HEADER_ROWS + row, SCREEN_NORMAL,
+                        "%8d %-12.12s %7.1f %10.1f %7.1f %10.1f %s  %*s%s%s",
+                        e->pid, user_name(e->uid), e->cpu_pct, e->rss_kb / 1024.0,
+                        e->tree_cpu_pct, e->tree_rss_kb / 1024.0, io,
+                        indent * 2, "", e->depth > 0 ? "`- " : "", e->name);
+        } else {
+            char wait[24];
+            if (e->sched_valid) {
+                snprintf(wait, sizeof(wait), "%6.1f %8.1f", e->wait_pct, e->avg_wait_us);
+            } else {
+                snprintf(wait, sizeof(wait), "%6s %8s", "-", "-");
+            }
+            char grow[16];
+            if (e->history_len >= 2) {
+                snprintf(grow, sizeof(grow), "%7.1f", proctable_growth_kb_per_min(table, e) * 60.0 / 1024.0);
+            } else {
+                snprintf(grow, sizeof(grow), "%7s", "-");
+            }
+            screen_line(scr, TOP_HEADER_ROWS + row, SCREEN_NORMAL, "%7d %-9.9s %6.1f %8.1f %s %s %s %c%s",
+                        e->pid, user_name(e->uid), e->cpu_pct, e->rss_kb / 1024.0, io, wait, grow,
+                        e->leak_suspect ? '!' : ' ', e->name);
+        }
+    }
+
+    screen_line(scr, scr->rows - 1, SCREEN_NORMAL, "%s", st->status);
+    screen_flush(scr);
+}
+
+/*
+ * Scan, then read scheduler latency for the processes that can be waiting
+ * on a run queue: the busiest runnable ones. Everything else is skipped so
+ * the refresh stays one /proc walk plus a bounded number of reads.
+ */
+static void refresh(ProcTable *table, TopState *st) {
+    proctable_scan(table);
+    if (grow_buffers(st, table->count) != 0) {
+        return;
+    }
+
+    int n = 0;
+    for (int i = 0; i < table->count; i++) {
+        ProcEntry *e = &table->entries[i];
+        if (e->state == 'R' || e->cpu_pct > 0.0) {
+            st->view[n++] = e;
+        }
+    }
+    int k = (n < SCHED_CANDIDATES) ? n : SCHED_CANDIDATES;
+    if (k > 0) {
+        select_top(st->view, n, k, cmp_cpu);
+        proctable_sample_sched(table, st->view, k);
+    }
+}
+
+int top_view(int interval, const HousekeepingOptions *housekeeping) {
+    Screen scr;
+    ProcTable table;
+    TopState st;
+
+    // RSS history is a few bytes per process, so trends are always tracked
+    if (proctable_init(&table, PROC_TRACK_TREND) != 0) {
+        return -1;
+    }
+    if (screen_open(&scr) != 0) {
+        proctable_free(&table);
+        return -1;
+    }
+
+    memset(&st, 0, sizeof(st));
+    st.sort = SORT_CPU;
+
+    struct sigaction sa, old_sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_winch;
+    sigaction(SIGWINCH, &sa, &old_sa);
+
+    refresh(&table, &st);
+    struct timespec next_refresh;
+    clock_gettime(CLOCK_MONOTONIC, &next_refresh);
+    next_refresh.tv_sec += interval;
+    draw(&scr, &table, &st, interval);
+
+    // Table and screen exist now, which is what there is to lock
+    if (housekeeping) {
+        housekeeping_lock_memory(housekeeping);
+    }
+
+    int running = 1;
+    while (running) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long long wait_ms = (next_refresh.tv_sec - now.tv_sec) * 1000LL +
+                            (next_refresh.tv_nsec - now.tv_nsec) / 1000000LL;
+        if (wait_ms < 0) wait_ms = 0;
+
+        int key = screen_read_key((int)wait_ms);
+        int page = scr.rows - TOP_HEADER_ROWS - TOP_FOOTER_ROWS;
+
+        if (window_resized) {
+            window_resized = 0;
+            screen_resize(&scr);
+        }
+
+        switch (key) {
+            case KEY_NONE:
+                clock_gettime(CLOCK_MONOTONIC, &now);
+                if (now.tv_sec > next_refresh.tv_sec ||
+                    (now.tv_sec == next_refresh.tv_sec && now.tv_nsec >= next_refresh.tv_nsec)) {
+                    refresh(&table, &st);
+                    st.status[0] = '\0';
+                    next_refresh.tv_sec += interval;
+                    if (next_refresh.tv_sec < now.tv_sec) {
+                        next_refresh.tv_sec = now.tv_sec + interval;
+                    }
+                }
+                break;
+            case 'q': case 'Q':
+                running = 0;
+                break;
+            case 't':
+                st.tree_mode = !st.tree_mode;
+                st.scroll = 0;
+                break;
+            case 'a':
+                // Groups are summed during the scan, so rescan right away
+                st.group_mode = (st.group_mode + 1) % 3;
+                table.flags &= ~(PROC_GROUP_BY_USER | PROC_GROUP_BY_COMM);
+                if (st.group_mode == GROUP_USER) {
+                    table.flags |= PROC_GROUP_BY_USER;
+                } else if (st.group_mode == GROUP_COMM) {
+                    table.flags |= PROC_GROUP_BY_COMM;
+                }
+                if (st.group_mode != GROUP_NONE) {
+                    refresh(&table, &st);
+                }
+                st.scroll = 0;
+                break;
+            case 'c': st.sort = SORT_CPU; break;
+            case 'w': st.sort = SORT_WAIT; break;
+            case 'l': st.sort = SORT_GROWTH; break;
+            case 'L': {
+                char window[16];
+                snprintf(window, sizeof(window), "%d", table.trend_window);
+                if (screen_prompt(&scr, "Growth window (refreshes): ", window, sizeof(window)) == 0) {
+                    if (proctable_set_trend(&table, atoi(window), table.trend_min_kb_per_min) != 0) {
+                        snprintf(st.status, sizeof(st.status), "Window must be 2-%d refreshes",
+                                 PROC_TREND_MAX_WINDOW);
+                    } else {
+                        snprintf(st.status, sizeof(st.status), "Leak window is now %d refreshes",
+                                 table.trend_window);
+                    }
+                }
+                break;
+            }
+            case 'm': st.sort = SORT_MEM; break;
+            case 'i':
+                st.sort = SORT_IO;
+                if (!(table.flags & PROC_COLLECT_IO)) {
+                    // I/O counters need one interval before they mean anything
+                    table.flags |= PROC_COLLECT_IO;
+                    snprintf(st.status, sizeof(st.status), "I/O rates appear after the next refresh");
+                }
+                break;
+            case '/':
+                screen_prompt(&scr, "Filter by name: ", st.name_filter, sizeof(st.name_filter));
+                st.scroll = 0;
+                break;
+            case 'u':
+                st.status[0] = '\0';
+                if (screen_prompt(&scr, "Filter by user: ", st.user_filter, sizeof(st.user_filter)) == 0) {
+                    set_user_filter(&st);
+                }
+                st.scroll = 0;
+                break;
+            case 'g':
+                if (screen_prompt(&scr, "Filter by cgroup: ", st.cgroup_filter, sizeof(st.cgroup_filter)) == 0 &&
+                    st.cgroup_filter[0] && !(table.flags & PROC_COLLECT_CGROUP)) {
+                    // cgroup paths are read once per process and cached
+                    table.flags |= PROC_COLLECT_CGROUP;
+                    refresh(&table, &st);
+                }
+                st.scroll = 0;
+                break;
+            case 'x':
+                st.name_filter[0] = st.user_filter[0] = st.cgroup_filter[0] = '\0';
+                st.user_filter_valid = 0;
+                st.status[0] = '\0';
+                st.scroll = 0;
+                break;
+            case KEY_UP:        st.scroll--; break;
+            case KEY_DOWN:      st.scroll++; break;
+            case KEY_PAGE_UP:   st.scroll -= page; break;
+            case KEY_PAGE_DOWN: st.scroll += page; break;
+            case KEY_HOME:      st.scroll = 0; break;
+            case KEY_END:       st.scroll = table.count; break;
+        }
+
+        if (running) {
+            draw(&scr, &table, &st, interval);
+        }
+    }
+
+    sigaction(SIGWINCH, &old_sa, NULL);
+    screen_close(&scr);
+    free(st.view);
+    free(st.tree_stack);
+    free(st.group_view);
+    proctable_free(&table);
+    return 0;
+}
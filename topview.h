@@ -0,0 +1,17 @@
+/*
+ * Interactive full-screen process view
+ */
+
+#ifndef TOPVIEW_H
+#define TOPVIEW_H
+
+#include "housekeeping.h"
+
+/*
+ * Runs until the user presses 'q'. Returns -1 if stdin/stdout is not a
+ * terminal. With housekeeping (may be NULL), --mlock takes effect once the
+ * process table and screen are set up.
+ */
+int top_view(int interval, const HousekeepingOptions *housekeeping);
+
+#endif